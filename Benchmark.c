@@ -0,0 +1,739 @@
+/*
+ * Micro-benchmarks for the primitives used on the application's hot paths.
+ * See Benchmark.h.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "stream_buffer.h"
+#include "message_buffer.h"
+
+/* Library includes. */
+#include "SMM_MPS2.h"
+
+/* Application includes. */
+#include "Benchmark.h"
+#include "MqttDecoder.h"
+#include "SharedState.h"
+#include "TaskTiming.h"
+
+/* Representative of the shared sensor sample. */
+typedef struct BenchValue
+{
+    uint32_t ulWords[ 4 ];
+} BenchValue_t;
+
+typedef struct BenchCase
+{
+    const char * pcName;
+
+    /* Operations or events per repetition. */
+    uint32_t ulIterations;
+
+    /* Runs the operation ulIterations times and returns the cycles taken,
+     * excluding any set up. */
+    uint32_t ( * pxRun )( uint32_t ulIterations );
+} BenchCase_t;
+
+/* Bytes sent through the stream and message buffers at a time. */
+#define benchBUFFER_BYTES          ( 16U )
+
+/* Cycles from arming a timer to its interrupt in the isr cases. */
+#define benchTIMER_DELAY_CYCLES    ( 1000UL )
+
+/* A timer interrupt that has not arrived by then is taken as a failure. */
+#define benchTIMER_TIMEOUT_MS      ( 10UL )
+
+static uint32_t prvMutexTakeGive( uint32_t ulIterations );
+static uint32_t prvMutexWrite( uint32_t ulIterations );
+static uint32_t prvMutexRead( uint32_t ulIterations );
+static uint32_t prvSharedStateWrite( uint32_t ulIterations );
+static uint32_t prvSharedStateRead( uint32_t ulIterations );
+static uint32_t prvQueueSendReceive( uint32_t ulIterations );
+static uint32_t prvQueueWakeTask( uint32_t ulIterations );
+static uint32_t prvNotifyGiveTake( uint32_t ulIterations );
+static uint32_t prvNotifyWakeTask( uint32_t ulIterations );
+static uint32_t prvStreamSendReceive( uint32_t ulIterations );
+static uint32_t prvMessageSendReceive( uint32_t ulIterations );
+static uint32_t prvDelayUntilWake( uint32_t ulIterations );
+static uint32_t prvTimer0ToTask( uint32_t ulIterations );
+static uint32_t prvTimer1ToTask( uint32_t ulIterations );
+static uint32_t prvMqttHeaderLoop( uint32_t ulIterations );
+static uint32_t prvMqttHeaderTable( uint32_t ulIterations );
+static uint32_t prvMqttParseFixedHeader( uint32_t ulIterations );
+static uint32_t prvMqttDecoderFeed( uint32_t ulIterations );
+
+/*
+ * The loop based check that main.c used before MqttDecoder.c, kept as the
+ * baseline for xMqttIsPacket().
+ */
+static BaseType_t prvReferenceIsMqttPacket( const uint8_t * pucData,
+                                            size_t xLength );
+
+/*
+ * Higher priority tasks that wait on the queue or notification, for the
+ * wake_task cases.  Each adds the cycles from the stamp it is sent to running
+ * to ulWakeCycles.
+ */
+static void prvQueueReceiverTask( void * pvParameters );
+static void prvNotifyReceiverTask( void * pvParameters );
+
+/*
+ * Arm pxTimer to interrupt once after benchTIMER_DELAY_CYCLES, and wait for
+ * the handler to notify the calling task, ulIterations times.
+ */
+static uint32_t prvTimerToTask( CMSDK_TIMER_TypeDef * pxTimer,
+                                uint32_t ulIterations );
+static void prvTimerInterrupt( CMSDK_TIMER_TypeDef * pxTimer );
+
+static void prvCreateObjects( void );
+static void prvPrintResult( const BenchCase_t * pxCase,
+                            uint32_t * pulPerOp );
+
+static const BenchCase_t xCases[] =
+{
+    { "mutex.take_give",         benchITERATIONS,      prvMutexTakeGive        },
+    { "mutex.write",             benchITERATIONS,      prvMutexWrite           },
+    { "mutex.read",              benchITERATIONS,      prvMutexRead            },
+    { "sharedstate.write",       benchITERATIONS,      prvSharedStateWrite     },
+    { "sharedstate.read",        benchITERATIONS,      prvSharedStateRead      },
+    { "queue.send_receive",      benchITERATIONS,      prvQueueSendReceive     },
+    { "queue.wake_task",         benchITERATIONS,      prvQueueWakeTask        },
+    { "notify.give_take",        benchITERATIONS,      prvNotifyGiveTake       },
+    { "notify.wake_task",        benchITERATIONS,      prvNotifyWakeTask       },
+    { "stream.send_receive",     benchITERATIONS,      prvStreamSendReceive    },
+    { "message.send_receive",    benchITERATIONS,      prvMessageSendReceive   },
+    { "delay_until.wake",        benchLATENCY_SAMPLES, prvDelayUntilWake       },
+    { "isr.timer0",              benchLATENCY_SAMPLES, prvTimer0ToTask         },
+    { "isr.timer1",              benchLATENCY_SAMPLES, prvTimer1ToTask         },
+    { "mqtt.header_loop",        benchITERATIONS,      prvMqttHeaderLoop       },
+    { "mqtt.header_table",       benchITERATIONS,      prvMqttHeaderTable      },
+    { "mqtt.parse_fixed_header", benchITERATIONS,      prvMqttParseFixedHeader },
+    { "mqtt.decoder_feed",       benchITERATIONS,      prvMqttDecoderFeed      },
+};
+
+#define benchCASE_COUNT    ( sizeof( xCases ) / sizeof( xCases[ 0 ] ) )
+
+/* Inputs for the MQTT header cases, a mix of valid and malformed headers. */
+typedef struct BenchPacket
+{
+    uint8_t ucData[ 14 ];
+    size_t xLength;
+} BenchPacket_t;
+
+static const BenchPacket_t xMqttPackets[] =
+{
+    /* Valid CONNECT. */
+    { { 0x10, 12, 0x00, 4, 'M', 'Q', 'T', 'T', 4, 0x02, 0x00, 60, 0x00, 0 }, 14 },
+    /* Valid PINGREQ. */
+    { { 0xC0, 0 },                                                           2  },
+    /* Reserved packet type. */
+    { { 0xF0, 0 },                                                           2  },
+    /* CONNECT with reserved flags set. */
+    { { 0x1F, 0 },                                                           2  },
+    /* Remaining Length with five continuation bytes. */
+    { { 0x30, 0xFF, 0xFF, 0xFF, 0xFF, 0x7F },                                6  },
+    /* Remaining Length longer than the data. */
+    { { 0x30, 0xFF, 0x7F, 0x00 },                                            4  },
+};
+
+#define benchMQTT_PACKET_COUNT    ( sizeof( xMqttPackets ) / sizeof( xMqttPackets[ 0 ] ) )
+
+/* A CONNECT, a QoS 0 PUBLISH to "a/b" and a PINGREQ, as NetTask receives
+ * them, decoded as one chunk by the mqtt.decoder_feed case. */
+static const uint8_t ucMqttStream[] =
+{
+    0x10, 12, 0x00, 4, 'M', 'Q', 'T', 'T', 4, 0x02, 0x00, 60, 0x00, 0,
+    0x30, 7, 0x00, 3, 'a', '/', 'b', '4', '2',
+    0xC0, 0
+};
+
+/* Prevents the compiler optimising the measured operations away. */
+static volatile uint32_t ulSink;
+
+static SemaphoreHandle_t xBenchMutex = NULL;
+static BenchValue_t xMutexValue;
+
+static SharedState_t xBenchState;
+static BenchValue_t xBenchSlots[ 2 ];
+
+/* As main_blinky.c's queue. */
+static QueueHandle_t xBenchQueue = NULL;
+
+static StreamBufferHandle_t xBenchStream = NULL;
+static MessageBufferHandle_t xBenchMessages = NULL;
+
+static MqttDecoder_t xBenchDecoder;
+
+/* The task running the benchmarks, notified by the timer handlers. */
+static TaskHandle_t xBenchTask = NULL;
+
+/* For the wake_task cases. */
+static QueueHandle_t xWakeQueue = NULL;
+static TaskHandle_t xNotifyReceiver = NULL;
+static volatile uint32_t ulWakeCycles;
+
+/* Written by the timer handlers and the tick hook. */
+static volatile uint32_t ulTimerCycles;
+static volatile uint32_t ulTickCycles;
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvMutexTakeGive( uint32_t ulIterations )
+{
+    uint32_t ulStart, ulIteration;
+
+    ulStart = ulTimingGetCycles();
+
+    for( ulIteration = 0; ulIteration < ulIterations; ulIteration++ )
+    {
+        if( xSemaphoreTake( xBenchMutex, portMAX_DELAY ) == pdTRUE )
+        {
+            xSemaphoreGive( xBenchMutex );
+        }
+    }
+
+    return ulTimingGetCycles() - ulStart;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvMutexWrite( uint32_t ulIterations )
+{
+    BenchValue_t xValue = { { 0 } };
+    uint32_t ulStart, ulIteration;
+
+    ulStart = ulTimingGetCycles();
+
+    for( ulIteration = 0; ulIteration < ulIterations; ulIteration++ )
+    {
+        xValue.ulWords[ 0 ] = ulIteration;
+
+        if( xSemaphoreTake( xBenchMutex, portMAX_DELAY ) == pdTRUE )
+        {
+            xMutexValue = xValue;
+            xSemaphoreGive( xBenchMutex );
+        }
+    }
+
+    return ulTimingGetCycles() - ulStart;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvMutexRead( uint32_t ulIterations )
+{
+    BenchValue_t xValue;
+    uint32_t ulStart, ulIteration;
+
+    ulStart = ulTimingGetCycles();
+
+    for( ulIteration = 0; ulIteration < ulIterations; ulIteration++ )
+    {
+        if( xSemaphoreTake( xBenchMutex, portMAX_DELAY ) == pdTRUE )
+        {
+            xValue = xMutexValue;
+            xSemaphoreGive( xBenchMutex );
+            ulSink = xValue.ulWords[ 0 ];
+        }
+    }
+
+    return ulTimingGetCycles() - ulStart;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvSharedStateWrite( uint32_t ulIterations )
+{
+    BenchValue_t xValue = { { 0 } };
+    uint32_t ulStart, ulIteration;
+
+    ulStart = ulTimingGetCycles();
+
+    for( ulIteration = 0; ulIteration < ulIterations; ulIteration++ )
+    {
+        xValue.ulWords[ 0 ] = ulIteration;
+        vSharedStatePublish( &xBenchState, &xValue );
+    }
+
+    return ulTimingGetCycles() - ulStart;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvSharedStateRead( uint32_t ulIterations )
+{
+    BenchValue_t xValue;
+    uint32_t ulStart, ulIteration;
+
+    ulStart = ulTimingGetCycles();
+
+    for( ulIteration = 0; ulIteration < ulIterations; ulIteration++ )
+    {
+        ( void ) ulSharedStateRead( &xBenchState, &xValue );
+        ulSink = xValue.ulWords[ 0 ];
+    }
+
+    return ulTimingGetCycles() - ulStart;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvQueueSendReceive( uint32_t ulIterations )
+{
+    uint32_t ulStart, ulIteration, ulValue = 0;
+
+    ulStart = ulTimingGetCycles();
+
+    for( ulIteration = 0; ulIteration < ulIterations; ulIteration++ )
+    {
+        ( void ) xQueueSend( xBenchQueue, &ulIteration, 0U );
+        ( void ) xQueueReceive( xBenchQueue, &ulValue, 0U );
+    }
+
+    ulSink = ulValue;
+
+    return ulTimingGetCycles() - ulStart;
+}
+/*-----------------------------------------------------------*/
+
+static void prvQueueReceiverTask( void * pvParameters )
+{
+    uint32_t ulStamp;
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        if( xQueueReceive( xWakeQueue, &ulStamp, portMAX_DELAY ) == pdTRUE )
+        {
+            ulWakeCycles += ulTimingGetCycles() - ulStamp;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvQueueWakeTask( uint32_t ulIterations )
+{
+    uint32_t ulIteration, ulStamp;
+
+    ulWakeCycles = 0;
+
+    for( ulIteration = 0; ulIteration < ulIterations; ulIteration++ )
+    {
+        /* The receiver runs before this returns. */
+        ulStamp = ulTimingGetCycles();
+        ( void ) xQueueSend( xWakeQueue, &ulStamp, 0U );
+    }
+
+    return ulWakeCycles;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvNotifyGiveTake( uint32_t ulIterations )
+{
+    uint32_t ulStart, ulIteration, ulValue = 0;
+
+    ulStart = ulTimingGetCycles();
+
+    for( ulIteration = 0; ulIteration < ulIterations; ulIteration++ )
+    {
+        ( void ) xTaskNotifyGive( xBenchTask );
+        ulValue += ulTaskNotifyTake( pdTRUE, 0U );
+    }
+
+    ulSink = ulValue;
+
+    return ulTimingGetCycles() - ulStart;
+}
+/*-----------------------------------------------------------*/
+
+static void prvNotifyReceiverTask( void * pvParameters )
+{
+    uint32_t ulStamp;
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        if( xTaskNotifyWait( 0U, UINT32_MAX, &ulStamp, portMAX_DELAY ) == pdTRUE )
+        {
+            ulWakeCycles += ulTimingGetCycles() - ulStamp;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvNotifyWakeTask( uint32_t ulIterations )
+{
+    uint32_t ulIteration;
+
+    ulWakeCycles = 0;
+
+    for( ulIteration = 0; ulIteration < ulIterations; ulIteration++ )
+    {
+        ( void ) xTaskNotify( xNotifyReceiver, ulTimingGetCycles(), eSetValueWithOverwrite );
+    }
+
+    return ulWakeCycles;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvStreamSendReceive( uint32_t ulIterations )
+{
+    uint8_t ucData[ benchBUFFER_BYTES ] = { 0 };
+    uint32_t ulStart, ulIteration;
+
+    ulStart = ulTimingGetCycles();
+
+    for( ulIteration = 0; ulIteration < ulIterations; ulIteration++ )
+    {
+        ( void ) xStreamBufferSend( xBenchStream, ucData, sizeof( ucData ), 0U );
+        ( void ) xStreamBufferReceive( xBenchStream, ucData, sizeof( ucData ), 0U );
+    }
+
+    ulSink = ucData[ 0 ];
+
+    return ulTimingGetCycles() - ulStart;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvMessageSendReceive( uint32_t ulIterations )
+{
+    uint8_t ucData[ benchBUFFER_BYTES ] = { 0 };
+    uint32_t ulStart, ulIteration;
+
+    ulStart = ulTimingGetCycles();
+
+    for( ulIteration = 0; ulIteration < ulIterations; ulIteration++ )
+    {
+        ( void ) xMessageBufferSend( xBenchMessages, ucData, sizeof( ucData ), 0U );
+        ( void ) xMessageBufferReceive( xBenchMessages, ucData, sizeof( ucData ), 0U );
+    }
+
+    ulSink = ucData[ 0 ];
+
+    return ulTimingGetCycles() - ulStart;
+}
+/*-----------------------------------------------------------*/
+
+void vBenchmarkTickHook( void )
+{
+    ulTickCycles = ulTimingGetCycles();
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvDelayUntilWake( uint32_t ulIterations )
+{
+    TickType_t xNextWakeTime;
+    uint32_t ulIteration, ulTotal = 0;
+
+    /* Start on a tick boundary, as the periodic tasks run. */
+    vTaskDelay( 1 );
+    xNextWakeTime = xTaskGetTickCount();
+
+    for( ulIteration = 0; ulIteration < ulIterations; ulIteration++ )
+    {
+        vTaskDelayUntil( &xNextWakeTime, 1 );
+        ulTotal += ulTimingGetCycles() - ulTickCycles;
+    }
+
+    return ulTotal;
+}
+/*-----------------------------------------------------------*/
+
+static void prvTimerInterrupt( CMSDK_TIMER_TypeDef * pxTimer )
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    ulTimerCycles = ulTimingGetCycles();
+
+    /* One shot. */
+    pxTimer->CTRL = 0;
+    pxTimer->INTCLEAR = ( 1ul << 0 );
+
+    vTaskNotifyGiveFromISR( xBenchTask, &xHigherPriorityTaskWoken );
+    portEND_SWITCHING_ISR( xHigherPriorityTaskWoken );
+}
+/*-----------------------------------------------------------*/
+
+void TIMER0_Handler( void )
+{
+    prvTimerInterrupt( CMSDK_TIMER0 );
+}
+/*-----------------------------------------------------------*/
+
+void TIMER1_Handler( void )
+{
+    prvTimerInterrupt( CMSDK_TIMER1 );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvTimerToTask( CMSDK_TIMER_TypeDef * pxTimer,
+                                uint32_t ulIterations )
+{
+    uint32_t ulIteration, ulTotal = 0;
+
+    for( ulIteration = 0; ulIteration < ulIterations; ulIteration++ )
+    {
+        pxTimer->VALUE = benchTIMER_DELAY_CYCLES;
+        pxTimer->RELOAD = benchTIMER_DELAY_CYCLES;
+        pxTimer->CTRL = ( ( 1ul << 3 ) | /* Enable Timer interrupt. */
+                          ( 1ul << 0 ) ); /* Enable Timer. */
+
+        if( ulTaskNotifyTake( pdTRUE, pdMS_TO_TICKS( benchTIMER_TIMEOUT_MS ) ) == 0U )
+        {
+            pxTimer->CTRL = 0;
+            configASSERT( 0 );
+        }
+
+        ulTotal += ulTimingGetCycles() - ulTimerCycles;
+    }
+
+    return ulTotal;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvTimer0ToTask( uint32_t ulIterations )
+{
+    return prvTimerToTask( CMSDK_TIMER0, ulIterations );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvTimer1ToTask( uint32_t ulIterations )
+{
+    return prvTimerToTask( CMSDK_TIMER1, ulIterations );
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvReferenceIsMqttPacket( const uint8_t * pucData,
+                                            size_t xLength )
+{
+    size_t xOffset = 1, xRemainingLength = 0;
+    int iShift = 0;
+    uint8_t ucEncodedByte, ucType;
+
+    if( xLength < 2U )
+    {
+        return pdFALSE;
+    }
+
+    ucType = ( pucData[ 0 ] & 0xF0U ) >> 4;
+
+    if( ( ucType < 1U ) || ( ucType > 14U ) )
+    {
+        return pdFALSE;
+    }
+
+    for( ; ; )
+    {
+        if( xOffset >= xLength )
+        {
+            return pdFALSE;
+        }
+
+        ucEncodedByte = pucData[ xOffset++ ];
+        xRemainingLength += ( size_t ) ( ucEncodedByte & 0x7FU ) << iShift;
+        iShift += 7;
+
+        if( ( ucEncodedByte & 0x80U ) == 0U )
+        {
+            break;
+        }
+
+        if( iShift > 28 )
+        {
+            return pdFALSE;
+        }
+    }
+
+    return ( xRemainingLength <= ( xLength - xOffset ) ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvMqttHeaderLoop( uint32_t ulIterations )
+{
+    uint32_t ulStart, ulIteration, ulValid = 0;
+    size_t x;
+
+    ulStart = ulTimingGetCycles();
+
+    for( ulIteration = 0; ulIteration < ulIterations; ulIteration++ )
+    {
+        for( x = 0; x < benchMQTT_PACKET_COUNT; x++ )
+        {
+            ulValid += ( uint32_t ) prvReferenceIsMqttPacket( xMqttPackets[ x ].ucData, xMqttPackets[ x ].xLength );
+        }
+    }
+
+    ulSink = ulValid;
+
+    /* Report the cost per header checked. */
+    return ( ulTimingGetCycles() - ulStart ) / benchMQTT_PACKET_COUNT;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvMqttHeaderTable( uint32_t ulIterations )
+{
+    uint32_t ulStart, ulIteration, ulValid = 0;
+    size_t x;
+
+    ulStart = ulTimingGetCycles();
+
+    for( ulIteration = 0; ulIteration < ulIterations; ulIteration++ )
+    {
+        for( x = 0; x < benchMQTT_PACKET_COUNT; x++ )
+        {
+            ulValid += ( uint32_t ) xMqttIsPacket( xMqttPackets[ x ].ucData, xMqttPackets[ x ].xLength );
+        }
+    }
+
+    ulSink = ulValid;
+
+    return ( ulTimingGetCycles() - ulStart ) / benchMQTT_PACKET_COUNT;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvMqttParseFixedHeader( uint32_t ulIterations )
+{
+    uint32_t ulStart, ulIteration, ulRemainingLength, ulValid = 0;
+    size_t x, xHeaderLength;
+
+    ulStart = ulTimingGetCycles();
+
+    for( ulIteration = 0; ulIteration < ulIterations; ulIteration++ )
+    {
+        for( x = 0; x < benchMQTT_PACKET_COUNT; x++ )
+        {
+            if( xMqttParseFixedHeader( xMqttPackets[ x ].ucData, xMqttPackets[ x ].xLength,
+                                       &ulRemainingLength, &xHeaderLength ) == eMqttOk )
+            {
+                ulValid += ulRemainingLength;
+            }
+        }
+    }
+
+    ulSink = ulValid;
+
+    return ( ulTimingGetCycles() - ulStart ) / benchMQTT_PACKET_COUNT;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvMqttDecoderFeed( uint32_t ulIterations )
+{
+    uint32_t ulStart, ulIteration;
+
+    ulStart = ulTimingGetCycles();
+
+    for( ulIteration = 0; ulIteration < ulIterations; ulIteration++ )
+    {
+        if( xMqttDecoderFeed( &xBenchDecoder, ucMqttStream, sizeof( ucMqttStream ) ) != eMqttOk )
+        {
+            vMqttDecoderReset( &xBenchDecoder );
+        }
+    }
+
+    ulSink = xBenchDecoder.ulPackets;
+
+    /* Per packet, of the three in the stream. */
+    return ( ulTimingGetCycles() - ulStart ) / 3U;
+}
+/*-----------------------------------------------------------*/
+
+static void prvCreateObjects( void )
+{
+    UBaseType_t uxReceiverPriority = uxTaskPriorityGet( NULL ) + 1U;
+
+    configASSERT( uxReceiverPriority < configMAX_PRIORITIES );
+
+    xBenchTask = xTaskGetCurrentTaskHandle();
+
+    xBenchMutex = xSemaphoreCreateMutex();
+    configASSERT( xBenchMutex );
+    vSharedStateInit( &xBenchState, xBenchSlots, sizeof( BenchValue_t ), NULL );
+
+    xBenchQueue = xQueueCreate( 2, sizeof( uint32_t ) );
+    xWakeQueue = xQueueCreate( 1, sizeof( uint32_t ) );
+    configASSERT( xBenchQueue && xWakeQueue );
+
+    xBenchStream = xStreamBufferCreate( 2U * benchBUFFER_BYTES, 1U );
+    xBenchMessages = xMessageBufferCreate( 2U * ( benchBUFFER_BYTES + sizeof( size_t ) ) );
+    configASSERT( xBenchStream && xBenchMessages );
+
+    /* No handlers, so only the framing is decoded. */
+    vMqttDecoderInit( &xBenchDecoder, NULL, NULL );
+
+    xTaskCreate( prvQueueReceiverTask, "BenchQRx", configMINIMAL_STACK_SIZE, NULL, uxReceiverPriority, NULL );
+    xTaskCreate( prvNotifyReceiverTask, "BenchNRx", configMINIMAL_STACK_SIZE, NULL, uxReceiverPriority, &xNotifyReceiver );
+    configASSERT( xNotifyReceiver );
+
+    /* As vInitialiseTimerForIntQueueTest(), but the timers are only started
+     * by the isr cases. */
+    CMSDK_TIMER0->CTRL = 0;
+    CMSDK_TIMER0->INTCLEAR = ( 1ul << 0 );
+    CMSDK_TIMER1->CTRL = 0;
+    CMSDK_TIMER1->INTCLEAR = ( 1ul << 0 );
+    NVIC_SetPriority( TIMER0_IRQn, configMAX_SYSCALL_INTERRUPT_PRIORITY );
+    NVIC_SetPriority( TIMER1_IRQn, configMAX_SYSCALL_INTERRUPT_PRIORITY + 1 );
+    NVIC_EnableIRQ( TIMER0_IRQn );
+    NVIC_EnableIRQ( TIMER1_IRQn );
+}
+/*-----------------------------------------------------------*/
+
+static void prvPrintResult( const BenchCase_t * pxCase,
+                            uint32_t * pulPerOp )
+{
+    uint32_t ulValue;
+    size_t x, y;
+
+    /* Insertion sort, for the median. */
+    for( x = 1; x < benchREPEATS; x++ )
+    {
+        ulValue = pulPerOp[ x ];
+
+        for( y = x; ( y > 0U ) && ( pulPerOp[ y - 1U ] > ulValue ); y-- )
+        {
+            pulPerOp[ y ] = pulPerOp[ y - 1U ];
+        }
+
+        pulPerOp[ y ] = ulValue;
+    }
+
+    printf( benchRESULT_PREFIX "{\"name\":\"%s\",\"unit\":\"cycles\",\"iterations\":%u,"
+            "\"repeats\":%u,\"min\":%u,\"median\":%u,\"max\":%u}\n",
+            pxCase->pcName, ( unsigned ) pxCase->ulIterations, ( unsigned ) benchREPEATS,
+            ( unsigned ) pulPerOp[ 0 ], ( unsigned ) pulPerOp[ benchREPEATS / 2U ],
+            ( unsigned ) pulPerOp[ benchREPEATS - 1U ] );
+}
+/*-----------------------------------------------------------*/
+
+void vBenchmarkRunAll( void )
+{
+    uint32_t ulPerOp[ benchREPEATS ];
+    const BenchCase_t * pxCase;
+    size_t x, xRepeat;
+
+    if( xBenchTask == NULL )
+    {
+        prvCreateObjects();
+    }
+
+    printf( "Bench: %u cases, %u repeats each\n", ( unsigned ) benchCASE_COUNT, ( unsigned ) benchREPEATS );
+
+    for( x = 0; x < benchCASE_COUNT; x++ )
+    {
+        pxCase = &( xCases[ x ] );
+
+        /* Warm up, untimed. */
+        ( void ) pxCase->pxRun( 1U );
+
+        for( xRepeat = 0; xRepeat < benchREPEATS; xRepeat++ )
+        {
+            ulPerOp[ xRepeat ] = pxCase->pxRun( pxCase->ulIterations ) / pxCase->ulIterations;
+        }
+
+        prvPrintResult( pxCase, ulPerOp );
+    }
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,72 @@
+/*
+ * Micro-benchmarks for the primitives used on the application's hot paths.
+ *
+ * The bench application ("make bench", main_bench.c) runs them once and ends
+ * the QEMU run with a pass.  Each case runs its operation the number of times
+ * given in its table entry back to back and is repeated benchREPEATS times,
+ * after one untimed warm up run.  The cost per operation of each repetition is
+ * measured in CPU cycles by ulTimingGetCycles() (TaskTiming.h), and the
+ * smallest, median and largest of them are printed.  Throughput cases measure
+ * the uncontended path.  Latency cases measure from the event to the task that
+ * waits for it running:
+ *
+ * - queue.wake_task and notify.wake_task, from the send by a task to the
+ *   higher priority task blocked on the queue or notification running, as in
+ *   main_blinky.c and NetTask.
+ * - delay_until.wake, from the tick interrupt to a task blocked in
+ *   vTaskDelayUntil() running, stamped by vBenchmarkTickHook().
+ * - isr.timer0 and isr.timer1, from the CMSDK TIMER0 or TIMER1 interrupt to
+ *   the task it notifies running.  The timers are set up as in IntQueueTimer.c
+ *   but in one shot mode, and the handlers are defined here, so Benchmark.c
+ *   must not be linked with IntQueueTimer.c.
+ *
+ * Results are printed one per line as benchRESULT_PREFIX followed by a JSON
+ * object, for scripts/bench_compare.py:
+ *
+ *   BENCH {"name":"queue.send_receive","unit":"cycles","iterations":1000,
+ *          "repeats":5,"min":412,"median":415,"max":430}
+ *
+ * (on one line).  Under QEMU the cycle counts are derived from emulated time
+ * so should only be compared with each other, not with real hardware, and
+ * are only repeatable with QEMU's -icount.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdint.h>
+
+/* Operations per repetition of the throughput cases. */
+#ifndef benchITERATIONS
+    #define benchITERATIONS        ( 1000UL )
+#endif
+
+/* Events per repetition of the latency cases, each of which takes at least a
+ * tick (delay_until.wake) or a timer interrupt. */
+#ifndef benchLATENCY_SAMPLES
+    #define benchLATENCY_SAMPLES    ( 100UL )
+#endif
+
+/* Timed repetitions of each case. */
+#ifndef benchREPEATS
+    #define benchREPEATS           ( 5U )
+#endif
+
+/* Starts each result line. */
+#define benchRESULT_PREFIX         "BENCH "
+
+/*
+ * Run every benchmark case and print one result line per case.  Must be
+ * called from a task after the scheduler has started, at a priority below
+ * configMAX_PRIORITIES - 1 as the latency cases use helper tasks one priority
+ * higher.
+ */
+void vBenchmarkRunAll( void );
+
+/*
+ * Stamps each tick for the delay_until.wake case.  Called from
+ * vApplicationTickHook() in the bench build.
+ */
+void vBenchmarkTickHook( void );
+
+#endif /* BENCHMARK_H */
@@ -0,0 +1,215 @@
+/*
+ * Deferred binary logging.  See BinaryLog.h for the record and frame formats.
+ */
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Application includes. */
+#include "BinaryLog.h"
+#include "UARTDriver.h"
+
+/* Marker, id, count, sequence and timestamp, then the arguments, then the
+ * checksum. */
+#define logFRAME_HEADER_SIZE    ( 9U )
+#define logFRAME_MAX_SIZE       ( logFRAME_HEADER_SIZE + ( logMAX_ARGS * 4U ) + 1U )
+
+#define logDRAIN_STACK_SIZE     ( configMINIMAL_STACK_SIZE + 64 )
+
+#define logFORMAT_ENTRY( xId, pcFormat )    pcFormat,
+const char * const pcLogFormats[ logNUMBER_OF_MESSAGES ] =
+{
+    logMESSAGE_TABLE( logFORMAT_ENTRY )
+};
+#undef logFORMAT_ENTRY
+
+#if ( logUSE_BINARY_LOG == 1 )
+
+/*
+ * The task that copies records from every registered buffer to the console.
+ */
+    static void prvLogDrainTask( void * pvParameters );
+
+/*
+ * Serialise pxRecord into pucFrame, returning the frame length.
+ */
+    static size_t prvEncodeFrame( const LogRecord_t * pxRecord,
+                                  uint8_t * pucFrame );
+
+/*
+ * Send the records waiting in pxBuffer.  Stops when the console is full,
+ * unless xWaitForSpace is pdTRUE, in which case the console is flushed to make
+ * room instead.
+ */
+    static void prvDrainBuffer( LogBuffer_t * pxBuffer,
+                                uint8_t * pucFrame,
+                                BaseType_t xWaitForSpace );
+
+/* Singly linked list of the registered buffers.  Buffers are only ever added,
+ * so the drain task can walk the list without a lock once it has read the
+ * head. */
+    static LogBuffer_t * volatile pxBufferList = NULL;
+
+/*-----------------------------------------------------------*/
+
+    void vLogRegisterBuffer( LogBuffer_t * pxBuffer )
+    {
+        pxBuffer->ulHead = 0;
+        pxBuffer->ulTail = 0;
+        pxBuffer->ulDropped = 0;
+        pxBuffer->ulDroppedReported = 0;
+        pxBuffer->usSequence = 0;
+
+        taskENTER_CRITICAL();
+        {
+            pxBuffer->pxNext = pxBufferList;
+            pxBufferList = pxBuffer;
+        }
+        taskEXIT_CRITICAL();
+    }
+/*-----------------------------------------------------------*/
+
+    void vLogStartDrainTask( void )
+    {
+        xTaskCreate( prvLogDrainTask, "LogDrain", logDRAIN_STACK_SIZE, NULL, logDRAIN_TASK_PRIORITY, NULL );
+    }
+/*-----------------------------------------------------------*/
+
+    static size_t prvEncodeFrame( const LogRecord_t * pxRecord,
+                                  uint8_t * pucFrame )
+    {
+        size_t xLength = 0, x;
+        uint8_t ucChecksum = 0;
+        uint32_t ulValue;
+
+        pucFrame[ xLength++ ] = ( uint8_t ) logFRAME_MARKER;
+        pucFrame[ xLength++ ] = pxRecord->ucId;
+        pucFrame[ xLength++ ] = pxRecord->ucArgCount;
+        pucFrame[ xLength++ ] = ( uint8_t ) pxRecord->usSequence;
+        pucFrame[ xLength++ ] = ( uint8_t ) ( pxRecord->usSequence >> 8 );
+
+        ulValue = pxRecord->ulTimestamp;
+
+        for( x = 0; x < 4U; x++ )
+        {
+            pucFrame[ xLength++ ] = ( uint8_t ) ( ulValue >> ( 8U * x ) );
+        }
+
+        for( size_t xArg = 0; xArg < pxRecord->ucArgCount; xArg++ )
+        {
+            ulValue = pxRecord->ulArgs[ xArg ];
+
+            for( x = 0; x < 4U; x++ )
+            {
+                pucFrame[ xLength++ ] = ( uint8_t ) ( ulValue >> ( 8U * x ) );
+            }
+        }
+
+        for( x = 1; x < xLength; x++ )
+        {
+            ucChecksum ^= pucFrame[ x ];
+        }
+
+        pucFrame[ xLength++ ] = ucChecksum;
+
+        return xLength;
+    }
+/*-----------------------------------------------------------*/
+
+    static void prvDrainBuffer( LogBuffer_t * pxBuffer,
+                                uint8_t * pucFrame,
+                                BaseType_t xWaitForSpace )
+    {
+        uint32_t ulTail = pxBuffer->ulTail;
+        size_t xLength;
+
+        while( ulTail != pxBuffer->ulHead )
+        {
+            xLength = prvEncodeFrame( &( pxBuffer->xRecords[ ulTail & ( logBUFFER_LENGTH - 1U ) ] ), pucFrame );
+
+            /* A partially sent frame cannot be decoded, so leave the record in
+             * place until the console has room for all of it. */
+            if( xUARTGetTxFree() < xLength )
+            {
+                if( xWaitForSpace == pdFALSE )
+                {
+                    break;
+                }
+
+                vUARTFlush();
+            }
+
+            ( void ) xUARTWrite( ( const char * ) pucFrame, xLength );
+            ulTail++;
+
+            /* Release the slot only after it has been read. */
+            portMEMORY_BARRIER();
+            pxBuffer->ulTail = ulTail;
+        }
+    }
+/*-----------------------------------------------------------*/
+
+    void vLogFlush( void )
+    {
+        uint8_t ucFrame[ logFRAME_MAX_SIZE ];
+        LogBuffer_t * pxBuffer;
+        UBaseType_t uxSavedInterruptStatus;
+
+        /* Masking interrupts keeps the drain task from sending the same
+         * records at the same time. */
+        uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+        {
+            for( pxBuffer = pxBufferList; pxBuffer != NULL; pxBuffer = pxBuffer->pxNext )
+            {
+                prvDrainBuffer( pxBuffer, ucFrame, pdTRUE );
+            }
+        }
+        portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+        vUARTFlush();
+    }
+/*-----------------------------------------------------------*/
+
+    static void prvLogDrainTask( void * pvParameters )
+    {
+        const TickType_t xPeriod = pdMS_TO_TICKS( logDRAIN_PERIOD_MS );
+        uint8_t ucFrame[ logFRAME_MAX_SIZE ];
+        LogBuffer_t * pxBuffer;
+        LogRecord_t xDropped = { 0 };
+        uint32_t ulDropped;
+        size_t xLength;
+
+        ( void ) pvParameters;
+
+        xDropped.ucId = ( uint8_t ) logID_RECORDS_DROPPED;
+        xDropped.ucArgCount = 1;
+
+        for( ; ; )
+        {
+            vTaskDelay( xPeriod );
+
+            for( pxBuffer = pxBufferList; pxBuffer != NULL; pxBuffer = pxBuffer->pxNext )
+            {
+                prvDrainBuffer( pxBuffer, ucFrame, pdFALSE );
+
+                /* ulDropped belongs to the owning task, so track what has
+                 * already been reported rather than resetting it. */
+                ulDropped = pxBuffer->ulDropped - pxBuffer->ulDroppedReported;
+
+                if( ( ulDropped != 0UL ) && ( xUARTGetTxFree() >= logFRAME_MAX_SIZE ) )
+                {
+                    pxBuffer->ulDroppedReported += ulDropped;
+
+                    xDropped.ulTimestamp = logTIMESTAMP();
+                    xDropped.ulArgs[ 0 ] = ulDropped;
+                    xDropped.usSequence++;
+                    xLength = prvEncodeFrame( &xDropped, ucFrame );
+                    ( void ) xUARTWrite( ( const char * ) ucFrame, xLength );
+                }
+            }
+        }
+    }
+
+#endif /* logUSE_BINARY_LOG */
+/*-----------------------------------------------------------*/
@@ -0,0 +1,183 @@
+/*
+ * Deferred binary logging for hot path telemetry.
+ *
+ * Formatting text with printf() costs hundreds of cycles per line, which is
+ * far more than the work done by the periodic tasks being measured.  Instead a
+ * task records the index of an entry in LogMessages.h, a timestamp and up to
+ * logMAX_ARGS integer arguments into its own LogBuffer_t.  That is a handful
+ * of stores, with no locking as each buffer has exactly one writer (the owning
+ * task) and one reader (the log drain task).
+ *
+ * The drain task runs at a low priority and copies completed records to the
+ * console as binary frames:
+ *
+ *   logFRAME_MARKER, id, argument count, sequence (2 bytes), timestamp (4),
+ *   arguments (4 each), checksum (1)
+ *
+ * All multi-byte fields are little endian and the checksum is the XOR of every
+ * byte after the marker.  The marker is the ASCII record separator so it never
+ * appears in normal text output, which lets frames be interleaved with printf()
+ * output.  scripts/decode_binlog.py turns the frames back into the text lines
+ * defined in LogMessages.h.
+ *
+ * Set logUSE_BINARY_LOG to 0 to have the logWRITEn() macros call printf()
+ * directly with the same format strings instead.
+ */
+
+#ifndef BINARY_LOG_H
+#define BINARY_LOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "LogMessages.h"
+
+#ifndef logUSE_BINARY_LOG
+    #define logUSE_BINARY_LOG    1
+#endif
+
+/* Number of records each buffer can hold.  Must be a power of two. */
+#ifndef logBUFFER_LENGTH
+    #define logBUFFER_LENGTH     ( 32U )
+#endif
+
+#if ( ( logBUFFER_LENGTH & ( logBUFFER_LENGTH - 1U ) ) != 0 )
+    #error logBUFFER_LENGTH must be a power of two
+#endif
+
+/* Priority and period of the task that moves records to the console. */
+#ifndef logDRAIN_TASK_PRIORITY
+    #define logDRAIN_TASK_PRIORITY    ( tskIDLE_PRIORITY )
+#endif
+
+#ifndef logDRAIN_PERIOD_MS
+    #define logDRAIN_PERIOD_MS        ( 20U )
+#endif
+
+/* Source of the record timestamps. */
+#ifndef logTIMESTAMP
+    #define logTIMESTAMP()    ( ( uint32_t ) xTaskGetTickCount() )
+#endif
+
+#define logMAX_ARGS        ( 3U )
+#define logFRAME_MARKER    ( 0x1EU )
+
+/* Message identifiers, generated from LogMessages.h. */
+#define logENUM_ENTRY( xId, pcFormat )    xId,
+typedef enum
+{
+    logMESSAGE_TABLE( logENUM_ENTRY )
+    logNUMBER_OF_MESSAGES
+} LogMessageId_t;
+#undef logENUM_ENTRY
+
+typedef struct LogRecord
+{
+    uint8_t ucId;
+    uint8_t ucArgCount;
+    uint16_t usSequence;
+    uint32_t ulTimestamp;
+    uint32_t ulArgs[ logMAX_ARGS ];
+} LogRecord_t;
+
+typedef struct LogBuffer
+{
+    /* ulHead, ulDropped and usSequence are only written by the owning task,
+     * ulTail and ulDroppedReported only by the drain task.  The counts are
+     * free running. */
+    volatile uint32_t ulHead;
+    volatile uint32_t ulTail;
+    volatile uint32_t ulDropped;
+    uint32_t ulDroppedReported;
+    uint16_t usSequence;
+    struct LogBuffer * pxNext;
+    LogRecord_t xRecords[ logBUFFER_LENGTH ];
+} LogBuffer_t;
+
+/* The printf() formats, indexed by LogMessageId_t. */
+extern const char * const pcLogFormats[ logNUMBER_OF_MESSAGES ];
+
+#if ( logUSE_BINARY_LOG == 1 )
+
+/*
+ * Add pxBuffer to the set of buffers emptied by the drain task.  Must be
+ * called once, by the owning task, before the buffer is written.
+ */
+    void vLogRegisterBuffer( LogBuffer_t * pxBuffer );
+
+/*
+ * Create the drain task.  Call before starting the scheduler.
+ */
+    void vLogStartDrainTask( void );
+
+/*
+ * Synchronously send every record still waiting in the registered buffers,
+ * then flush the console.  For paths that end the run (see Verdict.h), where
+ * the drain task will not get to run again.  Safe with interrupts masked.
+ */
+    void vLogFlush( void );
+
+/* Not called directly - use the logWRITEn() macros below. */
+    static portFORCE_INLINE void vLogWrite( LogBuffer_t * pxBuffer,
+                                            LogMessageId_t xId,
+                                            uint8_t ucArgCount,
+                                            uint32_t ulArg0,
+                                            uint32_t ulArg1,
+                                            uint32_t ulArg2 )
+    {
+        uint32_t ulHead = pxBuffer->ulHead;
+        LogRecord_t * pxRecord;
+
+        if( ( ulHead - pxBuffer->ulTail ) >= ( uint32_t ) logBUFFER_LENGTH )
+        {
+            /* Never wait for the drain task - that would put the console cost
+             * back into the caller's timing. */
+            pxBuffer->ulDropped++;
+        }
+        else
+        {
+            pxRecord = &( pxBuffer->xRecords[ ulHead & ( logBUFFER_LENGTH - 1U ) ] );
+            pxRecord->ucId = ( uint8_t ) xId;
+            pxRecord->ucArgCount = ucArgCount;
+            pxRecord->usSequence = pxBuffer->usSequence++;
+            pxRecord->ulTimestamp = logTIMESTAMP();
+            pxRecord->ulArgs[ 0 ] = ulArg0;
+            pxRecord->ulArgs[ 1 ] = ulArg1;
+            pxRecord->ulArgs[ 2 ] = ulArg2;
+
+            /* The record must be complete before the drain task can see it. */
+            portMEMORY_BARRIER();
+            pxBuffer->ulHead = ulHead + 1UL;
+        }
+    }
+
+    #define logWRITE0( pxBuffer, xId ) \
+    vLogWrite( ( pxBuffer ), ( xId ), 0U, 0UL, 0UL, 0UL )
+    #define logWRITE1( pxBuffer, xId, ulArg0 ) \
+    vLogWrite( ( pxBuffer ), ( xId ), 1U, ( uint32_t ) ( ulArg0 ), 0UL, 0UL )
+    #define logWRITE2( pxBuffer, xId, ulArg0, ulArg1 ) \
+    vLogWrite( ( pxBuffer ), ( xId ), 2U, ( uint32_t ) ( ulArg0 ), ( uint32_t ) ( ulArg1 ), 0UL )
+    #define logWRITE3( pxBuffer, xId, ulArg0, ulArg1, ulArg2 ) \
+    vLogWrite( ( pxBuffer ), ( xId ), 3U, ( uint32_t ) ( ulArg0 ), ( uint32_t ) ( ulArg1 ), ( uint32_t ) ( ulArg2 ) )
+
+#else /* logUSE_BINARY_LOG */
+
+    #define vLogRegisterBuffer( pxBuffer )    ( void ) ( pxBuffer )
+    #define vLogStartDrainTask()
+    #define vLogFlush()
+
+    #define logWRITE0( pxBuffer, xId ) \
+    ( ( void ) ( pxBuffer ), printf( pcLogFormats[ ( xId ) ] ) )
+    #define logWRITE1( pxBuffer, xId, ulArg0 ) \
+    ( ( void ) ( pxBuffer ), printf( pcLogFormats[ ( xId ) ], ( unsigned ) ( ulArg0 ) ) )
+    #define logWRITE2( pxBuffer, xId, ulArg0, ulArg1 ) \
+    ( ( void ) ( pxBuffer ), printf( pcLogFormats[ ( xId ) ], ( unsigned ) ( ulArg0 ), ( unsigned ) ( ulArg1 ) ) )
+    #define logWRITE3( pxBuffer, xId, ulArg0, ulArg1, ulArg2 ) \
+    ( ( void ) ( pxBuffer ), printf( pcLogFormats[ ( xId ) ], ( unsigned ) ( ulArg0 ), ( unsigned ) ( ulArg1 ), ( unsigned ) ( ulArg2 ) ) )
+
+#endif /* logUSE_BINARY_LOG */
+
+#endif /* BINARY_LOG_H */
@@ -0,0 +1,69 @@
+/*
+ * Edge coverage for coverage guided fuzzing.  See Coverage.h.
+ *
+ * This file must not itself be built with -fsanitize-coverage, or the handler
+ * would call itself.
+ */
+
+#include <string.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+
+/* Application includes. */
+#include "Coverage.h"
+#include "Semihosting.h"
+
+#define coverageINDEX_MASK    ( ( uint32_t ) coverageMAP_SIZE - 1UL )
+
+/* Written from every context without a lock.  Interrupts can split an edge in
+ * two, which adds a little noise to the map but never loses a block. */
+static uint8_t ucMap[ coverageMAP_SIZE ];
+static uint32_t ulPreviousBlock = 0;
+
+/*-----------------------------------------------------------*/
+
+void __sanitizer_cov_trace_pc( void )
+{
+    uint32_t ulBlock = ( uint32_t ) __builtin_return_address( 0 );
+    uint32_t ulEdge;
+
+    /* Thumb instructions are at least two bytes apart, and mixing in the
+     * higher bits spreads nearby blocks over the map. */
+    ulBlock = ( ulBlock >> 1 ) ^ ( ulBlock >> 13 );
+    ulEdge = ( ulBlock ^ ulPreviousBlock ) & coverageINDEX_MASK;
+
+    if( ucMap[ ulEdge ] != UINT8_MAX )
+    {
+        ucMap[ ulEdge ]++;
+    }
+
+    ulPreviousBlock = ulBlock >> 1;
+}
+/*-----------------------------------------------------------*/
+
+void vCoverageDump( void )
+{
+    static const char cName[] = coverageFILE_NAME;
+    volatile uint32_t ulParameters[ 3 ];
+    int32_t lHandle;
+
+    ulParameters[ 0 ] = ( uint32_t ) cName;
+    ulParameters[ 1 ] = semihostingOPEN_MODE_WB;
+    ulParameters[ 2 ] = ( uint32_t ) strlen( cName );
+    lHandle = lSemihostingCall( semihostingSYS_OPEN, ulParameters );
+
+    if( lHandle == -1 )
+    {
+        return;
+    }
+
+    ulParameters[ 0 ] = ( uint32_t ) lHandle;
+    ulParameters[ 1 ] = ( uint32_t ) ucMap;
+    ulParameters[ 2 ] = ( uint32_t ) sizeof( ucMap );
+    ( void ) lSemihostingCall( semihostingSYS_WRITE, ulParameters );
+
+    ulParameters[ 0 ] = ( uint32_t ) lHandle;
+    ( void ) lSemihostingCall( semihostingSYS_CLOSE, ulParameters );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,53 @@
+/*
+ * Edge coverage for coverage guided fuzzing.
+ *
+ * Files built with GCC's -fsanitize-coverage=trace-pc call
+ * __sanitizer_cov_trace_pc() at the start of every basic block.  The handler
+ * below turns the return address, which identifies the block, into a hashed
+ * edge as AFL does - the index of the previous block shifted right by one,
+ * XORed with the index of this one - and increments that edge's counter in a
+ * coverageMAP_SIZE byte map.  The counters saturate rather than wrap, so a
+ * heavily used edge never reads as unused.
+ *
+ * When the run ends, vVerdictExit() (Verdict.h) calls vCoverageDump(), which
+ * writes the map to coverageFILE_NAME in QEMU's working directory with
+ * semihosting.  scripts/fuzz_corpus.py compares the maps of successive runs
+ * to keep the inputs that reach new edges.
+ *
+ * Build with "make COVERAGE=1" to instrument the packet receive path and set
+ * coverageENABLED.  Without it the map stays empty and nothing is written.
+ */
+
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include <stdint.h>
+
+#ifndef coverageENABLED
+    #define coverageENABLED      0
+#endif
+
+/* Bytes in the map, and so the number of distinct edges.  Must be a power of
+ * two.  Has to match MAP_SIZE in scripts/fuzz_corpus.py. */
+#ifndef coverageMAP_SIZE
+    #define coverageMAP_SIZE     ( 4096U )
+#endif
+
+#if ( ( coverageMAP_SIZE & ( coverageMAP_SIZE - 1U ) ) != 0 )
+    #error coverageMAP_SIZE must be a power of two
+#endif
+
+#ifndef coverageFILE_NAME
+    #define coverageFILE_NAME    "coverage.bin"
+#endif
+
+/*
+ * Write the map to coverageFILE_NAME through semihosting.  Called with
+ * interrupts masked at the end of the run, and only when coverageENABLED is 1.
+ */
+void vCoverageDump( void );
+
+/* Called by the instrumented code, never directly. */
+void __sanitizer_cov_trace_pc( void );
+
+#endif /* COVERAGE_H */
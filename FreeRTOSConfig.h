@@ -38,7 +38,7 @@
 *
 * See http://www.freertos.org/a00110.html
 *----------------------------------------------------------*/
-#define configGENERATE_RUN_TIME_STATS            0
+#define configGENERATE_RUN_TIME_STATS            1
 
 
 #define configUSE_PREEMPTION                     1
@@ -135,9 +135,59 @@
 
 #define configENABLE_BACKWARD_COMPATIBILITY 0
 
-/* TODO TraceRecorder (Step 5): Include trcRecorder.h at the end of FreeRTOSConfig.h. */
+/* Application specific settings, see the header of the module using each. */
+
+/* UARTDriver.h: 1 = console output drained by the UART0 TX interrupt, 0 = busy
+ * wait on the UART for every character. */
+#define uartUSE_BUFFERED_TX                 1
+#define uartTX_BUFFER_SIZE                  ( 2048U )
+
+/* BinaryLog.h: 1 = hot path messages are sent as binary records and decoded
+ * by scripts/decode_binlog.py, 0 = they are formatted with printf(). */
+#define logUSE_BINARY_LOG                   1
+
+/* MemPool.h: 1 = malloc() requests of up to poolROUTE_MALLOC_MAX bytes are
+ * served from the fixed block pools before falling back to heap_4. */
+#define poolROUTE_MALLOC                    1
+
+/* RunTimeStats.h: the run time counter behind configGENERATE_RUN_TIME_STATS,
+ * and the per task context switch count. */
+#ifndef __IASMARM__
+    void vRunTimeStatsConfigureTimer( void );
+    uint32_t ulRunTimeStatsGetCounter( void );
+    void vRunTimeStatsTaskSwitchedOut( void * pvTask );
+#endif
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()    vRunTimeStatsConfigureTimer()
+#define portGET_RUN_TIME_COUNTER_VALUE()            ulRunTimeStatsGetCounter()
+
+/* TicklessIdle.h: 2 = stop the tick while the idle task runs, using the
+ * application's own portSUPPRESS_TICKS_AND_SLEEP(), 0 = tick continuously. */
+#define configUSE_TICKLESS_IDLE                       2
 #ifndef __IASMARM__
+    void vTicklessSleep( TickType_t xExpectedIdleTime );
+#endif
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime )    vTicklessSleep( xExpectedIdleTime )
+
+/* 1 = the Percepio TraceRecorder is built in (build/gcc/Makefile TRACE=1).
+ * configUSE_TRACE_FACILITY stays on without it, as RunTimeStats.c uses
+ * uxTaskGetSystemState(). */
+#ifndef configUSE_TRACE_RECORDER
+    #define configUSE_TRACE_RECORDER    1
+#endif
+
+/* TODO TraceRecorder (Step 5): Include trcRecorder.h at the end of FreeRTOSConfig.h. */
+#if !defined( __IASMARM__ ) && ( configUSE_TRACE_RECORDER == 1 )
     #include "trcRecorder.h"
 #endif
 
+/* Defined after the trace recorder's hooks, so as not to displace one.  A
+ * macro cannot call an earlier definition of itself, so if the recorder (or
+ * anything else) ever defines this hook, the two have to be merged by hand
+ * rather than RunTimeStats silently counting no context switches. */
+#ifdef traceTASK_SWITCHED_OUT
+    #error "traceTASK_SWITCHED_OUT is already defined: add vRunTimeStatsTaskSwitchedOut( ( void * ) pxCurrentTCB ) to it"
+#else
+    #define traceTASK_SWITCHED_OUT()    vRunTimeStatsTaskSwitchedOut( ( void * ) pxCurrentTCB )
+#endif
+
 #endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,230 @@
+/*
+ * Instrumented wrappers around the heap_4 allocator.  See HeapMonitor.h.
+ */
+
+#include <stdio.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Library includes. */
+#include "SMM_MPS2.h"
+
+/* Application includes. */
+#include "HeapMonitor.h"
+#include "TaskTiming.h"
+
+/* Only accessed with the scheduler suspended. */
+static HeapMonitorStats_t xStats =
+{
+    .ulMallocCyclesMin = UINT32_MAX,
+    .ulFreeCyclesMin   = UINT32_MAX
+};
+
+/*
+ * Histogram bucket for a request of xSize bytes.
+ */
+static uint32_t prvSizeBucket( size_t xSize );
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvSizeBucket( size_t xSize )
+{
+    uint32_t ulBucket;
+
+    if( xSize <= 8U )
+    {
+        ulBucket = 0;
+    }
+    else
+    {
+        /* Index of the highest set bit of ( xSize - 1 ), less 2, so that
+         * 9..16 maps to 1, 17..32 to 2 and so on. */
+        ulBucket = ( 32UL - ( uint32_t ) __CLZ( ( uint32_t ) ( xSize - 1U ) ) ) - 3UL;
+
+        if( ulBucket >= heapmonHISTOGRAM_BUCKETS )
+        {
+            ulBucket = heapmonHISTOGRAM_BUCKETS - 1U;
+        }
+    }
+
+    return ulBucket;
+}
+/*-----------------------------------------------------------*/
+
+void * pvHeapMonitorMalloc( size_t xSize )
+{
+    size_t xFreeBefore, xFreeAfter;
+    uint32_t ulStart, ulCycles;
+    void * pv;
+
+    /* Nothing else can allocate between the two free size readings. */
+    vTaskSuspendAll();
+    {
+        xFreeBefore = xPortGetFreeHeapSize();
+        ulStart = ulTimingGetCycles();
+        pv = pvPortMalloc( xSize );
+        ulCycles = ulTimingGetCycles() - ulStart;
+        xFreeAfter = xPortGetFreeHeapSize();
+
+        xStats.ulSizeHistogram[ prvSizeBucket( xSize ) ]++;
+
+        if( pv == NULL )
+        {
+            xStats.ulFailures++;
+        }
+        else
+        {
+            xStats.ulAllocations++;
+            xStats.xBytesLive += xFreeBefore - xFreeAfter;
+
+            if( xStats.xBytesLive > xStats.xPeakBytesLive )
+            {
+                xStats.xPeakBytesLive = xStats.xBytesLive;
+            }
+        }
+
+        xStats.ullMallocCyclesTotal += ulCycles;
+
+        if( ulCycles < xStats.ulMallocCyclesMin )
+        {
+            xStats.ulMallocCyclesMin = ulCycles;
+        }
+
+        if( ulCycles > xStats.ulMallocCyclesMax )
+        {
+            xStats.ulMallocCyclesMax = ulCycles;
+        }
+    }
+    ( void ) xTaskResumeAll();
+
+    return pv;
+}
+/*-----------------------------------------------------------*/
+
+void vHeapMonitorFree( void * pv )
+{
+    size_t xFreeBefore, xFreeAfter;
+    uint32_t ulStart, ulCycles;
+
+    if( pv == NULL )
+    {
+        return;
+    }
+
+    vTaskSuspendAll();
+    {
+        xFreeBefore = xPortGetFreeHeapSize();
+        ulStart = ulTimingGetCycles();
+        vPortFree( pv );
+        ulCycles = ulTimingGetCycles() - ulStart;
+        xFreeAfter = xPortGetFreeHeapSize();
+
+        xStats.ulFrees++;
+
+        /* Memory allocated directly with pvPortMalloc() could be freed
+         * through here, so do not let the count go negative. */
+        if( ( xFreeAfter - xFreeBefore ) <= xStats.xBytesLive )
+        {
+            xStats.xBytesLive -= xFreeAfter - xFreeBefore;
+        }
+        else
+        {
+            xStats.xBytesLive = 0;
+        }
+
+        xStats.ullFreeCyclesTotal += ulCycles;
+
+        if( ulCycles < xStats.ulFreeCyclesMin )
+        {
+            xStats.ulFreeCyclesMin = ulCycles;
+        }
+
+        if( ulCycles > xStats.ulFreeCyclesMax )
+        {
+            xStats.ulFreeCyclesMax = ulCycles;
+        }
+    }
+    ( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+void vHeapMonitorGetStats( HeapMonitorStats_t * pxStats )
+{
+    HeapStats_t xHeapStats;
+
+    /* Walks the free list with the scheduler suspended. */
+    vPortGetHeapStats( &xHeapStats );
+
+    vTaskSuspendAll();
+    {
+        *pxStats = xStats;
+    }
+    ( void ) xTaskResumeAll();
+
+    pxStats->xHeapSize = configTOTAL_HEAP_SIZE;
+    pxStats->xFreeBytes = xHeapStats.xAvailableHeapSpaceInBytes;
+    pxStats->xMinimumEverFreeBytes = xHeapStats.xMinimumEverFreeBytesRemaining;
+    pxStats->xLargestFreeBlock = xHeapStats.xSizeOfLargestFreeBlockInBytes;
+    pxStats->xFreeBlocks = xHeapStats.xNumberOfFreeBlocks;
+}
+/*-----------------------------------------------------------*/
+
+void vHeapMonitorPrint( void )
+{
+    HeapMonitorStats_t xSnapshot;
+    uint32_t ulBucket;
+
+    vHeapMonitorGetStats( &xSnapshot );
+
+    printf( "Heap: size=%u free=%u min_free=%u largest_free=%u free_blocks=%u\n",
+            ( unsigned ) xSnapshot.xHeapSize,
+            ( unsigned ) xSnapshot.xFreeBytes,
+            ( unsigned ) xSnapshot.xMinimumEverFreeBytes,
+            ( unsigned ) xSnapshot.xLargestFreeBlock,
+            ( unsigned ) xSnapshot.xFreeBlocks );
+
+    printf( "Heap: malloc=%u free=%u failed=%u live=%u peak=%u bytes\n",
+            ( unsigned ) xSnapshot.ulAllocations,
+            ( unsigned ) xSnapshot.ulFrees,
+            ( unsigned ) xSnapshot.ulFailures,
+            ( unsigned ) xSnapshot.xBytesLive,
+            ( unsigned ) xSnapshot.xPeakBytesLive );
+
+    if( ( xSnapshot.ulAllocations + xSnapshot.ulFailures ) != 0UL )
+    {
+        printf( "Heap: malloc cycles min/mean/max=%u/%u/%u\n",
+                ( unsigned ) xSnapshot.ulMallocCyclesMin,
+                ( unsigned ) ( xSnapshot.ullMallocCyclesTotal / ( xSnapshot.ulAllocations + xSnapshot.ulFailures ) ),
+                ( unsigned ) xSnapshot.ulMallocCyclesMax );
+    }
+
+    if( xSnapshot.ulFrees != 0UL )
+    {
+        printf( "Heap: free cycles min/mean/max=%u/%u/%u\n",
+                ( unsigned ) xSnapshot.ulFreeCyclesMin,
+                ( unsigned ) ( xSnapshot.ullFreeCyclesTotal / xSnapshot.ulFrees ),
+                ( unsigned ) xSnapshot.ulFreeCyclesMax );
+    }
+
+    for( ulBucket = 0; ulBucket < heapmonHISTOGRAM_BUCKETS; ulBucket++ )
+    {
+        if( xSnapshot.ulSizeHistogram[ ulBucket ] == 0UL )
+        {
+            continue;
+        }
+
+        if( ulBucket == ( heapmonHISTOGRAM_BUCKETS - 1U ) )
+        {
+            printf( "Heap:   >%u bytes: %u\n", ( unsigned ) ( 4UL << ulBucket ),
+                    ( unsigned ) xSnapshot.ulSizeHistogram[ ulBucket ] );
+        }
+        else
+        {
+            printf( "Heap:   <=%u bytes: %u\n", ( unsigned ) ( 8UL << ulBucket ),
+                    ( unsigned ) xSnapshot.ulSizeHistogram[ ulBucket ] );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
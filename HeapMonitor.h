@@ -0,0 +1,81 @@
+/*
+ * Instrumented wrappers around the heap_4 allocator.
+ *
+ * pvHeapMonitorMalloc() and vHeapMonitorFree() call pvPortMalloc() and
+ * vPortFree() and record, for every call:
+ *
+ * - the number of allocations, frees and failures,
+ * - the heap bytes each call took or returned (the change in
+ *   xPortGetFreeHeapSize(), so heap_4's block header and alignment padding
+ *   are included), giving the bytes live through the wrappers and their peak,
+ * - a histogram of the requested sizes in power of two buckets,
+ * - the cost of each call in CPU cycles (TaskTiming.h).
+ *
+ * The whole heap figures - free bytes, minimum ever free and the largest
+ * free block - are read from heap_4 when the statistics are queried, so they
+ * also cover allocations the kernel makes directly with pvPortMalloc().
+ *
+ * Like heap_4 itself the wrappers must only be called from tasks (or before
+ * the scheduler starts), not from interrupts.
+ */
+
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+/* Number of request size buckets.  Bucket 0 counts requests of up to 8 bytes,
+ * bucket n those of ( 2^(n+2), 2^(n+3) ] bytes, and the last bucket every
+ * larger request. */
+#ifndef heapmonHISTOGRAM_BUCKETS
+    #define heapmonHISTOGRAM_BUCKETS    ( 12U )
+#endif
+
+typedef struct HeapMonitorStats
+{
+    /* Through the wrappers. */
+    uint32_t ulAllocations;
+    uint32_t ulFrees;
+    uint32_t ulFailures;
+    size_t xBytesLive;
+    size_t xPeakBytesLive;
+    uint32_t ulSizeHistogram[ heapmonHISTOGRAM_BUCKETS ];
+    uint32_t ulMallocCyclesMin;
+    uint32_t ulMallocCyclesMax;
+    uint64_t ullMallocCyclesTotal;
+    uint32_t ulFreeCyclesMin;
+    uint32_t ulFreeCyclesMax;
+    uint64_t ullFreeCyclesTotal;
+
+    /* The whole heap, read at the time of the query. */
+    size_t xHeapSize;
+    size_t xFreeBytes;
+    size_t xMinimumEverFreeBytes;
+    size_t xLargestFreeBlock;
+    size_t xFreeBlocks;
+} HeapMonitorStats_t;
+
+/*
+ * Allocate xSize bytes from heap_4, recording the call.
+ */
+void * pvHeapMonitorMalloc( size_t xSize );
+
+/*
+ * Return pv to heap_4, recording the call.  pv may be NULL.
+ */
+void vHeapMonitorFree( void * pv );
+
+/*
+ * Take a consistent snapshot of the statistics.
+ */
+void vHeapMonitorGetStats( HeapMonitorStats_t * pxStats );
+
+/*
+ * Print the statistics and the non-empty histogram buckets.
+ */
+void vHeapMonitorPrint( void );
+
+#endif /* HEAP_MONITOR_H */
@@ -0,0 +1,407 @@
+/*
+ * Interrupt latency, duration and nesting profiler.  See IsrProfiler.h.
+ */
+
+#include <stdio.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Library includes. */
+#include "SMM_MPS2.h"
+
+/* Application includes. */
+#include "IsrProfiler.h"
+#include "TaskTiming.h"
+
+#if ( isrprofENABLED == 1 )
+
+/* Entry latency of a handler without a timer to read it from. */
+#define isrprofNO_LATENCY    UINT32_MAX
+
+typedef struct IsrSource
+{
+    const char * pcName;
+    IRQn_Type xIRQn;
+
+    /* Cycles since the interrupt was raised, or isrprofNO_LATENCY. */
+    uint32_t ( * pxLatency )( void );
+} IsrSource_t;
+
+/* A handler that is running, possibly preempted. */
+typedef struct IsrFrame
+{
+    uint32_t ulStart;
+    uint32_t ulNested; /* Cycles spent in the handlers that preempted it. */
+} IsrFrame_t;
+
+static uint32_t prvSysTickLatency( void );
+static uint32_t prvTimer0Latency( void );
+static uint32_t prvTimer1Latency( void );
+static uint32_t prvNoLatency( void );
+
+static uint32_t prvBucket( uint32_t ulCycles );
+static void prvEnter( IsrId_t eIsr );
+static void prvExit( IsrId_t eIsr );
+
+static const IsrSource_t xSources[ eIsrCount ] =
+{
+    { "SysTick",   SysTick_IRQn,   prvSysTickLatency },
+    { "PendSV",    PendSV_IRQn,    prvNoLatency      },
+    { "TIMER0",    TIMER0_IRQn,    prvTimer0Latency  },
+    { "TIMER1",    TIMER1_IRQn,    prvTimer1Latency  },
+    { "DUALTIMER", DUALTIMER_IRQn, prvNoLatency      },
+    { "UARTRX0",   UARTRX0_IRQn,   prvNoLatency      },
+    { "UARTTX0",   UARTTX0_IRQn,   prvNoLatency      },
+    { "UARTTX1",   UARTTX1_IRQn,   prvNoLatency      },
+};
+
+/* Updated with PRIMASK set, by the wrappers only. */
+static IsrStats_t xStats[ eIsrCount ];
+
+/* Each handler is on the stack at most once. */
+static IsrFrame_t xFrames[ eIsrCount ];
+static UBaseType_t uxDepth = 0;
+
+/* Updated from task level with BASEPRI raised, which is all a critical
+ * section can be entered from. */
+static IsrCriticalStats_t xCritical;
+static UBaseType_t uxCriticalDepth = 0;
+static uint32_t ulCriticalStart;
+static void * pvCriticalCaller;
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvSysTickLatency( void )
+{
+    return SysTick->LOAD - SysTick->VAL;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvTimer0Latency( void )
+{
+    return CMSDK_TIMER0->RELOAD - CMSDK_TIMER0->VALUE;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvTimer1Latency( void )
+{
+    return CMSDK_TIMER1->RELOAD - CMSDK_TIMER1->VALUE;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvNoLatency( void )
+{
+    return isrprofNO_LATENCY;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvBucket( uint32_t ulCycles )
+{
+    uint32_t ulBucket;
+
+    if( ulCycles < ( 1UL << isrprofBUCKET0_SHIFT ) )
+    {
+        return 0;
+    }
+
+    /* Bit length, less the shift. */
+    ulBucket = ( 32UL - ( uint32_t ) __builtin_clz( ulCycles ) ) - isrprofBUCKET0_SHIFT;
+
+    return ( ulBucket < isrprofHISTOGRAM_BUCKETS ) ? ulBucket : ( isrprofHISTOGRAM_BUCKETS - 1U );
+}
+/*-----------------------------------------------------------*/
+
+static void prvEnter( IsrId_t eIsr )
+{
+    IsrStats_t * pxStats = &( xStats[ eIsr ] );
+    uint32_t ulLatency, ulNow, ulPrimask;
+
+    /* As early as possible, as the timers keep counting. */
+    ulLatency = xSources[ eIsr ].pxLatency();
+    ulNow = ulTimingGetCycles();
+
+    if( ( eIsr == eIsrSysTick ) && ( xTimingUsesCycleCounter() == pdFALSE ) )
+    {
+        /* The fallback counter adds the tick in progress only once the
+         * handler has counted it. */
+        ulNow += SysTick->LOAD + 1UL;
+    }
+
+    ulPrimask = __get_PRIMASK();
+    __disable_irq();
+    {
+        if( uxDepth > 0U )
+        {
+            pxStats->ulPreempted++;
+        }
+
+        xFrames[ uxDepth ].ulStart = ulNow;
+        xFrames[ uxDepth ].ulNested = 0;
+        uxDepth++;
+
+        if( uxDepth > pxStats->ulMaxDepth )
+        {
+            pxStats->ulMaxDepth = uxDepth;
+        }
+
+        if( ulLatency != isrprofNO_LATENCY )
+        {
+            if( ( pxStats->ulLatencyCount == 0UL ) || ( ulLatency < pxStats->ulLatencyMin ) )
+            {
+                pxStats->ulLatencyMin = ulLatency;
+            }
+
+            if( ulLatency > pxStats->ulLatencyMax )
+            {
+                pxStats->ulLatencyMax = ulLatency;
+            }
+
+            pxStats->ulLatencyCount++;
+            pxStats->ullLatencyTotal += ulLatency;
+        }
+    }
+    __set_PRIMASK( ulPrimask );
+}
+/*-----------------------------------------------------------*/
+
+static void prvExit( IsrId_t eIsr )
+{
+    IsrStats_t * pxStats = &( xStats[ eIsr ] );
+    uint32_t ulNow, ulElapsed, ulSelf, ulPrimask;
+
+    ulNow = ulTimingGetCycles();
+
+    ulPrimask = __get_PRIMASK();
+    __disable_irq();
+    {
+        uxDepth--;
+        ulElapsed = ulNow - xFrames[ uxDepth ].ulStart;
+        ulSelf = ulElapsed - xFrames[ uxDepth ].ulNested;
+
+        if( uxDepth > 0U )
+        {
+            xFrames[ uxDepth - 1U ].ulNested += ulElapsed;
+        }
+
+        if( ( pxStats->ulCount == 0UL ) || ( ulSelf < pxStats->ulMin ) )
+        {
+            pxStats->ulMin = ulSelf;
+        }
+
+        if( ulSelf > pxStats->ulMax )
+        {
+            pxStats->ulMax = ulSelf;
+        }
+
+        pxStats->ulCount++;
+        pxStats->ullTotal += ulSelf;
+        pxStats->ulHistogram[ prvBucket( ulSelf ) ]++;
+    }
+    __set_PRIMASK( ulPrimask );
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * The wrappers, which the linker puts in place of each handler (--wrap in
+ * build/gcc/Makefile).  A handler that is not linked into the application is
+ * a weak reference, and its wrapper only records the call.
+ */
+#define isrprofWRAP( xHandler, eIsr )                      \
+    extern void __real_ ## xHandler( void ) __attribute__( ( weak ) ); \
+    void __wrap_ ## xHandler( void );                      \
+    void __wrap_ ## xHandler( void )                       \
+    {                                                      \
+        prvEnter( eIsr );                                  \
+                                                           \
+        if( __real_ ## xHandler != NULL )                  \
+        {                                                  \
+            __real_ ## xHandler();                         \
+        }                                                  \
+                                                           \
+        prvExit( eIsr );                                   \
+    }
+
+isrprofWRAP( xPortSysTickHandler, eIsrSysTick )
+isrprofWRAP( vTaskSwitchContext, eIsrPendSV )
+isrprofWRAP( TIMER0_Handler, eIsrTimer0 )
+isrprofWRAP( TIMER1_Handler, eIsrTimer1 )
+isrprofWRAP( DUALTIMER_Handler, eIsrDualTimer )
+isrprofWRAP( UARTRX0_Handler, eIsrUartRx0 )
+isrprofWRAP( UARTTX0_Handler, eIsrUartTx0 )
+isrprofWRAP( UARTTX1_Handler, eIsrUartTx1 )
+
+/*-----------------------------------------------------------*/
+
+extern void __real_vPortEnterCritical( void );
+extern void __real_vPortExitCritical( void );
+void __wrap_vPortEnterCritical( void );
+void __wrap_vPortExitCritical( void );
+
+void __wrap_vPortEnterCritical( void )
+{
+    /* Only the outermost section unmasks interrupts again when it ends.  Before
+     * the scheduler starts BASEPRI stays raised, so nothing is timed. */
+    BaseType_t xOutermost = ( __get_BASEPRI() == 0UL ) ? pdTRUE : pdFALSE;
+
+    __real_vPortEnterCritical();
+
+    if( xOutermost == pdTRUE )
+    {
+        uxCriticalDepth = 1;
+        pvCriticalCaller = __builtin_return_address( 0 );
+        ulCriticalStart = ulTimingGetCycles();
+    }
+    else if( uxCriticalDepth > 0U )
+    {
+        uxCriticalDepth++;
+    }
+}
+/*-----------------------------------------------------------*/
+
+void __wrap_vPortExitCritical( void )
+{
+    uint32_t ulElapsed;
+
+    if( ( uxCriticalDepth > 0U ) && ( --uxCriticalDepth == 0U ) )
+    {
+        ulElapsed = ulTimingGetCycles() - ulCriticalStart;
+
+        if( ulElapsed > xCritical.ulMax )
+        {
+            xCritical.ulMax = ulElapsed;
+            xCritical.pvMaxCaller = pvCriticalCaller;
+        }
+
+        xCritical.ulCount++;
+        xCritical.ullTotal += ulElapsed;
+        xCritical.ulHistogram[ prvBucket( ulElapsed ) ]++;
+    }
+
+    /* Interrupts are unmasked from here. */
+    __real_vPortExitCritical();
+}
+/*-----------------------------------------------------------*/
+
+void vIsrProfilerGetStats( IsrId_t eIsr,
+                           IsrStats_t * pxStats )
+{
+    uint32_t ulPrimask;
+
+    configASSERT( eIsr < eIsrCount );
+
+    ulPrimask = __get_PRIMASK();
+    __disable_irq();
+    {
+        *pxStats = xStats[ eIsr ];
+    }
+    __set_PRIMASK( ulPrimask );
+}
+/*-----------------------------------------------------------*/
+
+void vIsrProfilerGetCriticalStats( IsrCriticalStats_t * pxStats )
+{
+    /* Not a critical section, which would change the figures being read. */
+    uint32_t ulPrimask = __get_PRIMASK();
+
+    __disable_irq();
+    {
+        *pxStats = xCritical;
+    }
+    __set_PRIMASK( ulPrimask );
+}
+/*-----------------------------------------------------------*/
+
+static void prvPrintHistogram( const char * pcName,
+                               const uint32_t * pulHistogram )
+{
+    uint32_t ulBucket;
+
+    for( ulBucket = 0; ulBucket < isrprofHISTOGRAM_BUCKETS; ulBucket++ )
+    {
+        if( pulHistogram[ ulBucket ] == 0UL )
+        {
+            continue;
+        }
+
+        if( ulBucket == 0UL )
+        {
+            printf( "ISR: %s   <%u cycles: %u\n", pcName, ( unsigned ) ( 1UL << isrprofBUCKET0_SHIFT ),
+                    ( unsigned ) pulHistogram[ ulBucket ] );
+        }
+        else if( ulBucket == ( isrprofHISTOGRAM_BUCKETS - 1U ) )
+        {
+            printf( "ISR: %s   >=%u cycles: %u\n", pcName,
+                    ( unsigned ) ( 1UL << ( ulBucket + isrprofBUCKET0_SHIFT - 1UL ) ),
+                    ( unsigned ) pulHistogram[ ulBucket ] );
+        }
+        else
+        {
+            printf( "ISR: %s   %u-%u cycles: %u\n", pcName,
+                    ( unsigned ) ( 1UL << ( ulBucket + isrprofBUCKET0_SHIFT - 1UL ) ),
+                    ( unsigned ) ( ( 1UL << ( ulBucket + isrprofBUCKET0_SHIFT ) ) - 1UL ),
+                    ( unsigned ) pulHistogram[ ulBucket ] );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vIsrProfilerPrint( void )
+{
+    IsrStats_t xCopy;
+    IsrCriticalStats_t xCriticalCopy;
+    uint32_t ulPriority;
+    size_t x;
+
+    vIsrProfilerGetCriticalStats( &xCriticalCopy );
+
+    for( x = 0; x < eIsrCount; x++ )
+    {
+        vIsrProfilerGetStats( ( IsrId_t ) x, &xCopy );
+
+        if( xCopy.ulCount == 0UL )
+        {
+            continue;
+        }
+
+        /* In the 8 bit form that BASEPRI is compared with. */
+        ulPriority = NVIC_GetPriority( xSources[ x ].xIRQn ) << ( 8U - __NVIC_PRIO_BITS );
+
+        printf( "ISR: %s prio=%u%s n=%u time min/mean/max=%u/%u/%u cycles preempted=%u depth=%u",
+                xSources[ x ].pcName,
+                ( unsigned ) ulPriority,
+                ( ulPriority >= configMAX_SYSCALL_INTERRUPT_PRIORITY ) ? " (masked)" : "",
+                ( unsigned ) xCopy.ulCount,
+                ( unsigned ) xCopy.ulMin,
+                ( unsigned ) ( xCopy.ullTotal / xCopy.ulCount ),
+                ( unsigned ) xCopy.ulMax,
+                ( unsigned ) xCopy.ulPreempted,
+                ( unsigned ) xCopy.ulMaxDepth );
+
+        if( xCopy.ulLatencyCount != 0UL )
+        {
+            printf( " latency min/mean/max=%u/%u/%u cycles",
+                    ( unsigned ) xCopy.ulLatencyMin,
+                    ( unsigned ) ( xCopy.ullLatencyTotal / xCopy.ulLatencyCount ),
+                    ( unsigned ) xCopy.ulLatencyMax );
+        }
+
+        printf( "\n" );
+        prvPrintHistogram( xSources[ x ].pcName, xCopy.ulHistogram );
+    }
+
+    if( xCriticalCopy.ulCount != 0UL )
+    {
+        printf( "ISR: critical sections (prio >= %u masked) n=%u mean/max=%u/%u cycles longest from %p\n",
+                ( unsigned ) configMAX_SYSCALL_INTERRUPT_PRIORITY,
+                ( unsigned ) xCriticalCopy.ulCount,
+                ( unsigned ) ( xCriticalCopy.ullTotal / xCriticalCopy.ulCount ),
+                ( unsigned ) xCriticalCopy.ulMax,
+                xCriticalCopy.pvMaxCaller );
+        prvPrintHistogram( "critical", xCriticalCopy.ulHistogram );
+    }
+}
+/*-----------------------------------------------------------*/
+
+#endif /* isrprofENABLED */
@@ -0,0 +1,123 @@
+/*
+ * Interrupt latency, duration and nesting profiler.
+ *
+ * Built with "make ISR_PROFILE=1", which sets isrprofENABLED and has the
+ * linker route the interrupt handlers and the kernel's critical sections
+ * through the wrappers in IsrProfiler.c (ld --wrap), so neither the kernel nor
+ * the drivers are changed.  The profiled handlers are the SysTick, PendSV
+ * (through vTaskSwitchContext(), the C part of the port's naked handler),
+ * TIMER0 and TIMER1 (IntQueueTimer.c and Benchmark.c), the dual timer
+ * (TicklessIdle.c) and the UART0 RX, UART0 TX and UART1 TX handlers.  Each
+ * wrapper stamps the entry and exit of its handler with ulTimingGetCycles()
+ * (TaskTiming.h) and records:
+ *
+ * - the entry latency, from the timer reaching zero to the handler running,
+ *   for the SysTick, TIMER0 and TIMER1, read from how far the timer has counted
+ *   down from its reload value.  The timers are clocked at configCPU_CLOCK_HZ
+ *   so the count is in CPU cycles.
+ * - the minimum, mean and maximum time spent in the handler itself, excluding
+ *   the handlers that preempted it, and a histogram of that time in power of
+ *   two cycle buckets.
+ * - how often the handler preempted another profiled handler, and the deepest
+ *   nesting it ran at.  IntQueueTimer.c's ulNestCount only catches TIMER0
+ *   preempting TIMER1.
+ *
+ * The vPortEnterCritical() and vPortExitCritical() wrappers time each
+ * outermost critical section from task level - the period for which BASEPRI
+ * is at configMAX_SYSCALL_INTERRUPT_PRIORITY - and keep the address of the
+ * caller of the longest, for addr2line.  Interrupts at a priority value at or
+ * above configMAX_SYSCALL_INTERRUPT_PRIORITY can be delayed by up to that
+ * longest section, so vIsrProfilerPrint() prints each handler's priority
+ * against it, next to the handler's worst entry latency.  Masking that does
+ * not go through vPortEnterCritical() (portSET_INTERRUPT_MASK_FROM_ISR(), or
+ * PRIMASK in TicklessIdle.c) is not timed.
+ *
+ * The wrappers add a few tens of cycles to every interrupt, which count
+ * towards the time of any handler they preempt.  With the SysTick fallback of
+ * ulTimingGetCycles() the SysTick entry is corrected for the tick not yet
+ * being counted (xTimingUsesCycleCounter()).
+ */
+
+#ifndef ISR_PROFILER_H
+#define ISR_PROFILER_H
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+#ifndef isrprofENABLED
+    #define isrprofENABLED              0
+#endif
+
+/* Histogram buckets.  Bucket 0 counts handler times below
+ * 2^isrprofBUCKET0_SHIFT cycles, bucket n those in
+ * [ 2^(n+shift-1), 2^(n+shift) ), and the last bucket everything longer. */
+#ifndef isrprofHISTOGRAM_BUCKETS
+    #define isrprofHISTOGRAM_BUCKETS    ( 12U )
+#endif
+
+#ifndef isrprofBUCKET0_SHIFT
+    #define isrprofBUCKET0_SHIFT        ( 5U )
+#endif
+
+typedef enum
+{
+    eIsrSysTick = 0,
+    eIsrPendSV,
+    eIsrTimer0,
+    eIsrTimer1,
+    eIsrDualTimer,
+    eIsrUartRx0,
+    eIsrUartTx0,
+    eIsrUartTx1,
+    eIsrCount
+} IsrId_t;
+
+typedef struct IsrStats
+{
+    uint32_t ulCount;
+    uint32_t ulPreempted; /* Entries that interrupted another profiled handler. */
+    uint32_t ulMaxDepth;  /* Deepest nesting at entry, 1 if it never preempted. */
+
+    /* Time in the handler itself, in cycles. */
+    uint32_t ulMin;
+    uint32_t ulMax;
+    uint64_t ullTotal;
+    uint32_t ulHistogram[ isrprofHISTOGRAM_BUCKETS ];
+
+    /* Entry latency, in cycles, for the timer interrupts. */
+    uint32_t ulLatencyCount;
+    uint32_t ulLatencyMin;
+    uint32_t ulLatencyMax;
+    uint64_t ullLatencyTotal;
+} IsrStats_t;
+
+typedef struct IsrCriticalStats
+{
+    uint32_t ulCount;
+    uint32_t ulMax;
+    uint64_t ullTotal;
+    uint32_t ulHistogram[ isrprofHISTOGRAM_BUCKETS ];
+
+    /* Return address of the vPortEnterCritical() call that began the longest
+     * section. */
+    void * pvMaxCaller;
+} IsrCriticalStats_t;
+
+/*
+ * Copy the statistics of one handler, or of the critical sections.  Can be
+ * called from any task.  These and vIsrProfilerPrint() are only defined when
+ * isrprofENABLED is 1.
+ */
+void vIsrProfilerGetStats( IsrId_t eIsr,
+                           IsrStats_t * pxStats );
+void vIsrProfilerGetCriticalStats( IsrCriticalStats_t * pxStats );
+
+/*
+ * Print one line per handler that has run, with its NVIC priority and
+ * whether critical sections mask it, its histogram, and the critical section
+ * figures.
+ */
+void vIsrProfilerPrint( void );
+
+#endif /* ISR_PROFILER_H */
@@ -0,0 +1,29 @@
+/*
+ * Table of the messages that can be emitted through the deferred binary log
+ * (BinaryLog.h).  Each entry is an identifier and the printf() format that
+ * recreates the original text line.  Only integer conversions are supported
+ * (%u, %d, %x, %X, %c, with optional width and zero padding) and at most
+ * logMAX_ARGS of them per message.
+ *
+ * The firmware only ever sends the index of the entry.  The host side decoder
+ * (scripts/decode_binlog.py) parses this file to turn the indexes back into
+ * text, so entries must keep the X( identifier, "format" ) layout, one per
+ * line, and new entries should be appended to keep existing logs decodable.
+ */
+
+#ifndef LOG_MESSAGES_H
+#define LOG_MESSAGES_H
+
+#define logMESSAGE_TABLE( X )                                                   \
+    X( logID_RECORDS_DROPPED, "LOG: %u records dropped\n" )                     \
+    X( logID_SENSOR_DATA,     "SensorTask: sSensorData=%u\n" )                  \
+    X( logID_SENSOR_TOOK,     "SensorTask: took %u us\n" )                      \
+    X( logID_SENSOR_MISSED,   "SensorTask: MISSED DEADLINE (took %u us)\n" )    \
+    X( logID_NET_PACKET,      "NetTask: Got packetType=%u, payloadLen=%u\n" )   \
+    X( logID_NET_MQTT_VALID,  "NetTask: Detected a minimal valid MQTT packet!\n" ) \
+    X( logID_NET_TOOK,        "NetTask: took %u us\n" )                         \
+    X( logID_NET_MISSED,      "NetTask: MISSED DEADLINE (took %u us)\n" )       \
+    X( logID_NET_RX_DROPPED,  "NetTask: %u packets dropped, receive ring full\n" ) \
+    X( logID_NET_MQTT_ERROR,  "NetTask: MQTT decode error %u, stream reset\n" )
+
+#endif /* LOG_MESSAGES_H */
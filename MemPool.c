@@ -0,0 +1,241 @@
+/*
+ * Fixed size block pools.  See MemPool.h.
+ */
+
+#include <stdio.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+
+/* Application includes. */
+#include "MemPool.h"
+
+/* The storage of each class, as 8 byte aligned arrays. */
+#define poolSTORAGE_ENTRY( xBlockSize, xBlockCount ) \
+    static uint64_t ullPoolStorage_##xBlockSize[ ( ( xBlockSize ) * ( xBlockCount ) ) / sizeof( uint64_t ) ];
+poolSIZE_CLASSES( poolSTORAGE_ENTRY )
+#undef poolSTORAGE_ENTRY
+
+/* Unused blocks hold a pointer to the next unused block. */
+typedef struct PoolBlock
+{
+    struct PoolBlock * pxNext;
+} PoolBlock_t;
+
+typedef struct PoolClass
+{
+    uint8_t * pucStart;
+    uint8_t * pucEnd;
+    size_t xBlockSize;
+    size_t xBlockCount;
+    PoolBlock_t * pxFreeList;
+    size_t xFreeBlocks;
+    size_t xMinimumFreeBlocks;
+    uint32_t ulAllocations;
+    uint32_t ulFailures;
+} PoolClass_t;
+
+#define poolCLASS_ENTRY( xBlockSize, xBlockCount )                          \
+    {                                                                       \
+        ( uint8_t * ) ullPoolStorage_##xBlockSize,                          \
+        ( uint8_t * ) ullPoolStorage_##xBlockSize + sizeof( ullPoolStorage_##xBlockSize ), \
+        ( xBlockSize ), ( xBlockCount ), NULL, 0, 0, 0, 0                   \
+    },
+static PoolClass_t xClasses[] =
+{
+    poolSIZE_CLASSES( poolCLASS_ENTRY )
+};
+#undef poolCLASS_ENTRY
+
+#define poolNUMBER_OF_CLASSES    ( sizeof( xClasses ) / sizeof( xClasses[ 0 ] ) )
+
+static volatile BaseType_t xPoolsInitialised = pdFALSE;
+
+/*
+ * The class pv belongs to, or NULL if it is not in any pool.
+ */
+static PoolClass_t * prvFindClass( const void * pv );
+
+/*-----------------------------------------------------------*/
+
+void vPoolInit( void )
+{
+    UBaseType_t uxSavedInterruptStatus;
+    PoolClass_t * pxClass;
+    size_t xClass, xBlock;
+
+    uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+    {
+        if( xPoolsInitialised == pdFALSE )
+        {
+            for( xClass = 0; xClass < poolNUMBER_OF_CLASSES; xClass++ )
+            {
+                pxClass = &( xClasses[ xClass ] );
+
+                configASSERT( ( pxClass->xBlockSize % sizeof( uint64_t ) ) == 0U );
+
+                /* Thread the free list in address order. */
+                pxClass->pxFreeList = NULL;
+
+                for( xBlock = pxClass->xBlockCount; xBlock > 0U; xBlock-- )
+                {
+                    PoolBlock_t * pxBlock = ( PoolBlock_t * ) ( void * ) &( pxClass->pucStart[ ( xBlock - 1U ) * pxClass->xBlockSize ] );
+
+                    pxBlock->pxNext = pxClass->pxFreeList;
+                    pxClass->pxFreeList = pxBlock;
+                }
+
+                pxClass->xFreeBlocks = pxClass->xBlockCount;
+                pxClass->xMinimumFreeBlocks = pxClass->xBlockCount;
+            }
+
+            xPoolsInitialised = pdTRUE;
+        }
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+}
+/*-----------------------------------------------------------*/
+
+void * pvPoolAlloc( size_t xSize )
+{
+    UBaseType_t uxSavedInterruptStatus;
+    PoolClass_t * pxClass;
+    PoolBlock_t * pxBlock = NULL;
+    size_t xClass;
+
+    if( xPoolsInitialised == pdFALSE )
+    {
+        vPoolInit();
+    }
+
+    uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+    {
+        /* The number of classes is a small compile time constant, so this
+         * is bounded. */
+        for( xClass = 0; xClass < poolNUMBER_OF_CLASSES; xClass++ )
+        {
+            pxClass = &( xClasses[ xClass ] );
+
+            if( xSize > pxClass->xBlockSize )
+            {
+                continue;
+            }
+
+            pxBlock = pxClass->pxFreeList;
+
+            if( pxBlock == NULL )
+            {
+                /* Fall back to the next larger class. */
+                pxClass->ulFailures++;
+                continue;
+            }
+
+            pxClass->pxFreeList = pxBlock->pxNext;
+            pxClass->xFreeBlocks--;
+            pxClass->ulAllocations++;
+
+            if( pxClass->xFreeBlocks < pxClass->xMinimumFreeBlocks )
+            {
+                pxClass->xMinimumFreeBlocks = pxClass->xFreeBlocks;
+            }
+
+            break;
+        }
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+    return pxBlock;
+}
+/*-----------------------------------------------------------*/
+
+static PoolClass_t * prvFindClass( const void * pv )
+{
+    const uint8_t * pucAddress = ( const uint8_t * ) pv;
+    size_t xClass;
+
+    for( xClass = 0; xClass < poolNUMBER_OF_CLASSES; xClass++ )
+    {
+        if( ( pucAddress >= xClasses[ xClass ].pucStart ) && ( pucAddress < xClasses[ xClass ].pucEnd ) )
+        {
+            return &( xClasses[ xClass ] );
+        }
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+void vPoolFree( void * pv )
+{
+    UBaseType_t uxSavedInterruptStatus;
+    PoolClass_t * pxClass = prvFindClass( pv );
+    PoolBlock_t * pxBlock = ( PoolBlock_t * ) pv;
+
+    /* Must be the start of a block of one of the pools. */
+    configASSERT( pxClass != NULL );
+    configASSERT( ( ( size_t ) ( ( uint8_t * ) pv - pxClass->pucStart ) % pxClass->xBlockSize ) == 0U );
+
+    uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+    {
+        configASSERT( pxClass->xFreeBlocks < pxClass->xBlockCount );
+
+        pxBlock->pxNext = pxClass->pxFreeList;
+        pxClass->pxFreeList = pxBlock;
+        pxClass->xFreeBlocks++;
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPoolOwns( const void * pv )
+{
+    return ( prvFindClass( pv ) != NULL ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPoolGetClassCount( void )
+{
+    return poolNUMBER_OF_CLASSES;
+}
+/*-----------------------------------------------------------*/
+
+void vPoolGetStats( size_t xClass,
+                    PoolStats_t * pxStats )
+{
+    UBaseType_t uxSavedInterruptStatus;
+    const PoolClass_t * pxClass;
+
+    configASSERT( xClass < poolNUMBER_OF_CLASSES );
+    pxClass = &( xClasses[ xClass ] );
+
+    uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+    {
+        pxStats->xBlockSize = pxClass->xBlockSize;
+        pxStats->xBlockCount = pxClass->xBlockCount;
+        pxStats->xFreeBlocks = ( xPoolsInitialised == pdTRUE ) ? pxClass->xFreeBlocks : pxClass->xBlockCount;
+        pxStats->xMinimumFreeBlocks = ( xPoolsInitialised == pdTRUE ) ? pxClass->xMinimumFreeBlocks : pxClass->xBlockCount;
+        pxStats->ulAllocations = pxClass->ulAllocations;
+        pxStats->ulFailures = pxClass->ulFailures;
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+}
+/*-----------------------------------------------------------*/
+
+void vPoolPrintStats( void )
+{
+    PoolStats_t xStats;
+    size_t xClass;
+
+    for( xClass = 0; xClass < poolNUMBER_OF_CLASSES; xClass++ )
+    {
+        vPoolGetStats( xClass, &xStats );
+        printf( "Pool: %u byte blocks free=%u/%u min=%u allocs=%u failures=%u\n",
+                ( unsigned ) xStats.xBlockSize,
+                ( unsigned ) xStats.xFreeBlocks,
+                ( unsigned ) xStats.xBlockCount,
+                ( unsigned ) xStats.xMinimumFreeBlocks,
+                ( unsigned ) xStats.ulAllocations,
+                ( unsigned ) xStats.ulFailures );
+    }
+}
+/*-----------------------------------------------------------*/
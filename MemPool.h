@@ -0,0 +1,89 @@
+/*
+ * Fixed size block pools, for packet and message buffers.
+ *
+ * heap_4 searches its free list first fit and coalesces on every free, so the
+ * cost of an allocation depends on the history of the heap, and long runs of
+ * mixed sizes fragment it.  The pools here are statically allocated arrays of
+ * equal sized blocks, one array per size class, with a free list threaded
+ * through the unused blocks.  Allocating and freeing take a constant number
+ * of cycles, never fragment, and can be done from interrupts at or below
+ * configMAX_SYSCALL_INTERRUPT_PRIORITY.
+ *
+ * The size classes are set by poolSIZE_CLASSES, a list of
+ * X( block size, block count ) entries in increasing block size order.  Block
+ * sizes must be multiples of 8 so every block is suitably aligned for any
+ * type.
+ *
+ * If poolROUTE_MALLOC is 1 the malloc() and free() wrappers in main.c try the
+ * pools first for requests of up to poolROUTE_MALLOC_MAX bytes, falling back
+ * to heap_4 when the pools are exhausted or the request is larger.
+ */
+
+#ifndef MEM_POOL_H
+#define MEM_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+#ifndef poolSIZE_CLASSES
+    #define poolSIZE_CLASSES( X ) \
+    X( 32U, 16U )                 \
+    X( 64U, 16U )                 \
+    X( 128U, 8U )                 \
+    X( 256U, 8U )
+#endif
+
+#ifndef poolROUTE_MALLOC
+    #define poolROUTE_MALLOC        0
+#endif
+
+/* Largest malloc() request served from the pools when poolROUTE_MALLOC is 1. */
+#ifndef poolROUTE_MALLOC_MAX
+    #define poolROUTE_MALLOC_MAX    ( 256U )
+#endif
+
+typedef struct PoolStats
+{
+    size_t xBlockSize;
+    size_t xBlockCount;
+    size_t xFreeBlocks;
+    size_t xMinimumFreeBlocks;  /* Low water mark of xFreeBlocks. */
+    uint32_t ulAllocations;     /* Successful allocations from this class. */
+    uint32_t ulFailures;        /* Requests that fitted this class but found it empty. */
+} PoolStats_t;
+
+/*
+ * Build the free lists.  Called automatically by the first allocation, so
+ * only needs calling explicitly to make the cost of doing so predictable.
+ */
+void vPoolInit( void );
+
+/*
+ * Return a block of at least xSize bytes from the smallest class that fits
+ * and has a free block, or NULL if there is none.  Safe to call from an ISR.
+ */
+void * pvPoolAlloc( size_t xSize );
+
+/*
+ * Return a block obtained from pvPoolAlloc().  Safe to call from an ISR.
+ */
+void vPoolFree( void * pv );
+
+/*
+ * pdTRUE if pv points to a block in one of the pools.
+ */
+BaseType_t xPoolOwns( const void * pv );
+
+/* Number of size classes, and the statistics of class xClass. */
+size_t xPoolGetClassCount( void );
+void vPoolGetStats( size_t xClass,
+                    PoolStats_t * pxStats );
+
+/*
+ * Print one line of statistics per size class.
+ */
+void vPoolPrintStats( void );
+
+#endif /* MEM_POOL_H */
@@ -0,0 +1,601 @@
+/*
+ * Incremental MQTT 3.1.1 packet decoder.  See MqttDecoder.h.
+ */
+
+#include <string.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+
+/* Application includes. */
+#include "MqttDecoder.h"
+
+/* Decoder states. */
+#define mqttSTATE_FIXED_HEADER        ( 0U )
+#define mqttSTATE_REMAINING_LENGTH    ( 1U )
+#define mqttSTATE_VARIABLE_HEADER     ( 2U )
+#define mqttSTATE_PAYLOAD             ( 3U )
+#define mqttSTATE_ERROR               ( 4U )
+
+/* Remaining Length is a base 128 varint of at most this many bytes. */
+#define mqttMAX_LENGTH_BYTES          ( 4U )
+
+/* Rows of ucFirstByteStatus, giving the status of each of the 16 flag values
+ * for one control packet type. */
+#define mqttV    ( ( uint8_t ) eMqttOk )
+#define mqttT    ( ( uint8_t ) eMqttErrorPacketType )
+#define mqttF    ( ( uint8_t ) eMqttErrorFlags )
+
+#define mqttROW_RESERVED_TYPE \
+    mqttT, mqttT, mqttT, mqttT, mqttT, mqttT, mqttT, mqttT, mqttT, mqttT, mqttT, mqttT, mqttT, mqttT, mqttT, mqttT
+
+/* Flags must be 0000. */
+#define mqttROW_FLAGS_0000 \
+    mqttV, mqttF, mqttF, mqttF, mqttF, mqttF, mqttF, mqttF, mqttF, mqttF, mqttF, mqttF, mqttF, mqttF, mqttF, mqttF
+
+/* Flags must be 0010 (PUBREL, SUBSCRIBE and UNSUBSCRIBE). */
+#define mqttROW_FLAGS_0010 \
+    mqttF, mqttF, mqttV, mqttF, mqttF, mqttF, mqttF, mqttF, mqttF, mqttF, mqttF, mqttF, mqttF, mqttF, mqttF, mqttF
+
+/* PUBLISH: DUP, QoS and RETAIN may take any value except QoS 3 (x11x). */
+#define mqttROW_PUBLISH \
+    mqttV, mqttV, mqttV, mqttV, mqttV, mqttV, mqttF, mqttF, mqttV, mqttV, mqttV, mqttV, mqttV, mqttV, mqttF, mqttF
+
+/*
+ * Return the total length of the variable header of the current packet given
+ * its first xAvailable bytes in pucHeader, or 0 if more bytes are needed to
+ * know.
+ */
+static size_t prvVariableHeaderLength( const MqttPacketInfo_t * pxInfo,
+                                       const uint8_t * pucHeader,
+                                       size_t xAvailable );
+
+/*
+ * Called once the Remaining Length is known, to move on to the variable
+ * header, the payload, or the next packet.
+ */
+static MqttStatus_t prvStartPacketBody( MqttDecoder_t * pxDecoder );
+
+/*
+ * Fill in the packet information from a complete variable header and call
+ * the pxOnHeader handler.
+ */
+static MqttStatus_t prvVariableHeaderComplete( MqttDecoder_t * pxDecoder,
+                                               const uint8_t * pucHeader,
+                                               size_t xHeaderLength );
+
+/*
+ * Move to the payload, or finish the packet if it has none.
+ */
+static void prvStartPayload( MqttDecoder_t * pxDecoder );
+
+static void prvPacketComplete( MqttDecoder_t * pxDecoder );
+
+static MqttStatus_t prvSetError( MqttDecoder_t * pxDecoder,
+                                 MqttStatus_t xError );
+
+static const MqttHandler_t * prvGetHandler( const MqttDecoder_t * pxDecoder );
+
+/* The MqttStatus_t of every possible first byte of a packet. */
+static const uint8_t ucFirstByteStatus[ 256 ] =
+{
+    mqttROW_RESERVED_TYPE, /* 0 Reserved */
+    mqttROW_FLAGS_0000,    /* 1 CONNECT */
+    mqttROW_FLAGS_0000,    /* 2 CONNACK */
+    mqttROW_PUBLISH,       /* 3 PUBLISH */
+    mqttROW_FLAGS_0000,    /* 4 PUBACK */
+    mqttROW_FLAGS_0000,    /* 5 PUBREC */
+    mqttROW_FLAGS_0010,    /* 6 PUBREL */
+    mqttROW_FLAGS_0000,    /* 7 PUBCOMP */
+    mqttROW_FLAGS_0010,    /* 8 SUBSCRIBE */
+    mqttROW_FLAGS_0000,    /* 9 SUBACK */
+    mqttROW_FLAGS_0010,    /* 10 UNSUBSCRIBE */
+    mqttROW_FLAGS_0000,    /* 11 UNSUBACK */
+    mqttROW_FLAGS_0000,    /* 12 PINGREQ */
+    mqttROW_FLAGS_0000,    /* 13 PINGRESP */
+    mqttROW_FLAGS_0000,    /* 14 DISCONNECT */
+    mqttROW_RESERVED_TYPE  /* 15 Reserved */
+};
+
+/*-----------------------------------------------------------*/
+
+void vMqttDecoderInit( MqttDecoder_t * pxDecoder,
+                       const MqttHandler_t * const * ppxHandlers,
+                       void * pvContext )
+{
+    pxDecoder->ppxHandlers = ppxHandlers;
+    pxDecoder->pvContext = pvContext;
+    pxDecoder->ulPackets = 0;
+    pxDecoder->ulErrors = 0;
+    vMqttDecoderReset( pxDecoder );
+}
+/*-----------------------------------------------------------*/
+
+void vMqttDecoderReset( MqttDecoder_t * pxDecoder )
+{
+    pxDecoder->ucState = mqttSTATE_FIXED_HEADER;
+    pxDecoder->xError = eMqttOk;
+    pxDecoder->xHeaderCount = 0;
+    pxDecoder->ulRemaining = 0;
+}
+/*-----------------------------------------------------------*/
+
+static const MqttHandler_t * prvGetHandler( const MqttDecoder_t * pxDecoder )
+{
+    if( pxDecoder->ppxHandlers == NULL )
+    {
+        return NULL;
+    }
+
+    return pxDecoder->ppxHandlers[ pxDecoder->xInfo.ucType ];
+}
+/*-----------------------------------------------------------*/
+
+static MqttStatus_t prvSetError( MqttDecoder_t * pxDecoder,
+                                 MqttStatus_t xError )
+{
+    pxDecoder->ucState = mqttSTATE_ERROR;
+    pxDecoder->xError = xError;
+    pxDecoder->ulErrors++;
+
+    return xError;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvVariableHeaderLength( const MqttPacketInfo_t * pxInfo,
+                                       const uint8_t * pucHeader,
+                                       size_t xAvailable )
+{
+    size_t xLength;
+
+    switch( pxInfo->ucType )
+    {
+        case mqttCONNECT:
+        case mqttPUBLISH:
+
+            /* Both start with a length prefixed string - the protocol name
+             * or the topic. */
+            if( xAvailable < 2U )
+            {
+                return 0;
+            }
+
+            xLength = 2U + ( ( ( size_t ) pucHeader[ 0 ] << 8 ) | pucHeader[ 1 ] );
+
+            if( pxInfo->ucType == mqttCONNECT )
+            {
+                /* Protocol level, connect flags and keep alive. */
+                xLength += 4U;
+            }
+            else if( pxInfo->ucQoS > 0U )
+            {
+                /* Packet identifier. */
+                xLength += 2U;
+            }
+            else
+            {
+                /* No packet identifier at QoS 0. */
+            }
+
+            break;
+
+        default:
+
+            /* CONNACK has acknowledge flags and a return code, the others a
+             * packet identifier. */
+            xLength = 2U;
+            break;
+    }
+
+    return xLength;
+}
+/*-----------------------------------------------------------*/
+
+static MqttStatus_t prvStartPacketBody( MqttDecoder_t * pxDecoder )
+{
+    MqttPacketInfo_t * pxInfo = &( pxDecoder->xInfo );
+
+    pxInfo->ulRemainingLength = pxDecoder->ulRemaining;
+
+    switch( pxInfo->ucType )
+    {
+        case mqttPINGREQ:
+        case mqttPINGRESP:
+        case mqttDISCONNECT:
+
+            /* No variable header.  Go straight to the header callback. */
+            return prvVariableHeaderComplete( pxDecoder, NULL, 0 );
+
+        default:
+
+            /* Every other type has at least a two byte variable header. */
+            if( pxDecoder->ulRemaining < 2UL )
+            {
+                return prvSetError( pxDecoder, eMqttErrorVariableHeader );
+            }
+
+            pxDecoder->xHeaderCount = 0;
+            pxDecoder->ucState = mqttSTATE_VARIABLE_HEADER;
+            break;
+    }
+
+    return eMqttOk;
+}
+/*-----------------------------------------------------------*/
+
+static MqttStatus_t prvVariableHeaderComplete( MqttDecoder_t * pxDecoder,
+                                               const uint8_t * pucHeader,
+                                               size_t xHeaderLength )
+{
+    MqttPacketInfo_t * pxInfo = &( pxDecoder->xInfo );
+    const MqttHandler_t * pxHandler = prvGetHandler( pxDecoder );
+    size_t xTopicLength;
+
+    pxInfo->xVariableHeader.pucData = pucHeader;
+    pxInfo->xVariableHeader.xLength = xHeaderLength;
+    pxInfo->ulPayloadLength = pxInfo->ulRemainingLength - ( uint32_t ) xHeaderLength;
+    pxDecoder->ulRemaining = pxInfo->ulPayloadLength;
+
+    switch( pxInfo->ucType )
+    {
+        case mqttPUBLISH:
+            xTopicLength = ( ( size_t ) pucHeader[ 0 ] << 8 ) | pucHeader[ 1 ];
+            pxInfo->xTopic.pucData = &( pucHeader[ 2 ] );
+            pxInfo->xTopic.xLength = xTopicLength;
+
+            if( pxInfo->ucQoS > 0U )
+            {
+                pxInfo->xHasPacketId = pdTRUE;
+                pxInfo->usPacketId = ( uint16_t ) ( ( pucHeader[ 2U + xTopicLength ] << 8 ) | pucHeader[ 3U + xTopicLength ] );
+            }
+
+            break;
+
+        case mqttPUBACK:
+        case mqttPUBREC:
+        case mqttPUBREL:
+        case mqttPUBCOMP:
+        case mqttSUBSCRIBE:
+        case mqttSUBACK:
+        case mqttUNSUBSCRIBE:
+        case mqttUNSUBACK:
+            pxInfo->xHasPacketId = pdTRUE;
+            pxInfo->usPacketId = ( uint16_t ) ( ( pucHeader[ 0 ] << 8 ) | pucHeader[ 1 ] );
+            break;
+
+        default:
+            /* No fields of interest in the variable header. */
+            break;
+    }
+
+    if( ( pxHandler != NULL ) && ( pxHandler->pxOnHeader != NULL ) )
+    {
+        if( pxHandler->pxOnHeader( pxDecoder->pvContext, pxInfo ) == pdFALSE )
+        {
+            return prvSetError( pxDecoder, eMqttErrorRejected );
+        }
+    }
+
+    /* The slices may point into the caller's buffer, which will not be valid
+     * by the time the later handlers are called. */
+    pxInfo->xVariableHeader.pucData = NULL;
+    pxInfo->xVariableHeader.xLength = 0;
+    pxInfo->xTopic.pucData = NULL;
+    pxInfo->xTopic.xLength = 0;
+
+    prvStartPayload( pxDecoder );
+
+    return eMqttOk;
+}
+/*-----------------------------------------------------------*/
+
+static void prvStartPayload( MqttDecoder_t * pxDecoder )
+{
+    pxDecoder->ulPayloadOffset = 0;
+
+    if( pxDecoder->ulRemaining == 0UL )
+    {
+        prvPacketComplete( pxDecoder );
+    }
+    else
+    {
+        pxDecoder->ucState = mqttSTATE_PAYLOAD;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvPacketComplete( MqttDecoder_t * pxDecoder )
+{
+    const MqttHandler_t * pxHandler = prvGetHandler( pxDecoder );
+
+    pxDecoder->ulPackets++;
+    pxDecoder->ucState = mqttSTATE_FIXED_HEADER;
+
+    if( ( pxHandler != NULL ) && ( pxHandler->pxOnComplete != NULL ) )
+    {
+        pxHandler->pxOnComplete( pxDecoder->pvContext, &( pxDecoder->xInfo ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+MqttStatus_t xMqttParseFixedHeader( const uint8_t * pucData,
+                                    size_t xLength,
+                                    uint32_t * pulRemainingLength,
+                                    size_t * pxHeaderLength )
+{
+    MqttStatus_t xStatus;
+    uint32_t ulLength;
+    uint8_t ucByte;
+
+    if( xLength == 0U )
+    {
+        return eMqttIncomplete;
+    }
+
+    xStatus = ( MqttStatus_t ) ucFirstByteStatus[ pucData[ 0 ] ];
+
+    if( xStatus != eMqttOk )
+    {
+        return xStatus;
+    }
+
+    /* The Remaining Length, unrolled.  Each step either finishes or moves on
+     * to the next byte, up to the fourth. */
+    if( xLength < 2U )
+    {
+        return eMqttIncomplete;
+    }
+
+    ucByte = pucData[ 1 ];
+    ulLength = ( uint32_t ) ( ucByte & 0x7FU );
+
+    if( ( ucByte & 0x80U ) == 0U )
+    {
+        *pxHeaderLength = 2U;
+    }
+    else
+    {
+        if( xLength < 3U )
+        {
+            return eMqttIncomplete;
+        }
+
+        ucByte = pucData[ 2 ];
+        ulLength |= ( uint32_t ) ( ucByte & 0x7FU ) << 7;
+
+        if( ( ucByte & 0x80U ) == 0U )
+        {
+            *pxHeaderLength = 3U;
+        }
+        else
+        {
+            if( xLength < 4U )
+            {
+                return eMqttIncomplete;
+            }
+
+            ucByte = pucData[ 3 ];
+            ulLength |= ( uint32_t ) ( ucByte & 0x7FU ) << 14;
+
+            if( ( ucByte & 0x80U ) == 0U )
+            {
+                *pxHeaderLength = 4U;
+            }
+            else
+            {
+                if( xLength < 5U )
+                {
+                    return eMqttIncomplete;
+                }
+
+                ucByte = pucData[ 4 ];
+
+                if( ( ucByte & 0x80U ) != 0U )
+                {
+                    return eMqttErrorRemainingLength;
+                }
+
+                ulLength |= ( uint32_t ) ucByte << 21;
+                *pxHeaderLength = 5U;
+            }
+        }
+    }
+
+    *pulRemainingLength = ulLength;
+
+    return eMqttOk;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xMqttIsPacket( const uint8_t * pucData,
+                          size_t xLength )
+{
+    uint32_t ulRemainingLength;
+    size_t xHeaderLength;
+
+    if( xMqttParseFixedHeader( pucData, xLength, &ulRemainingLength, &xHeaderLength ) != eMqttOk )
+    {
+        return pdFALSE;
+    }
+
+    return ( ulRemainingLength <= ( xLength - xHeaderLength ) ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+MqttStatus_t xMqttDecoderFeed( MqttDecoder_t * pxDecoder,
+                               const uint8_t * pucData,
+                               size_t xLength )
+{
+    MqttPacketInfo_t * pxInfo = &( pxDecoder->xInfo );
+    const MqttHandler_t * pxHandler;
+    MqttStatus_t xStatus = pxDecoder->xError;
+    size_t xTarget, xCopy, xHeaderLength;
+    uint32_t ulRemainingLength;
+    uint8_t ucByte;
+
+    while( ( xLength > 0U ) && ( xStatus == eMqttOk ) )
+    {
+        switch( pxDecoder->ucState )
+        {
+            case mqttSTATE_FIXED_HEADER:
+                xStatus = xMqttParseFixedHeader( pucData, xLength, &ulRemainingLength, &xHeaderLength );
+
+                if( ( xStatus != eMqttOk ) && ( xStatus != eMqttIncomplete ) )
+                {
+                    ( void ) prvSetError( pxDecoder, xStatus );
+                    break;
+                }
+
+                ucByte = pucData[ 0 ];
+                memset( pxInfo, 0, sizeof( *pxInfo ) );
+                pxInfo->ucType = ( uint8_t ) ( ucByte >> 4 );
+                pxInfo->ucFlags = ( uint8_t ) ( ucByte & 0x0FU );
+
+                if( pxInfo->ucType == mqttPUBLISH )
+                {
+                    pxInfo->ucQoS = ( uint8_t ) ( ( pxInfo->ucFlags >> 1 ) & 0x03U );
+                }
+
+                if( xStatus == eMqttOk )
+                {
+                    /* The whole fixed header is in this chunk. */
+                    pxDecoder->ulRemaining = ulRemainingLength;
+                    pucData += xHeaderLength;
+                    xLength -= xHeaderLength;
+                    xStatus = prvStartPacketBody( pxDecoder );
+                }
+                else
+                {
+                    /* The Remaining Length continues in a later chunk, so
+                     * decode it a byte at a time. */
+                    pucData++;
+                    xLength--;
+                    xStatus = eMqttOk;
+                    pxDecoder->ulRemaining = 0;
+                    pxDecoder->ucLengthBytes = 0;
+                    pxDecoder->ucLengthShift = 0;
+                    pxDecoder->ucState = mqttSTATE_REMAINING_LENGTH;
+                }
+
+                break;
+
+            case mqttSTATE_REMAINING_LENGTH:
+                ucByte = *pucData++;
+                xLength--;
+
+                pxDecoder->ulRemaining |= ( uint32_t ) ( ucByte & 0x7FU ) << pxDecoder->ucLengthShift;
+                pxDecoder->ucLengthShift += 7U;
+                pxDecoder->ucLengthBytes++;
+
+                if( ( ucByte & 0x80U ) == 0U )
+                {
+                    xStatus = prvStartPacketBody( pxDecoder );
+                }
+                else if( pxDecoder->ucLengthBytes >= mqttMAX_LENGTH_BYTES )
+                {
+                    xStatus = prvSetError( pxDecoder, eMqttErrorRemainingLength );
+                }
+                else
+                {
+                    /* More length bytes to come. */
+                }
+
+                break;
+
+            case mqttSTATE_VARIABLE_HEADER:
+
+                if( pxDecoder->xHeaderCount == 0U )
+                {
+                    /* Use the caller's buffer directly when the whole
+                     * variable header is in it. */
+                    xTarget = prvVariableHeaderLength( pxInfo, pucData, xLength );
+
+                    if( ( xTarget != 0U ) && ( xTarget <= xLength ) )
+                    {
+                        if( xTarget > pxInfo->ulRemainingLength )
+                        {
+                            xStatus = prvSetError( pxDecoder, eMqttErrorVariableHeader );
+                            break;
+                        }
+
+                        xStatus = prvVariableHeaderComplete( pxDecoder, pucData, xTarget );
+                        pucData += xTarget;
+                        xLength -= xTarget;
+                        break;
+                    }
+                }
+
+                /* Split across chunks, so reassemble it.  Until the length
+                 * prefix is complete only the first two bytes are needed. */
+                xTarget = prvVariableHeaderLength( pxInfo, pxDecoder->ucHeader, pxDecoder->xHeaderCount );
+
+                if( xTarget == 0U )
+                {
+                    xTarget = 2U;
+                }
+
+                if( xTarget > pxInfo->ulRemainingLength )
+                {
+                    xStatus = prvSetError( pxDecoder, eMqttErrorVariableHeader );
+                    break;
+                }
+
+                if( xTarget > mqttMAX_VARIABLE_HEADER )
+                {
+                    xStatus = prvSetError( pxDecoder, eMqttErrorVariableHeaderSize );
+                    break;
+                }
+
+                xCopy = xTarget - pxDecoder->xHeaderCount;
+
+                if( xCopy > xLength )
+                {
+                    xCopy = xLength;
+                }
+
+                memcpy( &( pxDecoder->ucHeader[ pxDecoder->xHeaderCount ] ), pucData, xCopy );
+                pxDecoder->xHeaderCount += xCopy;
+                pucData += xCopy;
+                xLength -= xCopy;
+
+                /* Having reached the provisional target, the real length may
+                 * now be known to be longer. */
+                if( ( pxDecoder->xHeaderCount == xTarget ) &&
+                    ( prvVariableHeaderLength( pxInfo, pxDecoder->ucHeader, pxDecoder->xHeaderCount ) == xTarget ) )
+                {
+                    xStatus = prvVariableHeaderComplete( pxDecoder, pxDecoder->ucHeader, xTarget );
+                }
+
+                break;
+
+            case mqttSTATE_PAYLOAD:
+                xCopy = ( xLength < pxDecoder->ulRemaining ) ? xLength : ( size_t ) pxDecoder->ulRemaining;
+                pxHandler = prvGetHandler( pxDecoder );
+
+                if( ( pxHandler != NULL ) && ( pxHandler->pxOnPayload != NULL ) )
+                {
+                    pxHandler->pxOnPayload( pxDecoder->pvContext, pxInfo, pucData, xCopy, pxDecoder->ulPayloadOffset );
+                }
+
+                pxDecoder->ulPayloadOffset += ( uint32_t ) xCopy;
+                pxDecoder->ulRemaining -= ( uint32_t ) xCopy;
+                pucData += xCopy;
+                xLength -= xCopy;
+
+                if( pxDecoder->ulRemaining == 0UL )
+                {
+                    prvPacketComplete( pxDecoder );
+                }
+
+                break;
+
+            default:
+                /* Error state - discard everything until reset. */
+                xStatus = pxDecoder->xError;
+                break;
+        }
+    }
+
+    return xStatus;
+}
+/*-----------------------------------------------------------*/
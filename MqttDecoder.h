@@ -0,0 +1,182 @@
+/*
+ * Incremental MQTT 3.1.1 packet decoder.
+ *
+ * Bytes are pushed into the decoder as they arrive, in chunks of any size,
+ * and each byte is examined once.  A packet can span any number of chunks, so
+ * packets are not limited by the size of the receive buffers.
+ *
+ * For every packet the decoder calls up to three functions from the handler
+ * registered for its control packet type:
+ *
+ * - pxOnHeader once the fixed header and variable header have been parsed,
+ *   with the packet type, flags, QoS, packet identifier and (for PUBLISH) the
+ *   topic.
+ * - pxOnPayload for each fragment of the payload, pointing straight into the
+ *   caller's buffer, so the payload is never copied.
+ * - pxOnComplete when the last byte of the packet has been consumed.
+ *
+ * Pointers passed to the handlers (the topic, variable header and payload
+ * slices) are only valid for the duration of the call.  The variable header
+ * normally also points into the caller's buffer, and is only copied into the
+ * decoder when it is split across two chunks, so it is limited to
+ * mqttMAX_VARIABLE_HEADER bytes.
+ *
+ * Protocol errors put the decoder into an error state in which all further
+ * input is discarded until vMqttDecoderReset() is called.  A byte stream
+ * cannot be resynchronised once framing is lost, so the usual response is to
+ * close the connection.
+ */
+
+#ifndef MQTT_DECODER_H
+#define MQTT_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+/* Largest variable header that can be reassembled when split across chunks.
+ * In practice this bounds the length of PUBLISH topics. */
+#ifndef mqttMAX_VARIABLE_HEADER
+    #define mqttMAX_VARIABLE_HEADER    ( 128U )
+#endif
+
+/* Control packet types, from bits 7..4 of the first byte. */
+#define mqttCONNECT            ( 1U )
+#define mqttCONNACK            ( 2U )
+#define mqttPUBLISH            ( 3U )
+#define mqttPUBACK             ( 4U )
+#define mqttPUBREC             ( 5U )
+#define mqttPUBREL             ( 6U )
+#define mqttPUBCOMP            ( 7U )
+#define mqttSUBSCRIBE          ( 8U )
+#define mqttSUBACK             ( 9U )
+#define mqttUNSUBSCRIBE        ( 10U )
+#define mqttUNSUBACK           ( 11U )
+#define mqttPINGREQ            ( 12U )
+#define mqttPINGRESP           ( 13U )
+#define mqttDISCONNECT         ( 14U )
+#define mqttNUMBER_OF_TYPES    ( 16U )
+
+typedef enum
+{
+    eMqttOk = 0,                   /* All input consumed, no error. */
+    eMqttErrorPacketType,          /* Reserved control packet type (0 or 15). */
+    eMqttErrorFlags,               /* Reserved fixed header flags set, or QoS 3. */
+    eMqttErrorRemainingLength,     /* Remaining Length longer than 4 bytes. */
+    eMqttErrorVariableHeader,      /* Variable header inconsistent with the Remaining Length. */
+    eMqttErrorVariableHeaderSize,  /* Split variable header larger than mqttMAX_VARIABLE_HEADER. */
+    eMqttErrorRejected,            /* A pxOnHeader handler returned pdFALSE. */
+    eMqttIncomplete                /* xMqttParseFixedHeader() needs more bytes. */
+} MqttStatus_t;
+
+/* A view of bytes owned by someone else. */
+typedef struct MqttSlice
+{
+    const uint8_t * pucData;
+    size_t xLength;
+} MqttSlice_t;
+
+typedef struct MqttPacketInfo
+{
+    uint8_t ucType;
+    uint8_t ucFlags;             /* Bits 3..0 of the first byte. */
+    uint8_t ucQoS;               /* PUBLISH only, otherwise 0. */
+    BaseType_t xHasPacketId;
+    uint16_t usPacketId;
+    uint32_t ulRemainingLength;
+    uint32_t ulPayloadLength;    /* Remaining Length less the variable header. */
+    MqttSlice_t xVariableHeader;
+    MqttSlice_t xTopic;          /* PUBLISH only, otherwise empty. */
+} MqttPacketInfo_t;
+
+typedef struct MqttHandler
+{
+    /* Called once per packet after the variable header.  Return pdFALSE to
+     * reject the packet, which puts the decoder into the error state.  May be
+     * NULL. */
+    BaseType_t ( * pxOnHeader )( void * pvContext,
+                                 const MqttPacketInfo_t * pxInfo );
+
+    /* Called for each payload fragment, ulOffset being the position of the
+     * fragment within the payload.  May be NULL. */
+    void ( * pxOnPayload )( void * pvContext,
+                            const MqttPacketInfo_t * pxInfo,
+                            const uint8_t * pucFragment,
+                            size_t xLength,
+                            uint32_t ulOffset );
+
+    /* Called once the whole packet has been consumed.  May be NULL. */
+    void ( * pxOnComplete )( void * pvContext,
+                             const MqttPacketInfo_t * pxInfo );
+} MqttHandler_t;
+
+typedef struct MqttDecoder
+{
+    /* Handlers indexed by control packet type, NULL entries are skipped. */
+    const MqttHandler_t * const * ppxHandlers;
+    void * pvContext;
+
+    uint8_t ucState;
+    uint8_t ucLengthBytes;
+    uint8_t ucLengthShift;
+    MqttStatus_t xError;
+    uint32_t ulRemaining;        /* Bytes of the current packet not yet consumed. */
+    uint32_t ulPayloadOffset;
+    size_t xHeaderCount;         /* Bytes held in ucHeader. */
+    MqttPacketInfo_t xInfo;
+    uint8_t ucHeader[ mqttMAX_VARIABLE_HEADER ];
+
+    /* Statistics. */
+    uint32_t ulPackets;
+    uint32_t ulErrors;
+} MqttDecoder_t;
+
+/*
+ * Prepare pxDecoder to decode a new stream.  ppxHandlers is an array of
+ * mqttNUMBER_OF_TYPES handler pointers, indexed by control packet type, and
+ * pvContext is passed to every handler.
+ */
+void vMqttDecoderInit( MqttDecoder_t * pxDecoder,
+                       const MqttHandler_t * const * ppxHandlers,
+                       void * pvContext );
+
+/*
+ * Discard any partly decoded packet and clear the error state, keeping the
+ * handlers and statistics.
+ */
+void vMqttDecoderReset( MqttDecoder_t * pxDecoder );
+
+/*
+ * Decode xLength bytes from pucData, calling the handlers for any packets or
+ * parts of packets they contain.  Returns eMqttOk, or the error that stopped
+ * decoding - in which case the rest of the input was discarded.
+ */
+MqttStatus_t xMqttDecoderFeed( MqttDecoder_t * pxDecoder,
+                               const uint8_t * pucData,
+                               size_t xLength );
+
+/*
+ * Fast path check of the fixed header at the start of pucData, for use when
+ * the whole header is likely to be in one buffer.  The first byte is checked
+ * against a 256 entry table of valid type and flags combinations, and the
+ * Remaining Length is decoded without a loop, so a malformed header is
+ * rejected in a bounded number of cycles.  On success the Remaining Length
+ * and the size of the fixed header (2 to 5 bytes) are returned through the
+ * pointers.  Returns eMqttIncomplete if xLength ends inside a valid header.
+ */
+MqttStatus_t xMqttParseFixedHeader( const uint8_t * pucData,
+                                    size_t xLength,
+                                    uint32_t * pulRemainingLength,
+                                    size_t * pxHeaderLength );
+
+/*
+ * pdTRUE if pucData starts with a valid fixed header whose Remaining Length
+ * fits in the xLength bytes available.  Replaces the loop based
+ * isMqttPacket() check that used to be in main.c, and additionally rejects
+ * reserved flag combinations.
+ */
+BaseType_t xMqttIsPacket( const uint8_t * pucData,
+                          size_t xLength );
+
+#endif /* MQTT_DECODER_H */
@@ -0,0 +1,95 @@
+/*
+ * Zero copy receive ring of fixed size packet slots.  See PacketRing.h.
+ */
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+
+/* Application includes. */
+#include "PacketRing.h"
+
+#define ringINDEX( ulCount )    ( ( ulCount ) & ( ringSLOT_COUNT - 1U ) )
+
+/*-----------------------------------------------------------*/
+
+void vPacketRingInit( PacketRing_t * pxRing )
+{
+    pxRing->ulHead = 0;
+    pxRing->ulTail = 0;
+    pxRing->ulDropped = 0;
+}
+/*-----------------------------------------------------------*/
+
+uint8_t * pucPacketRingAcquire( PacketRing_t * pxRing )
+{
+    uint32_t ulHead = pxRing->ulHead;
+
+    if( ( ulHead - pxRing->ulTail ) >= ( uint32_t ) ringSLOT_COUNT )
+    {
+        pxRing->ulDropped++;
+        return NULL;
+    }
+
+    return pxRing->xSlots[ ringINDEX( ulHead ) ].ucData;
+}
+/*-----------------------------------------------------------*/
+
+void vPacketRingCommit( PacketRing_t * pxRing,
+                        size_t xLength )
+{
+    uint32_t ulHead = pxRing->ulHead;
+
+    configASSERT( xLength <= ringSLOT_SIZE );
+
+    pxRing->xSlots[ ringINDEX( ulHead ) ].xLength = xLength;
+
+    /* The packet must be complete before the consumer can see it. */
+    portMEMORY_BARRIER();
+    pxRing->ulHead = ulHead + 1UL;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPacketRingPeek( PacketRing_t * pxRing,
+                        PacketView_t * pxViews,
+                        size_t xMaxViews )
+{
+    uint32_t ulTail = pxRing->ulTail;
+    uint32_t ulAvailable = pxRing->ulHead - ulTail;
+    size_t x;
+
+    /* Do not read the slots before the head that published them. */
+    portMEMORY_BARRIER();
+
+    if( ulAvailable < xMaxViews )
+    {
+        xMaxViews = ( size_t ) ulAvailable;
+    }
+
+    for( x = 0; x < xMaxViews; x++ )
+    {
+        const PacketSlot_t * pxSlot = &( pxRing->xSlots[ ringINDEX( ulTail + x ) ] );
+
+        pxViews[ x ].pucData = pxSlot->ucData;
+        pxViews[ x ].xLength = pxSlot->xLength;
+    }
+
+    return xMaxViews;
+}
+/*-----------------------------------------------------------*/
+
+void vPacketRingRelease( PacketRing_t * pxRing,
+                         size_t xCount )
+{
+    configASSERT( xCount <= xPacketRingCount( pxRing ) );
+
+    /* Finish with the slots before the producer can reuse them. */
+    portMEMORY_BARRIER();
+    pxRing->ulTail = pxRing->ulTail + ( uint32_t ) xCount;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPacketRingCount( const PacketRing_t * pxRing )
+{
+    return ( size_t ) ( pxRing->ulHead - pxRing->ulTail );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,102 @@
+/*
+ * Zero copy receive ring of fixed size packet slots.
+ *
+ * The producer (a network driver, or an interrupt) is given a pointer to a
+ * free slot, writes the packet straight into it and commits it with its
+ * length.  The consumer asks for views - pointer and length pairs - of every
+ * committed packet, processes them in place and then releases the slots back
+ * to the producer.  Packets are never copied by the ring itself.
+ *
+ * There must be exactly one producer and one consumer.  Each index is only
+ * written by one side so no locking is needed, and the producer side functions
+ * can be called from an interrupt.  When the ring is full the producer's
+ * acquire fails and the packet is counted as dropped, so a slow consumer never
+ * stalls the producer.
+ */
+
+#ifndef PACKET_RING_H
+#define PACKET_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+/* Number of slots.  Must be a power of two. */
+#ifndef ringSLOT_COUNT
+    #define ringSLOT_COUNT    ( 8U )
+#endif
+
+/* Largest packet a slot can hold. */
+#ifndef ringSLOT_SIZE
+    #define ringSLOT_SIZE     ( 256U )
+#endif
+
+#if ( ( ringSLOT_COUNT & ( ringSLOT_COUNT - 1U ) ) != 0 )
+    #error ringSLOT_COUNT must be a power of two
+#endif
+
+typedef struct PacketSlot
+{
+    size_t xLength;
+    uint8_t ucData[ ringSLOT_SIZE ];
+} PacketSlot_t;
+
+typedef struct PacketRing
+{
+    /* ulHead and ulDropped are only written by the producer, ulTail only by
+     * the consumer.  Both indexes are free running. */
+    volatile uint32_t ulHead;
+    volatile uint32_t ulTail;
+    volatile uint32_t ulDropped;
+    PacketSlot_t xSlots[ ringSLOT_COUNT ];
+} PacketRing_t;
+
+/* A committed packet, as seen by the consumer. */
+typedef struct PacketView
+{
+    const uint8_t * pucData;
+    size_t xLength;
+} PacketView_t;
+
+/*
+ * Empty the ring.  Must not be called while either side is using it.
+ */
+void vPacketRingInit( PacketRing_t * pxRing );
+
+/*
+ * Producer: return the data area of the next free slot, which can hold
+ * ringSLOT_SIZE bytes, or NULL (and count a drop) if the ring is full.  The
+ * slot is not visible to the consumer until vPacketRingCommit() is called.
+ */
+uint8_t * pucPacketRingAcquire( PacketRing_t * pxRing );
+
+/*
+ * Producer: publish the slot returned by the last successful call to
+ * pucPacketRingAcquire() as a packet of xLength bytes.
+ */
+void vPacketRingCommit( PacketRing_t * pxRing,
+                        size_t xLength );
+
+/*
+ * Consumer: fill pxViews with up to xMaxViews of the oldest committed packets
+ * and return how many were filled.  The packets stay in the ring, and the
+ * views stay valid, until they are released.
+ */
+size_t xPacketRingPeek( PacketRing_t * pxRing,
+                        PacketView_t * pxViews,
+                        size_t xMaxViews );
+
+/*
+ * Consumer: hand the xCount oldest packets back to the producer.  xCount must
+ * not be more than the number returned by the last xPacketRingPeek().
+ */
+void vPacketRingRelease( PacketRing_t * pxRing,
+                         size_t xCount );
+
+/*
+ * Number of committed packets waiting for the consumer.
+ */
+size_t xPacketRingCount( const PacketRing_t * pxRing );
+
+#endif /* PACKET_RING_H */
@@ -0,0 +1,255 @@
+/*
+ * Per task CPU usage, stack and context switch statistics.  See
+ * RunTimeStats.h.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Library includes. */
+#include "SMM_MPS2.h"
+
+/* Application includes. */
+#include "RunTimeStats.h"
+
+#if ( ( rtsSWITCH_TABLE_SIZE & ( rtsSWITCH_TABLE_SIZE - 1U ) ) != 0U )
+    #error rtsSWITCH_TABLE_SIZE must be a power of two
+#endif
+
+#define rtsSWITCH_INDEX_MASK    ( rtsSWITCH_TABLE_SIZE - 1U )
+
+/* Context switches of one task since the previous report, in an open
+ * addressed table keyed by the task handle. */
+typedef struct SwitchCount
+{
+    void * pvTask;
+    uint32_t ulSwitches;
+} SwitchCount_t;
+
+/* The run time counter of one task at the previous report. */
+typedef struct PreviousRunTime
+{
+    TaskHandle_t xHandle;
+    UBaseType_t xTaskNumber;
+    configRUN_TIME_COUNTER_TYPE ulRunTime;
+} PreviousRunTime_t;
+
+/* Written by the kernel on every context switch. */
+static SwitchCount_t xSwitchCounts[ rtsSWITCH_TABLE_SIZE ];
+static uint32_t ulSwitchesUncounted = 0;
+
+/* Only used by vRunTimeStatsPrint(), static to keep them off the caller's
+ * stack. */
+static SwitchCount_t xSwitchSnapshot[ rtsSWITCH_TABLE_SIZE ];
+static TaskStatus_t xTaskStatus[ rtsMAX_TASKS ];
+static PreviousRunTime_t xPrevious[ rtsMAX_TASKS ];
+static UBaseType_t uxPreviousCount = 0;
+static configRUN_TIME_COUNTER_TYPE ulPreviousTotal = 0;
+
+/*
+ * The first slot to probe for pvTask.  TCBs are 8 byte aligned.
+ */
+static size_t prvSwitchIndex( const void * pvTask );
+
+/*
+ * The switches recorded for xHandle in xSwitchSnapshot.
+ */
+static uint32_t prvSnapshotSwitches( TaskHandle_t xHandle );
+
+/*
+ * The run time counter of the task at the previous report, or 0 if the task
+ * did not exist then.
+ */
+static configRUN_TIME_COUNTER_TYPE prvPreviousRunTime( const TaskStatus_t * pxStatus );
+
+/*-----------------------------------------------------------*/
+
+void vRunTimeStatsConfigureTimer( void )
+{
+    CMSDK_DUALTIMER1->TimerControl = 0;
+    CMSDK_DUALTIMER1->TimerIntClr = CMSDK_DUALTIMER1_INTCLR_Msk;
+    CMSDK_DUALTIMER1->TimerLoad = 0xFFFFFFFFUL;
+
+    /* Free running 32 bit down counter, prescaled by 16, no interrupt. */
+    CMSDK_DUALTIMER1->TimerControl = CMSDK_DUALTIMER1_CTRL_EN_Msk |
+                                     CMSDK_DUALTIMER1_CTRL_SIZE_Msk |
+                                     ( 1UL << CMSDK_DUALTIMER1_CTRL_PRESCALE_Pos );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulRunTimeStatsGetCounter( void )
+{
+    /* Turn the down count into an up count. */
+    return 0xFFFFFFFFUL - CMSDK_DUALTIMER1->TimerValue;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvSwitchIndex( const void * pvTask )
+{
+    return ( size_t ) ( ( ( uint32_t ) pvTask >> 3 ) & rtsSWITCH_INDEX_MASK );
+}
+/*-----------------------------------------------------------*/
+
+void vRunTimeStatsTaskSwitchedOut( void * pvTask )
+{
+    size_t xIndex = prvSwitchIndex( pvTask ), xProbe;
+    SwitchCount_t * pxCount;
+
+    for( xProbe = 0; xProbe < rtsSWITCH_TABLE_SIZE; xProbe++ )
+    {
+        pxCount = &( xSwitchCounts[ xIndex ] );
+
+        if( pxCount->pvTask == pvTask )
+        {
+            pxCount->ulSwitches++;
+            return;
+        }
+
+        if( pxCount->pvTask == NULL )
+        {
+            pxCount->pvTask = pvTask;
+            pxCount->ulSwitches = 1;
+            return;
+        }
+
+        xIndex = ( xIndex + 1U ) & rtsSWITCH_INDEX_MASK;
+    }
+
+    /* More tasks ran in the interval than the table has slots. */
+    ulSwitchesUncounted++;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvSnapshotSwitches( TaskHandle_t xHandle )
+{
+    size_t xIndex = prvSwitchIndex( xHandle ), xProbe;
+
+    for( xProbe = 0; xProbe < rtsSWITCH_TABLE_SIZE; xProbe++ )
+    {
+        if( xSwitchSnapshot[ xIndex ].pvTask == ( void * ) xHandle )
+        {
+            return xSwitchSnapshot[ xIndex ].ulSwitches;
+        }
+
+        if( xSwitchSnapshot[ xIndex ].pvTask == NULL )
+        {
+            break;
+        }
+
+        xIndex = ( xIndex + 1U ) & rtsSWITCH_INDEX_MASK;
+    }
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+static configRUN_TIME_COUNTER_TYPE prvPreviousRunTime( const TaskStatus_t * pxStatus )
+{
+    UBaseType_t x;
+
+    for( x = 0; x < uxPreviousCount; x++ )
+    {
+        /* A new task can be given the TCB of a deleted one, but not its
+         * number. */
+        if( ( xPrevious[ x ].xHandle == pxStatus->xHandle ) &&
+            ( xPrevious[ x ].xTaskNumber == pxStatus->xTaskNumber ) )
+        {
+            return xPrevious[ x ].ulRunTime;
+        }
+    }
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+void vRunTimeStatsPrint( void )
+{
+    configRUN_TIME_COUNTER_TYPE ulTotal, ulInterval, ulTaskTime, ulIdleTime = 0;
+    uint32_t ulTenths, ulSwitches, ulTotalSwitches = 0, ulUncounted;
+    TaskHandle_t xIdle = xTaskGetIdleTaskHandle();
+    UBaseType_t uxCount, x;
+
+    /* No context switch can happen while the scheduler is suspended, so the
+     * switch counts cover exactly the same interval as the run times. */
+    vTaskSuspendAll();
+    {
+        uxCount = uxTaskGetSystemState( xTaskStatus, rtsMAX_TASKS, &ulTotal );
+
+        taskENTER_CRITICAL();
+        {
+            memcpy( xSwitchSnapshot, xSwitchCounts, sizeof( xSwitchSnapshot ) );
+            memset( xSwitchCounts, 0, sizeof( xSwitchCounts ) );
+            ulUncounted = ulSwitchesUncounted;
+            ulSwitchesUncounted = 0;
+        }
+        taskEXIT_CRITICAL();
+    }
+    ( void ) xTaskResumeAll();
+
+    if( uxCount == 0U )
+    {
+        printf( "Stats: more than %u tasks, raise rtsMAX_TASKS\n", ( unsigned ) rtsMAX_TASKS );
+        uxPreviousCount = 0;
+        return;
+    }
+
+    ulInterval = ulTotal - ulPreviousTotal;
+
+    if( ulInterval == 0U )
+    {
+        /* Avoids dividing by zero if called twice within a count. */
+        ulInterval = 1;
+    }
+
+    for( x = 0; x < uxCount; x++ )
+    {
+        ulTotalSwitches += prvSnapshotSwitches( xTaskStatus[ x ].xHandle );
+
+        if( xTaskStatus[ x ].xHandle == xIdle )
+        {
+            ulIdleTime = xTaskStatus[ x ].ulRunTimeCounter - prvPreviousRunTime( &( xTaskStatus[ x ] ) );
+        }
+    }
+
+    ulTenths = ( uint32_t ) ( ( ( uint64_t ) ( ulInterval - ulIdleTime ) * 1000U ) / ulInterval );
+    printf( "Stats: %u ms, cpu load %u.%u%%, %u switches\n",
+            ( unsigned ) ( ulInterval / ( rtsCOUNTER_HZ / 1000UL ) ),
+            ( unsigned ) ( ulTenths / 10U ),
+            ( unsigned ) ( ulTenths % 10U ),
+            ( unsigned ) ( ulTotalSwitches + ulUncounted ) );
+
+    for( x = 0; x < uxCount; x++ )
+    {
+        ulTaskTime = xTaskStatus[ x ].ulRunTimeCounter - prvPreviousRunTime( &( xTaskStatus[ x ] ) );
+        ulTenths = ( uint32_t ) ( ( ( uint64_t ) ulTaskTime * 1000U ) / ulInterval );
+        ulSwitches = prvSnapshotSwitches( xTaskStatus[ x ].xHandle );
+
+        printf( "Stats:   %-12s %3u.%u%% stack %4u switches %u\n",
+                xTaskStatus[ x ].pcTaskName,
+                ( unsigned ) ( ulTenths / 10U ),
+                ( unsigned ) ( ulTenths % 10U ),
+                ( unsigned ) xTaskStatus[ x ].usStackHighWaterMark,
+                ( unsigned ) ulSwitches );
+    }
+
+    if( ulUncounted != 0U )
+    {
+        printf( "Stats:   %u switches not attributed, raise rtsSWITCH_TABLE_SIZE\n", ( unsigned ) ulUncounted );
+    }
+
+    /* Remember the counters for the next interval. */
+    for( x = 0; x < uxCount; x++ )
+    {
+        xPrevious[ x ].xHandle = xTaskStatus[ x ].xHandle;
+        xPrevious[ x ].xTaskNumber = xTaskStatus[ x ].xTaskNumber;
+        xPrevious[ x ].ulRunTime = xTaskStatus[ x ].ulRunTimeCounter;
+    }
+
+    uxPreviousCount = uxCount;
+    ulPreviousTotal = ulTotal;
+}
+/*-----------------------------------------------------------*/
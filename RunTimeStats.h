@@ -0,0 +1,68 @@
+/*
+ * Per task CPU usage, stack and context switch statistics.
+ *
+ * FreeRTOSConfig.h enables configGENERATE_RUN_TIME_STATS with the run time
+ * counter defined here: timer 1 of the CMSDK dual timer, free running from the
+ * 25 MHz peripheral clock divided by 16.  Its 1.5625 MHz rate is well above
+ * the tick rate, as the kernel needs for the per task figures to be
+ * meaningful, and the 32 bit count wraps only every 45 minutes.  Neither the
+ * SysTick nor the DWT is touched, so the counter is unaffected by the tick
+ * being stopped and by TaskTiming.c's use of the cycle counter.
+ *
+ * FreeRTOSConfig.h also points traceTASK_SWITCHED_OUT() at
+ * vRunTimeStatsTaskSwitchedOut(), which counts the times each task gives up
+ * the CPU.  The kernel keeps no such count of its own.
+ *
+ * vRunTimeStatsPrint() prints, for the interval since its previous call, the
+ * share of CPU time used by each task, the overall CPU load (the time not
+ * spent in the idle task), each task's context switches and its stack high
+ * water mark.  Calling it periodically gives a continuous monitor at the
+ * caller's rate.
+ */
+
+#ifndef RUN_TIME_STATS_H
+#define RUN_TIME_STATS_H
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+/* Most tasks that can be reported.  If more exist vRunTimeStatsPrint() says so
+ * instead of printing the statistics. */
+#ifndef rtsMAX_TASKS
+    #define rtsMAX_TASKS               ( 64U )
+#endif
+
+/* Slots in the context switch count table, a power of two larger than the
+ * number of tasks that exist at any one time. */
+#ifndef rtsSWITCH_TABLE_SIZE
+    #define rtsSWITCH_TABLE_SIZE       ( 128U )
+#endif
+
+#define rtsCOUNTER_PRESCALE            ( 16UL )
+#define rtsCOUNTER_HZ                  ( configCPU_CLOCK_HZ / rtsCOUNTER_PRESCALE )
+
+/*
+ * Start the run time counter.  Called by the kernel through
+ * portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() when the scheduler starts.
+ */
+void vRunTimeStatsConfigureTimer( void );
+
+/*
+ * The run time counter, through portGET_RUN_TIME_COUNTER_VALUE().
+ */
+uint32_t ulRunTimeStatsGetCounter( void );
+
+/*
+ * Count a context switch away from pvTask.  Called by the kernel through
+ * traceTASK_SWITCHED_OUT(), with interrupts masked.
+ */
+void vRunTimeStatsTaskSwitchedOut( void * pvTask );
+
+/*
+ * Print the statistics of every task for the interval since the previous
+ * call, or since the scheduler started on the first call.
+ */
+void vRunTimeStatsPrint( void );
+
+#endif /* RUN_TIME_STATS_H */
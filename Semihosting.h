@@ -0,0 +1,41 @@
+/*
+ * Minimal Arm semihosting calls, for talking to QEMU (started with
+ * "-semihosting-config enable=on,target=native") or a debugger.
+ *
+ * Each call is a BKPT 0xAB with the operation number in r0 and a pointer to
+ * its parameter block in r1, and returns its result in r0.  Without a host to
+ * service it the BKPT is taken as a hard fault, so only call these from code
+ * that is built for a semihosting run (see Verdict.h and Coverage.h).
+ */
+
+#ifndef SEMIHOSTING_H
+#define SEMIHOSTING_H
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+/* Operations, from the Arm semihosting specification. */
+#define semihostingSYS_OPEN             ( 0x01UL )
+#define semihostingSYS_CLOSE            ( 0x02UL )
+#define semihostingSYS_WRITE            ( 0x05UL )
+#define semihostingSYS_EXIT_EXTENDED    ( 0x20UL )
+
+/* SYS_OPEN mode for fopen( name, "wb" ). */
+#define semihostingOPEN_MODE_WB         ( 5UL )
+
+/* SYS_EXIT_EXTENDED reason for a normal end of the application. */
+#define semihostingADP_STOPPED_APPLICATION_EXIT    ( 0x20026UL )
+
+static portFORCE_INLINE int32_t lSemihostingCall( uint32_t ulOperation,
+                                                  volatile uint32_t * pulParameters )
+{
+    register uint32_t ulR0 __asm( "r0" ) = ulOperation;
+    register volatile uint32_t * pulR1 __asm( "r1" ) = pulParameters;
+
+    __asm volatile ( "bkpt 0xAB" : "+r" ( ulR0 ) : "r" ( pulR1 ) : "memory" );
+
+    return ( int32_t ) ulR0;
+}
+
+#endif /* SEMIHOSTING_H */
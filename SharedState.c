@@ -0,0 +1,87 @@
+/*
+ * Single writer, multiple reader shared state without locks.  See
+ * SharedState.h.
+ */
+
+#include <string.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+
+/* Application includes. */
+#include "SharedState.h"
+
+/*-----------------------------------------------------------*/
+
+void vSharedStateInit( SharedState_t * pxState,
+                       void * pvStorage,
+                       size_t xSize,
+                       const void * pvInitial )
+{
+    pxState->ulSequence = 0;
+    pxState->xSize = xSize;
+    pxState->pucSlots = ( uint8_t * ) pvStorage;
+    pxState->ulRetries = 0;
+
+    if( pvInitial != NULL )
+    {
+        memcpy( pxState->pucSlots, pvInitial, xSize );
+    }
+    else
+    {
+        memset( pxState->pucSlots, 0, xSize );
+    }
+}
+/*-----------------------------------------------------------*/
+
+void * pvSharedStateBeginWrite( SharedState_t * pxState )
+{
+    /* Only the writer changes ulSequence, so it is stable here. */
+    return &( pxState->pucSlots[ ( ( pxState->ulSequence + 1UL ) & 1UL ) * pxState->xSize ] );
+}
+/*-----------------------------------------------------------*/
+
+void vSharedStateEndWrite( SharedState_t * pxState )
+{
+    /* The slot must be complete before readers are directed to it. */
+    portMEMORY_BARRIER();
+    pxState->ulSequence = pxState->ulSequence + 1UL;
+}
+/*-----------------------------------------------------------*/
+
+void vSharedStatePublish( SharedState_t * pxState,
+                          const void * pvValue )
+{
+    memcpy( pvSharedStateBeginWrite( pxState ), pvValue, pxState->xSize );
+    vSharedStateEndWrite( pxState );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulSharedStateRead( SharedState_t * pxState,
+                            void * pvValue )
+{
+    uint32_t ulSequence;
+
+    for( ; ; )
+    {
+        ulSequence = pxState->ulSequence;
+        portMEMORY_BARRIER();
+
+        memcpy( pvValue, &( pxState->pucSlots[ ( ulSequence & 1UL ) * pxState->xSize ] ), pxState->xSize );
+
+        portMEMORY_BARRIER();
+
+        /* Once another value has been published the writer is free to start
+         * overwriting the slot just copied, so the copy can only be trusted
+         * if nothing was published while it was being made. */
+        if( pxState->ulSequence == ulSequence )
+        {
+            break;
+        }
+
+        pxState->ulRetries++;
+    }
+
+    return ulSequence;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,81 @@
+/*
+ * Single writer, multiple reader shared state without locks.
+ *
+ * A SharedState_t holds two copies (slots) of a value of any size plus a
+ * publish sequence number.  The writer always fills the slot that readers are
+ * not being directed to, then increments the sequence number to publish it.
+ * A reader copies the slot selected by the sequence number and only has to
+ * retry if the sequence number changed while it was copying.
+ *
+ * Compared with a seqlock that has a single copy, a reader never has to wait
+ * for a write in progress:  if a higher priority reader preempts the writer
+ * part way through an update, the slot it reads is the previously published
+ * one and is untouched by the writer, so the read completes first time.  On a
+ * single core that makes reads from tasks with a higher priority than the
+ * writer wait free.  Lower priority readers can be made to retry, but only by
+ * the writer completing a publish, so the number of retries is bounded by the
+ * publish rate.
+ *
+ * There must only ever be one writer.  The sequence number is updated with a
+ * plain 32-bit store, which is atomic on the Cortex-M3, so no exclusive
+ * accesses (LDREX/STREX) are required.  Readers can be tasks or interrupts.
+ */
+
+#ifndef SHARED_STATE_H
+#define SHARED_STATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+typedef struct SharedState
+{
+    /* Number of values published so far.  The current value is in slot
+     * ( ulSequence & 1 ). */
+    volatile uint32_t ulSequence;
+    size_t xSize;
+    uint8_t * pucSlots;
+
+    /* Number of reads that had to be repeated, for diagnostics only. */
+    volatile uint32_t ulRetries;
+} SharedState_t;
+
+/* Bytes of storage to pass to vSharedStateInit() for values of xSize bytes. */
+#define sharedSTATE_STORAGE_SIZE( xSize )    ( 2U * ( xSize ) )
+
+/*
+ * Initialise pxState to hold values of xSize bytes in pvStorage, which must be
+ * sharedSTATE_STORAGE_SIZE( xSize ) bytes and suitably aligned for the value
+ * type (an array of two of the value type is the simplest).  pvInitial is
+ * published as the first value, or the value is zeroed if it is NULL.
+ */
+void vSharedStateInit( SharedState_t * pxState,
+                       void * pvStorage,
+                       size_t xSize,
+                       const void * pvInitial );
+
+/*
+ * Publish a copy of pvValue.  Must only be called by the single writer.
+ */
+void vSharedStatePublish( SharedState_t * pxState,
+                          const void * pvValue );
+
+/*
+ * Zero copy alternative to vSharedStatePublish() for large values.  Returns
+ * the slot that will be published next, which the writer fills in place
+ * before calling vSharedStateEndWrite().  The slot does not hold the current
+ * value, so it must be written in full.
+ */
+void * pvSharedStateBeginWrite( SharedState_t * pxState );
+void vSharedStateEndWrite( SharedState_t * pxState );
+
+/*
+ * Copy the most recently published value into pvValue and return its
+ * sequence number, which a reader can compare with the number returned by an
+ * earlier read to find out if the value has been updated since.
+ */
+uint32_t ulSharedStateRead( SharedState_t * pxState,
+                            void * pvValue );
+
+#endif /* SHARED_STATE_H */
@@ -0,0 +1,298 @@
+/*
+ * Cycle accurate execution time measurement.  See TaskTiming.h.
+ */
+
+#include <stdio.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Library includes. */
+#include "SMM_MPS2.h"
+
+/* Application includes. */
+#include "TaskTiming.h"
+
+/* How long vTimingInit() waits for the cycle counter to move. */
+#define timingPROBE_LOOPS    ( 100U )
+
+/*
+ * Cycle count derived from the tick count and the SysTick down counter, used
+ * when the DWT cycle counter is not available.
+ */
+static uint32_t prvGetSysTickCycles( void );
+
+/*
+ * Histogram bucket for an execution time of ulUs microseconds.
+ */
+static uint32_t prvHistogramBucket( uint32_t ulUs );
+
+static BaseType_t xUseCycleCounter = pdFALSE;
+
+/* Singly linked list of the registered statistics, only ever added to. */
+static TimingStats_t * pxStatsList = NULL;
+
+/*-----------------------------------------------------------*/
+
+void vTimingInit( void )
+{
+    volatile uint32_t ulLoop;
+    uint32_t ulBefore;
+
+    if( ( DWT->CTRL & DWT_CTRL_NOCYCCNT_Msk ) == 0UL )
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+        /* Some models (QEMU included) accept the writes above but leave the
+         * counter at zero, so check it actually counts. */
+        ulBefore = DWT->CYCCNT;
+
+        for( ulLoop = 0; ulLoop < timingPROBE_LOOPS; ulLoop++ )
+        {
+        }
+
+        xUseCycleCounter = ( DWT->CYCCNT != ulBefore ) ? pdTRUE : pdFALSE;
+    }
+
+    printf( "Timing: using %s\n", ( xUseCycleCounter == pdTRUE ) ? "DWT cycle counter" : "SysTick fallback" );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvGetSysTickCycles( void )
+{
+    /* The reload value is only valid once the scheduler has configured the
+     * SysTick, before which every reading is zero. */
+    uint32_t ulReload = SysTick->LOAD + 1UL;
+    uint32_t ulTicks, ulValue;
+    UBaseType_t uxSavedInterruptStatus;
+
+    uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+    {
+        ulTicks = ( uint32_t ) xTaskGetTickCountFromISR();
+        ulValue = SysTick->VAL;
+
+        if( ( SCB->ICSR & SCB_ICSR_PENDSTSET_Msk ) != 0UL )
+        {
+            /* The counter has reloaded but the tick interrupt has not run
+             * yet, so the tick count is one behind.  Read the value again as
+             * the first read may have been taken just before the reload. */
+            ulValue = SysTick->VAL;
+            ulTicks++;
+        }
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+    /* Wraps modulo 2^32 exactly as the real cycle count would. */
+    return ( ulTicks * ulReload ) + ( ( ulReload - 1UL ) - ulValue );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulTimingGetCycles( void )
+{
+    if( xUseCycleCounter == pdTRUE )
+    {
+        return DWT->CYCCNT;
+    }
+
+    return prvGetSysTickCycles();
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xTimingUsesCycleCounter( void )
+{
+    return xUseCycleCounter;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvHistogramBucket( uint32_t ulUs )
+{
+    uint32_t ulBucket;
+
+    if( ulUs == 0UL )
+    {
+        ulBucket = 0;
+    }
+    else
+    {
+        ulBucket = 32UL - ( uint32_t ) __CLZ( ulUs );
+
+        if( ulBucket >= timingHISTOGRAM_BUCKETS )
+        {
+            ulBucket = timingHISTOGRAM_BUCKETS - 1U;
+        }
+    }
+
+    return ulBucket;
+}
+/*-----------------------------------------------------------*/
+
+void vTimingRegister( TimingStats_t * pxStats,
+                      const char * pcName,
+                      uint32_t ulPeriodUs,
+                      uint32_t ulDeadlineUs )
+{
+    uint32_t ulBucket;
+
+    pxStats->pcName = pcName;
+    pxStats->ulPeriodCycles = timingUS_TO_CYCLES( ulPeriodUs );
+    pxStats->ulDeadlineCycles = timingUS_TO_CYCLES( ulDeadlineUs );
+    pxStats->ulCount = 0;
+    pxStats->ulMissed = 0;
+    pxStats->ulMin = UINT32_MAX;
+    pxStats->ulMax = 0;
+    pxStats->ullTotal = 0;
+    pxStats->ulJitterCount = 0;
+    pxStats->ulJitterMax = 0;
+    pxStats->ullJitterTotal = 0;
+    pxStats->ulStart = 0;
+    pxStats->ulLastRelease = 0;
+    pxStats->xReleased = pdFALSE;
+
+    for( ulBucket = 0; ulBucket < timingHISTOGRAM_BUCKETS; ulBucket++ )
+    {
+        pxStats->ulHistogram[ ulBucket ] = 0;
+    }
+
+    taskENTER_CRITICAL();
+    {
+        pxStats->pxNext = pxStatsList;
+        pxStatsList = pxStats;
+    }
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+void vTimingStart( TimingStats_t * pxStats )
+{
+    uint32_t ulNow = ulTimingGetCycles();
+    uint32_t ulInterval, ulJitter;
+
+    if( ( pxStats->xReleased == pdTRUE ) && ( pxStats->ulPeriodCycles != 0UL ) )
+    {
+        ulInterval = ulNow - pxStats->ulLastRelease;
+        ulJitter = ( ulInterval > pxStats->ulPeriodCycles ) ? ( ulInterval - pxStats->ulPeriodCycles ) :
+                   ( pxStats->ulPeriodCycles - ulInterval );
+
+        taskENTER_CRITICAL();
+        {
+            pxStats->ulJitterCount++;
+            pxStats->ullJitterTotal += ulJitter;
+
+            if( ulJitter > pxStats->ulJitterMax )
+            {
+                pxStats->ulJitterMax = ulJitter;
+            }
+        }
+        taskEXIT_CRITICAL();
+    }
+
+    pxStats->xReleased = pdTRUE;
+    pxStats->ulLastRelease = ulNow;
+    pxStats->ulStart = ulNow;
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulTimingStop( TimingStats_t * pxStats )
+{
+    uint32_t ulElapsed = ulTimingGetCycles() - pxStats->ulStart;
+
+    vTimingRecord( pxStats, ulElapsed );
+
+    return ulElapsed;
+}
+/*-----------------------------------------------------------*/
+
+void vTimingRecord( TimingStats_t * pxStats,
+                    uint32_t ulElapsed )
+{
+    uint32_t ulBucket = prvHistogramBucket( timingCYCLES_TO_US( ulElapsed ) );
+
+    /* Keep the statistics consistent for vTimingPrintSummary(), which may run
+     * in a higher priority task. */
+    taskENTER_CRITICAL();
+    {
+        pxStats->ulCount++;
+        pxStats->ullTotal += ulElapsed;
+        pxStats->ulHistogram[ ulBucket ]++;
+
+        if( ulElapsed < pxStats->ulMin )
+        {
+            pxStats->ulMin = ulElapsed;
+        }
+
+        if( ulElapsed > pxStats->ulMax )
+        {
+            pxStats->ulMax = ulElapsed;
+        }
+
+        if( ( pxStats->ulDeadlineCycles != 0UL ) && ( ulElapsed > pxStats->ulDeadlineCycles ) )
+        {
+            pxStats->ulMissed++;
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+void vTimingPrintSummary( void )
+{
+    TimingStats_t * pxStats;
+    TimingStats_t xCopy;
+    uint32_t ulBucket, ulMean, ulJitterMean;
+
+    for( pxStats = pxStatsList; pxStats != NULL; pxStats = pxStats->pxNext )
+    {
+        taskENTER_CRITICAL();
+        {
+            xCopy = *pxStats;
+        }
+        taskEXIT_CRITICAL();
+
+        if( xCopy.ulCount == 0UL )
+        {
+            printf( "Timing: %s not run\n", xCopy.pcName );
+            continue;
+        }
+
+        ulMean = ( uint32_t ) ( xCopy.ullTotal / xCopy.ulCount );
+        ulJitterMean = ( xCopy.ulJitterCount == 0UL ) ? 0UL :
+                       ( uint32_t ) ( xCopy.ullJitterTotal / xCopy.ulJitterCount );
+
+        printf( "Timing: %s n=%u missed=%u exec min/mean/max=%u/%u/%u us jitter mean/max=%u/%u us\n",
+                xCopy.pcName,
+                ( unsigned ) xCopy.ulCount,
+                ( unsigned ) xCopy.ulMissed,
+                ( unsigned ) timingCYCLES_TO_US( xCopy.ulMin ),
+                ( unsigned ) timingCYCLES_TO_US( ulMean ),
+                ( unsigned ) timingCYCLES_TO_US( xCopy.ulMax ),
+                ( unsigned ) timingCYCLES_TO_US( ulJitterMean ),
+                ( unsigned ) timingCYCLES_TO_US( xCopy.ulJitterMax ) );
+
+        for( ulBucket = 0; ulBucket < timingHISTOGRAM_BUCKETS; ulBucket++ )
+        {
+            if( xCopy.ulHistogram[ ulBucket ] == 0UL )
+            {
+                continue;
+            }
+
+            if( ulBucket == 0UL )
+            {
+                printf( "Timing: %s   <1 us: %u\n", xCopy.pcName, ( unsigned ) xCopy.ulHistogram[ ulBucket ] );
+            }
+            else if( ulBucket == ( timingHISTOGRAM_BUCKETS - 1U ) )
+            {
+                printf( "Timing: %s   >=%u us: %u\n", xCopy.pcName, ( unsigned ) ( 1UL << ( ulBucket - 1UL ) ),
+                        ( unsigned ) xCopy.ulHistogram[ ulBucket ] );
+            }
+            else
+            {
+                printf( "Timing: %s   %u-%u us: %u\n", xCopy.pcName, ( unsigned ) ( 1UL << ( ulBucket - 1UL ) ),
+                        ( unsigned ) ( ( 1UL << ulBucket ) - 1UL ), ( unsigned ) xCopy.ulHistogram[ ulBucket ] );
+            }
+        }
+    }
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,125 @@
+/*
+ * Cycle accurate execution time measurement for periodic tasks.
+ *
+ * At configTICK_RATE_HZ 1000 a tick count delta has a resolution of 1 ms,
+ * whereas the work done by each task takes microseconds.  The functions here
+ * time sections of code in CPU cycles instead, using the DWT cycle counter
+ * (DWT->CYCCNT) when it is implemented.  QEMU does not model the DWT, so when
+ * CYCCNT is found not to advance vTimingInit() falls back to a counter built
+ * from the tick count and the current SysTick value, which has a resolution of
+ * one CPU cycle as far as QEMU's SysTick model allows.
+ *
+ * Each measured task owns a TimingStats_t.  vTimingStart() and ulTimingStop()
+ * bracket the section being measured, and record:
+ *
+ * - the minimum, maximum and mean execution time,
+ * - a histogram of execution times in power of two microsecond buckets,
+ * - the number of executions that took longer than the deadline,
+ * - release jitter - how far the interval between successive calls to
+ *   vTimingStart() differed from the nominal period.
+ *
+ * vTimingPrintSummary() prints the statistics of every registered task.
+ */
+
+#ifndef TASK_TIMING_H
+#define TASK_TIMING_H
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+/* Number of histogram buckets.  Bucket 0 counts executions that took less
+ * than 1 us, bucket n those that took [ 2^(n-1), 2^n ) us, and the last bucket
+ * everything longer. */
+#ifndef timingHISTOGRAM_BUCKETS
+    #define timingHISTOGRAM_BUCKETS    ( 16U )
+#endif
+
+#define timingCYCLES_PER_US            ( configCPU_CLOCK_HZ / 1000000UL )
+#define timingUS_TO_CYCLES( ulUs )     ( ( uint32_t ) ( ulUs ) * timingCYCLES_PER_US )
+#define timingCYCLES_TO_US( ulCycles ) ( ( uint32_t ) ( ulCycles ) / timingCYCLES_PER_US )
+
+typedef struct TimingStats
+{
+    const char * pcName;
+    uint32_t ulPeriodCycles;   /* Nominal interval between releases, 0 if not periodic. */
+    uint32_t ulDeadlineCycles; /* Executions longer than this are counted as missed. */
+
+    /* Execution time, in cycles. */
+    uint32_t ulCount;
+    uint32_t ulMissed;
+    uint32_t ulMin;
+    uint32_t ulMax;
+    uint64_t ullTotal;
+    uint32_t ulHistogram[ timingHISTOGRAM_BUCKETS ];
+
+    /* Release jitter, in cycles. */
+    uint32_t ulJitterCount;
+    uint32_t ulJitterMax;
+    uint64_t ullJitterTotal;
+
+    uint32_t ulStart;
+    uint32_t ulLastRelease;
+    BaseType_t xReleased;
+    struct TimingStats * pxNext;
+} TimingStats_t;
+
+/*
+ * Enable the cycle counter, or select the SysTick fallback if it does not run.
+ * Call once before the scheduler is started.
+ */
+void vTimingInit( void );
+
+/*
+ * The current value of the free running 32-bit cycle counter.  Wraps every
+ * 2^32 / configCPU_CLOCK_HZ seconds (171 s at 25 MHz), so only differences
+ * between two readings are meaningful.
+ */
+uint32_t ulTimingGetCycles( void );
+
+/*
+ * pdTRUE if ulTimingGetCycles() reads the DWT cycle counter, pdFALSE if it
+ * uses the SysTick fallback.  The fallback is one tick behind while the
+ * SysTick handler runs before the tick count is incremented.
+ */
+BaseType_t xTimingUsesCycleCounter( void );
+
+/*
+ * Reset pxStats and add it to the set printed by vTimingPrintSummary().
+ * ulPeriodUs is used for the jitter calculation (pass 0 if the task is not
+ * periodic) and ulDeadlineUs for the missed count.
+ */
+void vTimingRegister( TimingStats_t * pxStats,
+                      const char * pcName,
+                      uint32_t ulPeriodUs,
+                      uint32_t ulDeadlineUs );
+
+/*
+ * Mark the start of a measured section.  For a periodic task call this first
+ * thing after the task is released so the jitter figures are meaningful.
+ */
+void vTimingStart( TimingStats_t * pxStats );
+
+/*
+ * Mark the end of the section started by vTimingStart(), update the
+ * statistics and return the elapsed number of cycles.
+ */
+uint32_t ulTimingStop( TimingStats_t * pxStats );
+
+/*
+ * Add a duration of ulElapsed cycles measured by the caller, for intervals
+ * that do not start and end in the same task (such as the latency from an
+ * interrupt to the task that handles it).  Does not affect the jitter
+ * figures.
+ */
+void vTimingRecord( TimingStats_t * pxStats,
+                    uint32_t ulElapsed );
+
+/*
+ * Print one summary line and the non-empty histogram buckets for each
+ * registered TimingStats_t.  Statistics are copied in a critical section, so
+ * this can be called from a task of any priority.
+ */
+void vTimingPrintSummary( void );
+
+#endif /* TASK_TIMING_H */
@@ -0,0 +1,190 @@
+/*
+ * Tickless idle for the MPS2 AN385.  See TicklessIdle.h.
+ */
+
+#include <stdio.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Library includes. */
+#include "SMM_MPS2.h"
+
+/* Application includes. */
+#include "TicklessIdle.h"
+
+#define ticklessCOUNTS_PER_TICK       ( configCPU_CLOCK_HZ / configTICK_RATE_HZ )
+
+/* The longest sleep the 32 bit timeout timer can measure. */
+#define ticklessMAX_SUPPRESSED_TICKS  ( ( TickType_t ) ( 0xFFFFFFFFUL / ticklessCOUNTS_PER_TICK ) - 1U )
+
+/* Fewer counts than this before the next tick are treated as the tick having
+ * arrived, as a SysTick reload of 0 would stop the SysTick. */
+#define ticklessMIN_RELOAD_COUNTS     ( 2UL )
+
+/* The wake up interrupt does not use the FreeRTOS API, so can have any
+ * priority.  It is only there to end the WFI. */
+#define ticklessTIMER_INTERRUPT_PRIORITY    ( ( 1UL << __NVIC_PRIO_BITS ) - 1UL )
+
+/* Updated with interrupts disabled, by the idle task only. */
+static TicklessStats_t xStats = { 0 };
+
+static BaseType_t xTimerInitialised = pdFALSE;
+
+/*-----------------------------------------------------------*/
+
+void DUALTIMER_Handler( void )
+{
+    CMSDK_DUALTIMER2->TimerIntClr = CMSDK_DUALTIMER2_INTCLR_Msk;
+}
+/*-----------------------------------------------------------*/
+
+void vTicklessSleep( TickType_t xExpectedIdleTime )
+{
+    uint32_t ulTickRemaining, ulSleepCounts, ulElapsed, ulSinceTick;
+    uint32_t ulCompleteTicks, ulRemainder;
+    BaseType_t xTimedOut;
+
+    if( xTimerInitialised == pdFALSE )
+    {
+        /* The tick period must be a whole number of timer counts, or every
+         * sleep would drift. */
+        configASSERT( ( configCPU_CLOCK_HZ % configTICK_RATE_HZ ) == 0U );
+
+        CMSDK_DUALTIMER2->TimerControl = 0;
+        CMSDK_DUALTIMER2->TimerIntClr = CMSDK_DUALTIMER2_INTCLR_Msk;
+        NVIC_SetPriority( DUALTIMER_IRQn, ticklessTIMER_INTERRUPT_PRIORITY );
+        NVIC_EnableIRQ( DUALTIMER_IRQn );
+        xTimerInitialised = pdTRUE;
+    }
+
+    if( xExpectedIdleTime > ticklessMAX_SUPPRESSED_TICKS )
+    {
+        xExpectedIdleTime = ticklessMAX_SUPPRESSED_TICKS;
+    }
+
+    /* Interrupts stay pending rather than being taken, so one arriving from
+     * here on still ends the WFI below. */
+    __disable_irq();
+    __DSB();
+    __ISB();
+
+    /* Stop the SysTick, keeping how far it was from the next tick.  If the
+     * tick has just expired, or an interrupt made a task ready, do not sleep
+     * and try again on the next pass of the idle task. */
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    ulTickRemaining = SysTick->VAL;
+
+    if( ( eTaskConfirmSleepModeStatus() == eAbortSleep ) ||
+        ( ( SCB->ICSR & SCB_ICSR_PENDSTSET_Msk ) != 0UL ) ||
+        ( ulTickRemaining == 0UL ) )
+    {
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+        xStats.ulAborted++;
+        __enable_irq();
+        return;
+    }
+
+    /* Time out on the tick boundary at which the next task is due. */
+    ulSleepCounts = ulTickRemaining + ( ( uint32_t ) ( xExpectedIdleTime - 1U ) * ticklessCOUNTS_PER_TICK );
+
+    CMSDK_DUALTIMER2->TimerLoad = ulSleepCounts;
+    CMSDK_DUALTIMER2->TimerControl = CMSDK_DUALTIMER2_CTRL_EN_Msk |
+                                     CMSDK_DUALTIMER2_CTRL_INTEN_Msk |
+                                     CMSDK_DUALTIMER2_CTRL_SIZE_Msk |
+                                     CMSDK_DUALTIMER2_CTRL_ONESHOOT_Msk;
+
+    __DSB();
+    __WFI();
+    __ISB();
+
+    /* The interrupt that woke the core stays pending until the time slept
+     * has been accounted for, so that it already sees the stepped tick count
+     * and a running SysTick.  A one shot timer stops at 0, so the raw
+     * status says whether it got there. */
+    ulElapsed = ulSleepCounts - CMSDK_DUALTIMER2->TimerValue;
+    xTimedOut = ( ( CMSDK_DUALTIMER2->TimerRIS & CMSDK_DUALTIMER2_RAWINTSTAT_Msk ) != 0UL ) ? pdTRUE : pdFALSE;
+    CMSDK_DUALTIMER2->TimerControl = 0;
+    CMSDK_DUALTIMER2->TimerIntClr = CMSDK_DUALTIMER2_INTCLR_Msk;
+
+    /* Counts since the last tick boundary before the sleep. */
+    ulSinceTick = ( ticklessCOUNTS_PER_TICK - ulTickRemaining ) + ulElapsed + ticklessRESTART_COMPENSATION;
+    ulCompleteTicks = ulSinceTick / ticklessCOUNTS_PER_TICK;
+    ulRemainder = ulSinceTick % ticklessCOUNTS_PER_TICK;
+
+    if( ( ticklessCOUNTS_PER_TICK - ulRemainder ) < ticklessMIN_RELOAD_COUNTS )
+    {
+        ulCompleteTicks++;
+        ulRemainder = 0;
+    }
+
+    xStats.ulSleeps++;
+
+    if( xTimedOut == pdFALSE )
+    {
+        xStats.ulEarlyWakes++;
+    }
+
+    if( ulCompleteTicks >= ( uint32_t ) xExpectedIdleTime )
+    {
+        /* The tick that unblocks the next task must go through the tick
+         * interrupt, so step to the tick before and pend the SysTick
+         * interrupt for the last one.  Any further ticks cannot be stepped
+         * over without missing a task's wake time, and are lost. */
+        xStats.ulLateTicks += ulCompleteTicks - ( uint32_t ) xExpectedIdleTime;
+        ulCompleteTicks = ( uint32_t ) xExpectedIdleTime - 1UL;
+        SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+    }
+
+    xStats.ulSuppressedTicks += ulCompleteTicks;
+
+    if( ulCompleteTicks > 0UL )
+    {
+        vTaskStepTick( ( TickType_t ) ulCompleteTicks );
+    }
+
+    /* Count the rest of the current tick period, then go back to whole
+     * periods.  The new LOAD value is used from the next reload. */
+    SysTick->LOAD = ( ticklessCOUNTS_PER_TICK - ulRemainder ) - 1UL;
+    SysTick->VAL = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = ticklessCOUNTS_PER_TICK - 1UL;
+
+    /* Now let the interrupt that woke the core run. */
+    __enable_irq();
+}
+/*-----------------------------------------------------------*/
+
+void vTicklessGetStats( TicklessStats_t * pxStats )
+{
+    taskENTER_CRITICAL();
+    {
+        *pxStats = xStats;
+    }
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+void vTicklessPrintStats( void )
+{
+    TicklessStats_t xSnapshot;
+    TickType_t xTicks = xTaskGetTickCount();
+    uint32_t ulPercent = 0;
+
+    vTicklessGetStats( &xSnapshot );
+
+    if( xTicks != 0U )
+    {
+        ulPercent = ( uint32_t ) ( ( ( uint64_t ) xSnapshot.ulSuppressedTicks * 100U ) / xTicks );
+    }
+
+    printf( "Tickless: sleeps=%u aborted=%u early=%u suppressed=%u ticks (%u%%) late=%u\n",
+            ( unsigned ) xSnapshot.ulSleeps,
+            ( unsigned ) xSnapshot.ulAborted,
+            ( unsigned ) xSnapshot.ulEarlyWakes,
+            ( unsigned ) xSnapshot.ulSuppressedTicks,
+            ( unsigned ) ulPercent,
+            ( unsigned ) xSnapshot.ulLateTicks );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,71 @@
+/*
+ * Tickless idle for the MPS2 AN385.
+ *
+ * With configUSE_TICKLESS_IDLE set to 2 the kernel calls vTicklessSleep()
+ * through portSUPPRESS_TICKS_AND_SLEEP() when the idle task finds that no task
+ * is due to run for at least configEXPECTED_IDLE_TIME_BEFORE_SLEEP ticks.
+ * vTicklessSleep() stops the SysTick, arms timer 2 of the CMSDK dual timer as
+ * a one shot timeout ending on the tick boundary at which the next task is
+ * due, and waits for an interrupt.  On waking, whether by the timeout or by
+ * another interrupt, it steps the tick count over the whole tick periods that
+ * passed and restarts the SysTick so that the next tick interrupt falls where
+ * it would have had the tick never been stopped, all with interrupts still
+ * masked, and only then lets the interrupt that woke the core run.  The part of a tick period
+ * that had elapsed when the SysTick was stopped and the part that elapsed
+ * after the last whole period are carried over rather than rounded away, so
+ * the tick count does not drift across sleeps.
+ *
+ * Dual timer 2 is clocked at the 25 MHz peripheral clock, so one sleep can
+ * last up to 171 seconds, against 671 ms for the 24 bit SysTick that the
+ * port's own implementation uses.  Dual timer 1 is the run time counter
+ * (RunTimeStats.h) and the two share an interrupt, of which only timer 2
+ * requests any.
+ *
+ * The SysTick based fallback of ulTimingGetCycles() (TaskTiming.h) stays
+ * consistent across sleeps, because the tick count and the SysTick phase are
+ * both restored before any interrupt runs, so the time stamps taken by the
+ * waking interrupt (UARTPacketRx.c, IsrProfiler.c) do not include the sleep.
+ */
+
+#ifndef TICKLESS_IDLE_H
+#define TICKLESS_IDLE_H
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+/* Timer counts lost between reading the timeout timer and restarting the
+ * SysTick, added back to the time slept. */
+#ifndef ticklessRESTART_COMPENSATION
+    #define ticklessRESTART_COMPENSATION    ( 45UL )
+#endif
+
+typedef struct TicklessStats
+{
+    uint32_t ulSleeps;          /* Times the tick was stopped. */
+    uint32_t ulAborted;         /* Sleeps abandoned because a task became ready. */
+    uint32_t ulEarlyWakes;      /* Sleeps ended by an interrupt other than the timeout. */
+    uint32_t ulSuppressedTicks; /* Tick interrupts that did not happen. */
+    uint32_t ulLateTicks;       /* Ticks lost to waking later than one tick after the timeout. */
+} TicklessStats_t;
+
+/*
+ * Sleep for up to xExpectedIdleTime ticks.  Called by the idle task through
+ * portSUPPRESS_TICKS_AND_SLEEP(), with the scheduler suspended.
+ */
+void vTicklessSleep( TickType_t xExpectedIdleTime );
+
+/*
+ * The dual timer interrupt, which ends a sleep on timeout.
+ */
+void DUALTIMER_Handler( void );
+
+void vTicklessGetStats( TicklessStats_t * pxStats );
+
+/*
+ * Print the statistics, including the suppressed ticks as a share of all the
+ * ticks since the scheduler started.
+ */
+void vTicklessPrintStats( void );
+
+#endif /* TICKLESS_IDLE_H */
@@ -32,7 +32,12 @@ extern "C" {
  */
 
 /* TODO TraceRecorder (Tweak 3): Adjust the RingBuffer size here
- * to increase trace length or reduce memory usage. */
+ * to increase trace length or reduce memory usage.
+ *
+ * The UART stream port (TraceRecorderStreamPort/UART, selected with
+ * TRACE_PORT=UART in build/gcc/Makefile) uses the same size for the buffer
+ * that holds events waiting to be sent on UART1. There it only has to absorb
+ * bursts, as the buffer is drained continuously. */
 #define TRC_CFG_STREAM_PORT_BUFFER_SIZE 10240
 
 /**
@@ -49,6 +54,8 @@ extern "C" {
  * When TRC_CFG_STREAM_PORT_MODE is TRC_STREAM_PORT_RINGBUFFER_MODE_STOP_WHEN_FULL, the
  * recording is stopped when the buffer becomes full. This is useful for
  * recording events following a specific state, e.g., the startup sequence.
+ *
+ * Not used by the UART stream port, which drops the events that do not fit.
  */
 #define TRC_CFG_STREAM_PORT_RINGBUFFER_MODE TRC_STREAM_PORT_RINGBUFFER_MODE_OVERWRITE_WHEN_FULL
 
@@ -0,0 +1,93 @@
+/*
+ * TraceRecorder stream port that sends the trace to the host on UART1.
+ *
+ * Events are copied into a RAM buffer of TRC_CFG_STREAM_PORT_BUFFER_SIZE bytes
+ * as they are recorded, and the UART1 TX interrupt moves them to the UART one
+ * byte at a time, the same way UARTDriver.c drains the console.  Recording an
+ * event therefore costs a memory copy, not a wait on the UART.  An event that
+ * does not fit in the buffer is dropped whole, so the stream stays parseable,
+ * and counted in ulTraceStreamPortDroppedBytes.
+ *
+ * QEMU connects UART1 to its second -serial option, for example
+ * "-serial file:trace.psf".  The resulting file is a complete PSF stream,
+ * from the start of the recording to the end of the run, which Tracealyzer
+ * opens directly.  scripts/trace_capture.py adds the option for the run
+ * scripts.
+ */
+
+#ifndef TRC_STREAM_PORT_H
+#define TRC_STREAM_PORT_H
+
+#if ( TRC_USE_TRACEALYZER_RECORDER == 1 )
+
+#if ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING )
+
+#include <stdint.h>
+
+#include <trcTypes.h>
+#include <trcStreamPortConfig.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Tells Verdict.c that vTraceStreamPortFlush() is available. */
+#define TRC_STREAM_PORT_UART           1
+
+/* Data is sent as soon as it is committed, no internal buffer or TzCtrl
+ * transfer is needed. */
+#define TRC_USE_INTERNAL_BUFFER        0
+
+#define TRC_STREAM_PORT_BUFFER_SIZE    ( TRC_CFG_STREAM_PORT_BUFFER_SIZE )
+
+typedef struct TraceStreamPortBuffer
+{
+    uint8_t buffer[ ( TRC_STREAM_PORT_BUFFER_SIZE ) + sizeof( TraceUnsignedBaseType_t ) ];
+} TraceStreamPortBuffer_t;
+
+/* Bytes of trace data dropped because the buffer was full. */
+extern volatile uint32_t ulTraceStreamPortDroppedBytes;
+
+traceResult xTraceStreamPortInitialize( TraceStreamPortBuffer_t * pxBuffer );
+
+/* Events are built in the recorder's static buffer and copied out by the
+ * commit. */
+#define xTraceStreamPortAllocate( uiSize, ppvData )    ( ( void ) ( uiSize ), xTraceStaticBufferGet( ppvData ) )
+
+#define xTraceStreamPortCommit                         xTraceStreamPortWriteData
+
+traceResult xTraceStreamPortWriteData( void * pvData,
+                                       uint32_t uiSize,
+                                       int32_t * piBytesWritten );
+
+/* Nothing is received from the host. */
+#define xTraceStreamPortReadData( pvData, uiSize, piBytesRead ) \
+    ( ( void ) ( pvData ), ( void ) ( uiSize ), ( void ) ( piBytesRead ), TRC_SUCCESS )
+
+traceResult xTraceStreamPortOnEnable( uint32_t uiStartOption );
+traceResult xTraceStreamPortOnDisable( void );
+traceResult xTraceStreamPortOnTraceBegin( void );
+traceResult xTraceStreamPortOnTraceEnd( void );
+
+/*
+ * Synchronously send everything still in the buffer, without the TX
+ * interrupt, like vUARTFlush() for the console.  Called by vVerdictExit()
+ * before it ends the run, so the trace keeps the events leading up to the
+ * verdict.
+ */
+void vTraceStreamPortFlush( void );
+
+/*
+ * The UART1 TX interrupt, referenced from the vector table in startup_gcc.c.
+ */
+void UARTTX1_Handler( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING ) */
+
+#endif /* ( TRC_USE_TRACEALYZER_RECORDER == 1 ) */
+
+#endif /* TRC_STREAM_PORT_H */
@@ -0,0 +1,185 @@
+/*
+ * TraceRecorder stream port that sends the trace to the host on UART1.  See
+ * include/trcStreamPort.h.
+ */
+
+#include <string.h>
+
+#include <trcRecorder.h>
+
+#if ( TRC_USE_TRACEALYZER_RECORDER == 1 )
+
+#if ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING )
+
+/* Library includes. */
+#include "SMM_MPS2.h"
+
+#define trcUART_BAUD_DIVISOR           ( 16UL )
+
+/* Writers mask the interrupt, so it must not be above
+ * configMAX_SYSCALL_INTERRUPT_PRIORITY.  Lowest, like the console. */
+#define trcUART_INTERRUPT_PRIORITY     ( ( 1UL << __NVIC_PRIO_BITS ) - 1UL )
+
+/* The buffer belongs to the recorder, which passes it to
+ * xTraceStreamPortInitialize().  ulHead is only written by writers with the
+ * interrupt masked, ulTail only by the interrupt.  Both are offsets in
+ * [ 0, TRC_STREAM_PORT_BUFFER_SIZE ), and one byte is kept unused to tell a
+ * full buffer from an empty one. */
+static uint8_t * pucBuffer = NULL;
+static volatile uint32_t ulHead = 0, ulTail = 0;
+
+/* pdTRUE while a byte is in the UART and its TX interrupt is due. */
+static volatile BaseType_t xTxActive = pdFALSE;
+
+volatile uint32_t ulTraceStreamPortDroppedBytes = 0;
+
+/*-----------------------------------------------------------*/
+
+traceResult xTraceStreamPortInitialize( TraceStreamPortBuffer_t * pxBuffer )
+{
+    if( pxBuffer == NULL )
+    {
+        return TRC_FAIL;
+    }
+
+    pucBuffer = pxBuffer->buffer;
+    ulHead = 0;
+    ulTail = 0;
+
+    return TRC_SUCCESS;
+}
+/*-----------------------------------------------------------*/
+
+traceResult xTraceStreamPortOnEnable( uint32_t uiStartOption )
+{
+    ( void ) uiStartOption;
+
+    CMSDK_UART1->BAUDDIV = trcUART_BAUD_DIVISOR;
+    CMSDK_UART1->INTCLEAR = CMSDK_UART_CTRL_TXIRQ_Msk;
+    CMSDK_UART1->CTRL = CMSDK_UART_CTRL_TXEN_Msk | CMSDK_UART_CTRL_TXIRQEN_Msk;
+
+    NVIC_SetPriority( UARTTX1_IRQn, trcUART_INTERRUPT_PRIORITY );
+    NVIC_EnableIRQ( UARTTX1_IRQn );
+
+    return TRC_SUCCESS;
+}
+/*-----------------------------------------------------------*/
+
+traceResult xTraceStreamPortOnDisable( void )
+{
+    return TRC_SUCCESS;
+}
+/*-----------------------------------------------------------*/
+
+traceResult xTraceStreamPortOnTraceBegin( void )
+{
+    return TRC_SUCCESS;
+}
+/*-----------------------------------------------------------*/
+
+traceResult xTraceStreamPortOnTraceEnd( void )
+{
+    return TRC_SUCCESS;
+}
+/*-----------------------------------------------------------*/
+
+traceResult xTraceStreamPortWriteData( void * pvData,
+                                       uint32_t uiSize,
+                                       int32_t * piBytesWritten )
+{
+    UBaseType_t uxSavedInterruptStatus;
+    const uint8_t * pucData = ( const uint8_t * ) pvData;
+    uint32_t ulFree, ulFirst;
+
+    *piBytesWritten = 0;
+
+    if( pucBuffer == NULL )
+    {
+        return TRC_FAIL;
+    }
+
+    uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+    {
+        ulFree = ( ulTail + TRC_STREAM_PORT_BUFFER_SIZE - ulHead - 1UL ) % TRC_STREAM_PORT_BUFFER_SIZE;
+
+        if( uiSize > ulFree )
+        {
+            ulTraceStreamPortDroppedBytes += uiSize;
+        }
+        else
+        {
+            /* At most two copies, either side of the end of the buffer. */
+            ulFirst = TRC_STREAM_PORT_BUFFER_SIZE - ulHead;
+
+            if( ulFirst > uiSize )
+            {
+                ulFirst = uiSize;
+            }
+
+            memcpy( &( pucBuffer[ ulHead ] ), pucData, ulFirst );
+            memcpy( pucBuffer, &( pucData[ ulFirst ] ), uiSize - ulFirst );
+            ulHead = ( ulHead + uiSize ) % TRC_STREAM_PORT_BUFFER_SIZE;
+            *piBytesWritten = ( int32_t ) uiSize;
+
+            /* An idle UART has no interrupt pending to pick the data up. */
+            if( ( xTxActive == pdFALSE ) && ( uiSize != 0UL ) )
+            {
+                xTxActive = pdTRUE;
+                CMSDK_UART1->DATA = pucBuffer[ ulTail ];
+                ulTail = ( ulTail + 1UL ) % TRC_STREAM_PORT_BUFFER_SIZE;
+            }
+        }
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+    return TRC_SUCCESS;
+}
+/*-----------------------------------------------------------*/
+
+void vTraceStreamPortFlush( void )
+{
+    UBaseType_t uxSavedInterruptStatus;
+
+    if( pucBuffer == NULL )
+    {
+        return;
+    }
+
+    uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+    {
+        while( ulTail != ulHead )
+        {
+            while( ( CMSDK_UART1->STATE & CMSDK_UART_STATE_TXBF_Msk ) != 0 )
+            {
+            }
+
+            /* Leave xTxActive set - the interrupt generated by the last byte
+             * clears it, if interrupts are ever unmasked. */
+            xTxActive = pdTRUE;
+            CMSDK_UART1->DATA = pucBuffer[ ulTail ];
+            ulTail = ( ulTail + 1UL ) % TRC_STREAM_PORT_BUFFER_SIZE;
+        }
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+}
+/*-----------------------------------------------------------*/
+
+void UARTTX1_Handler( void )
+{
+    CMSDK_UART1->INTCLEAR = CMSDK_UART_CTRL_TXIRQ_Msk;
+
+    if( ulTail != ulHead )
+    {
+        CMSDK_UART1->DATA = pucBuffer[ ulTail ];
+        ulTail = ( ulTail + 1UL ) % TRC_STREAM_PORT_BUFFER_SIZE;
+    }
+    else
+    {
+        xTxActive = pdFALSE;
+    }
+}
+/*-----------------------------------------------------------*/
+
+#endif /* ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING ) */
+
+#endif /* ( TRC_USE_TRACEALYZER_RECORDER == 1 ) */
@@ -0,0 +1,215 @@
+/*
+ * Console driver for the CMSDK UART0.  See UARTDriver.h.
+ */
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+
+/* Library includes. */
+#include "SMM_MPS2.h"
+
+/* Application includes. */
+#include "UARTDriver.h"
+
+#define uartBAUD_DIVISOR    ( 16UL )
+#define uartTX_INDEX_MASK   ( ( uint32_t ) uartTX_BUFFER_SIZE - 1UL )
+
+/* The TX interrupt never calls the FreeRTOS API, but writers mask it while
+ * they update the ring so it must not run above
+ * configMAX_SYSCALL_INTERRUPT_PRIORITY.  Console output is the least urgent
+ * thing in the system so use the lowest priority. */
+#define uartTX_INTERRUPT_PRIORITY    ( ( 1UL << __NVIC_PRIO_BITS ) - 1UL )
+
+#if ( uartUSE_BUFFERED_TX == 1 )
+
+/* Ring buffer.  ulTxHead is only written by writers with the TX interrupt
+ * masked, ulTxTail is only written by the TX interrupt (or by vUARTFlush()
+ * with the interrupt masked).  Both are free running and wrapped with
+ * uartTX_INDEX_MASK when used as an index. */
+    static char cTxRing[ uartTX_BUFFER_SIZE ];
+    static volatile uint32_t ulTxHead = 0, ulTxTail = 0;
+
+/* pdTRUE while a character written by the driver is in the UART, meaning a TX
+ * interrupt is due that will send the next character. */
+    static volatile BaseType_t xTxActive = pdFALSE;
+
+#endif /* uartUSE_BUFFERED_TX */
+
+static UARTTxStats_t xTxStats = { 0 };
+
+/*-----------------------------------------------------------*/
+
+void vUARTInit( void )
+{
+    CMSDK_UART0->BAUDDIV = uartBAUD_DIVISOR;
+
+    #if ( uartUSE_BUFFERED_TX == 1 )
+    {
+        CMSDK_UART0->INTCLEAR = CMSDK_UART_CTRL_TXIRQ_Msk;
+        CMSDK_UART0->CTRL = CMSDK_UART_CTRL_TXEN_Msk | CMSDK_UART_CTRL_TXIRQEN_Msk;
+
+        NVIC_SetPriority( UARTTX0_IRQn, uartTX_INTERRUPT_PRIORITY );
+        NVIC_EnableIRQ( UARTTX0_IRQn );
+    }
+    #else
+    {
+        CMSDK_UART0->CTRL = CMSDK_UART_CTRL_TXEN_Msk;
+    }
+    #endif
+}
+/*-----------------------------------------------------------*/
+
+#if ( uartUSE_BUFFERED_TX == 1 )
+
+    size_t xUARTWrite( const char * pcData,
+                       size_t xLength )
+    {
+        UBaseType_t uxSavedInterruptStatus;
+        uint32_t ulHead, ulFree, ulUsed;
+        size_t xAccepted;
+
+        /* The mask from ISR macros work from task and interrupt context alike,
+         * and are cheaper than a full critical section. */
+        uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+        {
+            ulHead = ulTxHead;
+            ulFree = ( uint32_t ) uartTX_BUFFER_SIZE - ( ulHead - ulTxTail );
+            xAccepted = ( xLength < ulFree ) ? xLength : ( size_t ) ulFree;
+
+            for( size_t x = 0; x < xAccepted; x++ )
+            {
+                cTxRing[ ulHead & uartTX_INDEX_MASK ] = pcData[ x ];
+                ulHead++;
+            }
+
+            ulTxHead = ulHead;
+
+            xTxStats.ulBytesQueued += ( uint32_t ) xAccepted;
+            xTxStats.ulBytesDropped += ( uint32_t ) ( xLength - xAccepted );
+
+            ulUsed = ulHead - ulTxTail;
+
+            if( ulUsed > xTxStats.ulHighWaterMark )
+            {
+                xTxStats.ulHighWaterMark = ulUsed;
+            }
+
+            /* If the UART is idle there is no TX interrupt pending to pick up
+             * the new data, so send the first character here. */
+            if( ( xTxActive == pdFALSE ) && ( ulUsed != 0UL ) )
+            {
+                xTxActive = pdTRUE;
+                CMSDK_UART0->DATA = ( uint32_t ) ( uint8_t ) cTxRing[ ulTxTail & uartTX_INDEX_MASK ];
+                ulTxTail++;
+            }
+        }
+        portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+        return xAccepted;
+    }
+/*-----------------------------------------------------------*/
+
+    size_t xUARTGetTxFree( void )
+    {
+        /* A single read of each index, so no need to mask the interrupt.  The
+         * result can only grow until the caller writes. */
+        return ( size_t ) ( ( uint32_t ) uartTX_BUFFER_SIZE - ( ulTxHead - ulTxTail ) );
+    }
+/*-----------------------------------------------------------*/
+
+    void UARTTX0_Handler( void )
+    {
+        CMSDK_UART0->INTCLEAR = CMSDK_UART_CTRL_TXIRQ_Msk;
+
+        if( ulTxTail != ulTxHead )
+        {
+            CMSDK_UART0->DATA = ( uint32_t ) ( uint8_t ) cTxRing[ ulTxTail & uartTX_INDEX_MASK ];
+            ulTxTail++;
+        }
+        else
+        {
+            xTxActive = pdFALSE;
+        }
+    }
+/*-----------------------------------------------------------*/
+
+    void vUARTFlush( void )
+    {
+        UBaseType_t uxSavedInterruptStatus;
+
+        uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+        {
+            while( ulTxTail != ulTxHead )
+            {
+                while( ( CMSDK_UART0->STATE & CMSDK_UART_STATE_TXBF_Msk ) != 0 )
+                {
+                }
+
+                /* Leave xTxActive set - the interrupt generated by the last
+                 * character clears it, if interrupts are ever unmasked. */
+                xTxActive = pdTRUE;
+                CMSDK_UART0->DATA = ( uint32_t ) ( uint8_t ) cTxRing[ ulTxTail & uartTX_INDEX_MASK ];
+                ulTxTail++;
+            }
+        }
+        portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+    }
+
+#else /* uartUSE_BUFFERED_TX */
+
+    size_t xUARTWrite( const char * pcData,
+                       size_t xLength )
+    {
+        for( size_t x = 0; x < xLength; x++ )
+        {
+            while( ( CMSDK_UART0->STATE & CMSDK_UART_STATE_TXBF_Msk ) != 0 )
+            {
+            }
+
+            CMSDK_UART0->DATA = ( uint32_t ) ( uint8_t ) pcData[ x ];
+        }
+
+        xTxStats.ulBytesQueued += ( uint32_t ) xLength;
+
+        return xLength;
+    }
+/*-----------------------------------------------------------*/
+
+    size_t xUARTGetTxFree( void )
+    {
+        return ( size_t ) -1;
+    }
+/*-----------------------------------------------------------*/
+
+    void UARTTX0_Handler( void )
+    {
+        /* The TX interrupt is not enabled in blocking mode. */
+        CMSDK_UART0->INTCLEAR = CMSDK_UART_CTRL_TXIRQ_Msk;
+    }
+/*-----------------------------------------------------------*/
+
+    void vUARTFlush( void )
+    {
+        /* Nothing is ever held back in blocking mode. */
+    }
+
+#endif /* uartUSE_BUFFERED_TX */
+/*-----------------------------------------------------------*/
+
+void vUARTPutChar( char cChar )
+{
+    ( void ) xUARTWrite( &cChar, 1 );
+}
+/*-----------------------------------------------------------*/
+
+void vUARTGetTxStats( UARTTxStats_t * pxStats )
+{
+    UBaseType_t uxSavedInterruptStatus;
+
+    uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+    {
+        *pxStats = xTxStats;
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+}
+/*-----------------------------------------------------------*/
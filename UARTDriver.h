@@ -0,0 +1,88 @@
+/*
+ * Console driver for the CMSDK UART0 on the MPS2 AN385 (as modelled by QEMU).
+ *
+ * Two transmit modes are provided, selected by uartUSE_BUFFERED_TX:
+ *
+ * 0 - Blocking.  Each character is written to UART0_DATA after busy waiting
+ *     for the TX buffer full flag to clear.  This is the original behaviour of
+ *     __write() in main.c.
+ *
+ * 1 - Buffered.  Characters are copied into a RAM ring buffer and the UART0 TX
+ *     interrupt drains the ring one character per interrupt.  Writers never
+ *     wait - if the ring is full the excess characters are discarded and
+ *     counted so the loss is visible in the statistics rather than as a change
+ *     in task timing.
+ */
+
+#ifndef UART_DRIVER_H
+#define UART_DRIVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+/* Set to 1 to drain console output from the UART0 TX interrupt, or 0 to busy
+ * wait on the UART for every character.  Can be overridden in
+ * FreeRTOSConfig.h. */
+#ifndef uartUSE_BUFFERED_TX
+    #define uartUSE_BUFFERED_TX    1
+#endif
+
+/* Size of the TX ring buffer in bytes.  Must be a power of two. */
+#ifndef uartTX_BUFFER_SIZE
+    #define uartTX_BUFFER_SIZE     ( 2048U )
+#endif
+
+#if ( ( uartTX_BUFFER_SIZE & ( uartTX_BUFFER_SIZE - 1U ) ) != 0 )
+    #error uartTX_BUFFER_SIZE must be a power of two
+#endif
+
+typedef struct UARTTxStats
+{
+    uint32_t ulBytesQueued;    /* Bytes accepted by xUARTWrite(). */
+    uint32_t ulBytesDropped;   /* Bytes discarded because the ring was full. */
+    uint32_t ulHighWaterMark;  /* Maximum number of bytes ever waiting in the ring. */
+} UARTTxStats_t;
+
+/*
+ * Configure UART0 for transmission and, in buffered mode, enable the TX
+ * interrupt.  Must be called before the first call to xUARTWrite().
+ */
+void vUARTInit( void );
+
+/*
+ * Send xLength bytes from pcData.  In buffered mode this only copies into the
+ * ring buffer and returns the number of bytes accepted, which is less than
+ * xLength if the ring filled.  Safe to call from tasks and from interrupts
+ * that run at or below configMAX_SYSCALL_INTERRUPT_PRIORITY.
+ */
+size_t xUARTWrite( const char * pcData,
+                   size_t xLength );
+
+/*
+ * Number of bytes xUARTWrite() could currently accept without dropping any.
+ * Lets a writer that must not have its output split (such as the binary log
+ * drain task) wait for space instead.  Always large in blocking mode.
+ */
+size_t xUARTGetTxFree( void );
+
+/* Single character version of xUARTWrite().  printf-stdarg.c writes whole
+ * chunks with xUARTWrite() instead. */
+void vUARTPutChar( char cChar );
+
+/*
+ * Synchronously transmit everything still held in the ring buffer without
+ * relying on the TX interrupt.  Intended for fatal error paths (assert, stack
+ * overflow, hard fault) that print a message then stop with interrupts
+ * masked, which would otherwise leave the message sitting in RAM.
+ */
+void vUARTFlush( void );
+
+/* Take a snapshot of the TX statistics. */
+void vUARTGetTxStats( UARTTxStats_t * pxStats );
+
+/* The TX interrupt handler, installed in the vector table in startup_gcc.c. */
+void UARTTX0_Handler( void );
+
+#endif /* UART_DRIVER_H */
@@ -0,0 +1,196 @@
+/*
+ * Framed packet receive on the CMSDK UART0.  See UARTPacketRx.h.
+ */
+
+#include <stdio.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Library includes. */
+#include "SMM_MPS2.h"
+
+/* Application includes. */
+#include "UARTPacketRx.h"
+#include "TaskTiming.h"
+
+/* The interrupt calls the FreeRTOS API so must not run above
+ * configMAX_SYSCALL_INTERRUPT_PRIORITY.  One above the console TX interrupt,
+ * so a long burst of output does not hold up received bytes. */
+#define uartrxINTERRUPT_PRIORITY    ( ( 1UL << __NVIC_PRIO_BITS ) - 2UL )
+
+typedef enum
+{
+    eRxMarker,     /* Waiting for uartrxFRAME_MARKER. */
+    eRxLengthHigh, /* Waiting for the first length byte. */
+    eRxLengthLow,  /* Waiting for the second length byte. */
+    eRxPayload,    /* Copying the payload into pucSlot. */
+    eRxSkip        /* Discarding the payload of a frame that cannot be kept. */
+} RxState_t;
+
+/* Everything below is only written by the RX interrupt once it is enabled. */
+static PacketRing_t * pxRxRing = NULL;
+static TaskHandle_t xRxTask = NULL;
+static UBaseType_t uxRxNotifyIndex = 0;
+
+static RxState_t eState = eRxMarker;
+static uint8_t * pucSlot = NULL;
+static size_t xFrameLength = 0, xReceived = 0;
+
+static volatile uint32_t ulStampCycles = 0;
+
+static UARTRxStats_t xRxStats = { 0 };
+
+/*-----------------------------------------------------------*/
+
+void vUARTRxInit( PacketRing_t * pxRing,
+                  TaskHandle_t xTaskToNotify,
+                  UBaseType_t uxNotifyIndex )
+{
+    configASSERT( pxRing );
+
+    pxRxRing = pxRing;
+    xRxTask = xTaskToNotify;
+    uxRxNotifyIndex = uxNotifyIndex;
+    eState = eRxMarker;
+
+    /* vUARTInit() has already configured the transmit side. */
+    CMSDK_UART0->STATE = CMSDK_UART_STATE_RXOR_Msk;
+    CMSDK_UART0->INTCLEAR = CMSDK_UART_CTRL_RXIRQ_Msk;
+    CMSDK_UART0->CTRL |= CMSDK_UART_CTRL_RXEN_Msk | CMSDK_UART_CTRL_RXIRQEN_Msk;
+
+    NVIC_SetPriority( UARTRX0_IRQn, uartrxINTERRUPT_PRIORITY );
+    NVIC_EnableIRQ( UARTRX0_IRQn );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulUARTRxGetStampCycles( void )
+{
+    return ulStampCycles;
+}
+/*-----------------------------------------------------------*/
+
+void UARTRX0_Handler( void )
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    uint8_t ucByte;
+
+    CMSDK_UART0->INTCLEAR = CMSDK_UART_CTRL_RXIRQ_Msk;
+
+    if( ( CMSDK_UART0->STATE & CMSDK_UART_STATE_RXOR_Msk ) != 0UL )
+    {
+        CMSDK_UART0->STATE = CMSDK_UART_STATE_RXOR_Msk;
+        xRxStats.ulOverruns++;
+    }
+
+    while( ( CMSDK_UART0->STATE & CMSDK_UART_STATE_RXBF_Msk ) != 0UL )
+    {
+        ucByte = ( uint8_t ) CMSDK_UART0->DATA;
+        xRxStats.ulBytes++;
+
+        switch( eState )
+        {
+            case eRxMarker:
+
+                if( ucByte == ( uint8_t ) uartrxFRAME_MARKER )
+                {
+                    eState = eRxLengthHigh;
+                }
+                else
+                {
+                    xRxStats.ulSkippedBytes++;
+                }
+
+                break;
+
+            case eRxLengthHigh:
+                xFrameLength = ( size_t ) ucByte << 8;
+                eState = eRxLengthLow;
+                break;
+
+            case eRxLengthLow:
+                xFrameLength |= ( size_t ) ucByte;
+                xReceived = 0;
+
+                if( ( xFrameLength == 0U ) || ( xFrameLength > ringSLOT_SIZE ) )
+                {
+                    xRxStats.ulBadLengths++;
+                    eState = ( xFrameLength == 0U ) ? eRxMarker : eRxSkip;
+                }
+                else
+                {
+                    /* A full ring counts the drop itself. */
+                    pucSlot = pucPacketRingAcquire( pxRxRing );
+                    eState = ( pucSlot != NULL ) ? eRxPayload : eRxSkip;
+                }
+
+                break;
+
+            case eRxPayload:
+                pucSlot[ xReceived++ ] = ucByte;
+
+                if( xReceived == xFrameLength )
+                {
+                    /* Stamp the oldest waiting packet, as the simulated
+                     * driver in main.c does. */
+                    if( xPacketRingCount( pxRxRing ) == 0U )
+                    {
+                        ulStampCycles = ulTimingGetCycles();
+                    }
+
+                    vPacketRingCommit( pxRxRing, xFrameLength );
+                    xRxStats.ulFrames++;
+                    eState = eRxMarker;
+
+                    if( xRxTask != NULL )
+                    {
+                        vTaskNotifyGiveIndexedFromISR( xRxTask, uxRxNotifyIndex, &xHigherPriorityTaskWoken );
+                    }
+                }
+
+                break;
+
+            case eRxSkip:
+            default:
+
+                if( ++xReceived >= xFrameLength )
+                {
+                    eState = eRxMarker;
+                }
+
+                break;
+        }
+    }
+
+    portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+/*-----------------------------------------------------------*/
+
+void vUARTRxGetStats( UARTRxStats_t * pxStats )
+{
+    UBaseType_t uxSavedInterruptStatus;
+
+    uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+    {
+        *pxStats = xRxStats;
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+}
+/*-----------------------------------------------------------*/
+
+void vUARTRxPrintStats( void )
+{
+    UARTRxStats_t xSnapshot;
+
+    vUARTRxGetStats( &xSnapshot );
+
+    printf( "UartRx: bytes=%u frames=%u skipped=%u badlen=%u overruns=%u dropped=%u\n",
+            ( unsigned ) xSnapshot.ulBytes,
+            ( unsigned ) xSnapshot.ulFrames,
+            ( unsigned ) xSnapshot.ulSkippedBytes,
+            ( unsigned ) xSnapshot.ulBadLengths,
+            ( unsigned ) xSnapshot.ulOverruns,
+            ( unsigned ) ( ( pxRxRing != NULL ) ? pxRxRing->ulDropped : 0UL ) );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,72 @@
+/*
+ * Framed packet receive on the CMSDK UART0.
+ *
+ * Bytes arriving on UART0 (QEMU's stdin with "-serial stdio") are split into
+ * packets by the UART0 RX interrupt and written straight into the slots of a
+ * PacketRing_t, so the receive path is the same one the simulated network
+ * driver uses and NetTask cannot tell them apart.  Each packet is sent as
+ *
+ *   uartrxFRAME_MARKER, length (2 bytes, big endian), payload (length bytes)
+ *
+ * Bytes that arrive while a marker is expected are skipped, so the receiver
+ * finds the next frame after line noise or a truncated frame.  Frames with a
+ * length of 0 or of more than ringSLOT_SIZE have their payload skipped, as do
+ * frames that arrive while the ring is full (counted as dropped by the ring).
+ * There is no inter-byte timeout: a frame that stops short is completed by
+ * the bytes of the next one, and the framing recovers at the marker after.
+ * scripts/fuzz_test.py frames its inputs this way.
+ *
+ * The interrupt notifies the consumer task for every packet committed, with
+ * vTaskNotifyGiveIndexedFromISR(), so the task can block on
+ * ulTaskNotifyTakeIndexed() rather than poll the ring.
+ */
+
+#ifndef UART_PACKET_RX_H
+#define UART_PACKET_RX_H
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "PacketRing.h"
+
+#ifndef uartrxFRAME_MARKER
+    #define uartrxFRAME_MARKER    ( 0xA5U )
+#endif
+
+typedef struct UARTRxStats
+{
+    uint32_t ulBytes;        /* Bytes read from the UART. */
+    uint32_t ulFrames;       /* Packets committed to the ring. */
+    uint32_t ulSkippedBytes; /* Bytes outside any frame. */
+    uint32_t ulBadLengths;   /* Frames skipped for a length of 0 or over ringSLOT_SIZE. */
+    uint32_t ulOverruns;     /* Bytes the UART lost because the interrupt was late. */
+} UARTRxStats_t;
+
+/*
+ * Start receiving packets into pxRing, which must already be initialised and
+ * have no other producer.  If xTaskToNotify is not NULL it is given a
+ * notification at index uxNotifyIndex for every packet.  Call after
+ * vUARTInit() and before starting the scheduler.
+ */
+void vUARTRxInit( PacketRing_t * pxRing,
+                  TaskHandle_t xTaskToNotify,
+                  UBaseType_t uxNotifyIndex );
+
+/*
+ * ulTimingGetCycles() when the oldest packet still waiting in the ring was
+ * committed, for receive latency figures.
+ */
+uint32_t ulUARTRxGetStampCycles( void );
+
+/* Take a snapshot of the RX statistics. */
+void vUARTRxGetStats( UARTRxStats_t * pxStats );
+
+/* Print the RX statistics on one line. */
+void vUARTRxPrintStats( void );
+
+/* The RX interrupt handler, installed in the vector table in startup_gcc.c. */
+void UARTRX0_Handler( void );
+
+#endif /* UART_PACKET_RX_H */
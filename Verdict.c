@@ -0,0 +1,214 @@
+/*
+ * Test verdicts reported to the host through semihosting.  See Verdict.h.
+ */
+
+#include <stdio.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+
+/* Library includes. */
+#include "SMM_MPS2.h"
+
+/* Application includes. */
+#include "Verdict.h"
+#include "BinaryLog.h"
+#include "UARTDriver.h"
+#include "Semihosting.h"
+#include "Coverage.h"
+
+/*
+ * The text printed for eVerdict.
+ */
+static const char * prvVerdictName( Verdict_t eVerdict );
+
+#if ( verdictUSE_SEMIHOSTING == 1 )
+
+/*
+ * End the QEMU process with ulStatus as its exit status.
+ */
+    static void prvSemihostingExit( uint32_t ulStatus );
+
+#endif
+
+#if ( verdictPASS_AFTER_MS != 0 )
+    static void prvPassTimerCallback( TimerHandle_t xTimer );
+    static TimerHandle_t xPassTimer = NULL;
+#endif
+
+/* Set by the first verdict, so a fault while reporting it (such as the BKPT
+ * being taken as a hard fault) does not report again. */
+static volatile BaseType_t xReported = pdFALSE;
+
+/*-----------------------------------------------------------*/
+
+static const char * prvVerdictName( Verdict_t eVerdict )
+{
+    switch( eVerdict )
+    {
+        case eVerdictPass:
+            return "PASS";
+
+        case eVerdictDeadlineMissed:
+            return "DEADLINE MISSED";
+
+        case eVerdictAssert:
+            return "ASSERT";
+
+        case eVerdictStackOverflow:
+            return "STACK OVERFLOW";
+
+        case eVerdictMallocFailed:
+            return "MALLOC FAILED";
+
+        case eVerdictHardFault:
+            return "HARD FAULT";
+
+        default:
+            return "UNKNOWN";
+    }
+}
+/*-----------------------------------------------------------*/
+
+#if ( verdictUSE_SEMIHOSTING == 1 )
+
+    static void prvSemihostingExit( uint32_t ulStatus )
+    {
+        /* The parameter block holds the reason and the exit status. */
+        volatile uint32_t ulParameters[ 2 ] = { semihostingADP_STOPPED_APPLICATION_EXIT, 0 };
+
+        ulParameters[ 1 ] = ulStatus;
+
+        ( void ) lSemihostingCall( semihostingSYS_EXIT_EXTENDED, ulParameters );
+    }
+
+#endif /* verdictUSE_SEMIHOSTING */
+/*-----------------------------------------------------------*/
+
+void vVerdictInit( void )
+{
+    #if ( verdictPASS_AFTER_MS != 0 )
+    {
+        xPassTimer = xTimerCreate( "Verdict", pdMS_TO_TICKS( verdictPASS_AFTER_MS ), pdFALSE, NULL, prvPassTimerCallback );
+        configASSERT( xPassTimer );
+        xTimerStart( xPassTimer, 0 );
+    }
+    #endif
+}
+/*-----------------------------------------------------------*/
+
+void vVerdictReady( void )
+{
+    #if ( verdictPERSISTENT == 1 )
+    {
+        printf( verdictREADY_MARKER "\r\n" );
+        vUARTFlush();
+
+        /* The host snapshots the system while it waits here for the input,
+         * with the interrupts masked so that no task moves on in the time the
+         * host takes to stop QEMU.  The byte is left for the RX interrupt. */
+        taskENTER_CRITICAL();
+        {
+            while( ( CMSDK_UART0->STATE & CMSDK_UART_STATE_RXBF_Msk ) == 0UL )
+            {
+            }
+        }
+        taskEXIT_CRITICAL();
+    }
+    #endif
+
+    /* Each input starts here, so time it from here. */
+    #if ( verdictPASS_AFTER_MS != 0 )
+    {
+        xTimerReset( xPassTimer, 0 );
+    }
+    #endif
+}
+/*-----------------------------------------------------------*/
+
+#if ( verdictPASS_AFTER_MS != 0 )
+
+    static void prvPassTimerCallback( TimerHandle_t xTimer )
+    {
+        ( void ) xTimer;
+
+        vVerdictExit( eVerdictPass, NULL );
+    }
+
+#endif
+/*-----------------------------------------------------------*/
+
+void vVerdictExit( Verdict_t eVerdict,
+                   const char * pcDetail )
+{
+    UBaseType_t uxSavedInterruptStatus;
+
+    uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+
+    if( xReported != pdFALSE )
+    {
+        portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+        return;
+    }
+
+    xReported = pdTRUE;
+
+    /* Records written just before the verdict, such as the missed deadline
+     * itself, go out before the verdict line. */
+    vLogFlush();
+
+    /* The host reads the coverage of the run once it has seen the verdict
+     * line, or QEMU has exited. */
+    #if ( ( coverageENABLED == 1 ) && ( verdictUSE_SEMIHOSTING == 1 ) )
+    {
+        vCoverageDump();
+    }
+    #endif
+
+    printf( "VERDICT: %s%s%s (%u)\r\n",
+            prvVerdictName( eVerdict ),
+            ( pcDetail != NULL ) ? " " : "",
+            ( pcDetail != NULL ) ? pcDetail : "",
+            ( unsigned ) eVerdict );
+    vUARTFlush();
+
+    /* The trace events just before the verdict are the ones that explain
+     * it, so send what the UART1 stream port still holds too. */
+    #if ( configUSE_TRACE_RECORDER == 1 ) && defined( TRC_STREAM_PORT_UART )
+    {
+        vTraceStreamPortFlush();
+    }
+    #endif
+
+    #if ( verdictPERSISTENT == 1 )
+    {
+        /* The host restores the snapshot taken in vVerdictReady().  Until
+         * then the rest of the input is read and dropped, so that it is not
+         * left in QEMU to reach the restored system ahead of the next input. */
+        for( ; ; )
+        {
+            if( ( CMSDK_UART0->STATE & CMSDK_UART_STATE_RXBF_Msk ) != 0UL )
+            {
+                ( void ) CMSDK_UART0->DATA;
+            }
+
+            CMSDK_UART0->STATE = CMSDK_UART_STATE_RXOR_Msk;
+        }
+    }
+    #elif ( verdictUSE_SEMIHOSTING == 1 )
+    {
+        prvSemihostingExit( ( uint32_t ) eVerdict );
+    }
+    #endif
+
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+}
+/*-----------------------------------------------------------*/
+
+void vVerdictHardFault( void )
+{
+    vVerdictExit( eVerdictHardFault, NULL );
+}
+/*-----------------------------------------------------------*/
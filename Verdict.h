@@ -0,0 +1,105 @@
+/*
+ * Test verdicts reported to the host through semihosting.
+ *
+ * A test run under QEMU has an outcome as soon as a task misses its deadline
+ * or one of the fatal hooks in main.c runs (assert, stack overflow, failed
+ * allocation, hard fault).  vVerdictExit() prints a "VERDICT:" line, sends
+ * the records still waiting in the binary log buffers (BinaryLog.h), flushes
+ * the console and then ends the QEMU process with the verdict as its exit
+ * status, so the host scripts do not have to wait for a timeout to find out.
+ *
+ * The exit uses the semihosting SYS_EXIT_EXTENDED call, as SYS_EXIT cannot
+ * pass an exit status on 32 bit targets.  QEMU only services it when started
+ * with "-semihosting-config enable=on"; without that the BKPT instruction is
+ * taken as a hard fault.  Set verdictUSE_SEMIHOSTING to 0 for such runs, or
+ * on hardware without a debugger attached, in which case vVerdictExit()
+ * returns after flushing and its caller halts as before.
+ *
+ * Persistent mode, verdictPERSISTENT set to 1 ("make PERSISTENT=1"), is for
+ * fuzzing without booting for every input.  NetTask calls vVerdictReady()
+ * once it is waiting for packets, which prints verdictREADY_MARKER and waits
+ * with interrupts masked for the first byte of input on UART0.  The host stops
+ * QEMU and snapshots it there (scripts/persistent_qemu.py), and restores the
+ * snapshot before each input, so every input starts from the same state and
+ * the pass timer from its first byte.  vVerdictExit() then halts instead of
+ * exiting, reading and dropping what is left of the input, and the host takes
+ * the verdict from the "VERDICT:" line, which ends with the status in
+ * brackets.
+ *
+ * scripts/verdict.py parses the Verdict_t values below to name the exit
+ * status, so each must keep the "eVerdictName = value," layout.  Status 1 is
+ * left out because QEMU uses it for its own errors.
+ */
+
+#ifndef VERDICT_H
+#define VERDICT_H
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+#ifndef verdictUSE_SEMIHOSTING
+    #define verdictUSE_SEMIHOSTING         1
+#endif
+
+/* Set to 0 to keep running after a missed deadline, which is then only
+ * logged. */
+#ifndef verdictEXIT_ON_DEADLINE_MISS
+    #define verdictEXIT_ON_DEADLINE_MISS    1
+#endif
+
+#ifndef verdictPERSISTENT
+    #define verdictPERSISTENT              0
+#endif
+
+#ifndef verdictREADY_MARKER
+    #define verdictREADY_MARKER            "READY FOR INPUT"
+#endif
+
+/* If not 0, the run ends with eVerdictPass after this many milliseconds
+ * without a failure, counted from vVerdictReady().  0 runs until a failure or
+ * the host's timeout. */
+#ifndef verdictPASS_AFTER_MS
+    #define verdictPASS_AFTER_MS           0
+#endif
+
+typedef enum
+{
+    eVerdictPass = 0,
+    eVerdictDeadlineMissed = 2,
+    eVerdictAssert = 3,
+    eVerdictStackOverflow = 4,
+    eVerdictMallocFailed = 5,
+    eVerdictHardFault = 6,
+} Verdict_t;
+
+/*
+ * Start the pass timer if verdictPASS_AFTER_MS is not 0.  Call before
+ * starting the scheduler.
+ */
+void vVerdictInit( void );
+
+/*
+ * Restart the pass timer.  Called by the task that consumes the test input,
+ * once it is ready to receive it.  In persistent mode it first prints
+ * verdictREADY_MARKER and waits for the first byte of input.
+ */
+void vVerdictReady( void );
+
+/*
+ * Report eVerdict and end the run.  pcDetail, which can be NULL, is added to
+ * the printed line - the name of the task or file concerned, for example.
+ * Can be called from any context, including with interrupts masked.  Only
+ * returns if verdictUSE_SEMIHOSTING and verdictPERSISTENT are 0, or if called
+ * again while a verdict is already being reported.
+ */
+void vVerdictExit( Verdict_t eVerdict,
+                   const char * pcDetail );
+
+/*
+ * vVerdictExit( eVerdictHardFault, NULL ), for the hard fault handler in
+ * startup_gcc.c.
+ */
+void vVerdictHardFault( void );
+
+#endif /* VERDICT_H */
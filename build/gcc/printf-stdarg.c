@@ -18,218 +18,339 @@
 */
 
 /*
-	putchar is the only external dependency for this file,
-	if you have a working putchar, leave it commented out.
-	If not, uncomment the define below and
-	replace outbyte(c) by your own function call.
-
+	One formatter, tiny_print(), serves printf(), vprintf(), sprintf(),
+	snprintf() and vsnprintf().  It appends to a buffer in runs of characters
+	rather than one character at a time, and a full buffer goes to the sink of
+	the call: for printf() a chunk buffer on the stack that is passed to the
+	UART driver whenever it fills, for the string functions the caller's
+	buffer, with no sink.  See printf-stdarg.h.
 */
 
 #include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "UARTDriver.h"
+#include "printf-stdarg.h"
+
+typedef struct print_out
+{
+	char *buf;			/* Where the output is assembled. */
+	size_t size;		/* Characters buf can hold, less the terminator of a string. */
+	size_t used;
+	PrintfSink_t sink;	/* Takes a full buf, or NULL if what does not fit is dropped. */
+	void *context;
+	int count;			/* Characters produced, including any dropped. */
+} print_out_t;
+
+/* "00" to "99", indexed by twice the value. */
+static const char digit_pairs[ 201 ] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static void console_sink( void *context, const char *data, size_t length )
+{
+	( void ) context;
 
-#define UART0_ADDRESS 	( 0x40004000UL )
-#define UART0_DATA		( * ( ( ( volatile unsigned int * )( UART0_ADDRESS + 0UL ) ) ) )
-#define putchar(c)      UART0_DATA = c
+	/* In buffered mode the chunk is queued as a whole, or what does not fit
+	is dropped and counted by the driver. */
+	( void ) xUARTWrite( data, length );
+}
 
-static int tiny_print( char **out, const char *format, va_list args, unsigned int buflen );
+static PrintfSink_t printf_sink = console_sink;
+static void *printf_context = NULL;
 
-static void printchar(char **str, int c, char *buflimit)
+void vPrintfSetSink( PrintfSink_t xSink, void * pvContext )
 {
-	if (str) {
-		if( buflimit == ( char * ) 0 ) {
-			/* Limit of buffer not known, write charater to buffer. */
-			**str = (char)c;
-			++(*str);
-		}
-		else if( ( ( unsigned long ) *str ) < ( ( unsigned long ) buflimit ) ) {
-			/* Within known limit of buffer, write character. */
-			**str = (char)c;
-			++(*str);
-		}
+	printf_context = pvContext;
+	printf_sink = ( xSink != NULL ) ? xSink : console_sink;
+}
+
+/* Room left in the buffer, after passing it to the sink if it is full. */
+static size_t room( print_out_t *out )
+{
+	if( ( out->used == out->size ) && ( out->sink != NULL ) ) {
+		out->sink( out->context, out->buf, out->used );
+		out->used = 0;
 	}
-	else
-	{
-		putchar(c);
+	return out->size - out->used;
+}
+
+static void printstr( print_out_t *out, const char *string, size_t length )
+{
+	size_t n;
+
+	out->count += ( int ) length;
+	while( ( length > 0 ) && ( ( n = room( out ) ) > 0 ) ) {
+		if( n > length ) n = length;
+		memcpy( out->buf + out->used, string, n );
+		out->used += n;
+		string += n;
+		length -= n;
+	}
+}
+
+static void printpad( print_out_t *out, char padchar, size_t length )
+{
+	size_t n;
+
+	out->count += ( int ) length;
+	while( ( length > 0 ) && ( ( n = room( out ) ) > 0 ) ) {
+		if( n > length ) n = length;
+		memset( out->buf + out->used, padchar, n );
+		out->used += n;
+		length -= n;
 	}
 }
 
 #define PAD_RIGHT 1
 #define PAD_ZERO 2
 
-static int prints(char **out, const char *string, int width, int pad, char *buflimit)
+static void prints( print_out_t *out, const char *string, int width, int prec, int pad )
 {
-	register int pc = 0, padchar = ' ';
-
-	if (width > 0) {
-		register int len = 0;
-		register const char *ptr;
-		for (ptr = string; *ptr; ++ptr) ++len;
-		if (len >= width) width = 0;
-		else width -= len;
-		if (pad & PAD_ZERO) padchar = '0';
-	}
-	if (!(pad & PAD_RIGHT)) {
-		for ( ; width > 0; --width) {
-			printchar (out, padchar, buflimit);
-			++pc;
-		}
-	}
-	for ( ; *string ; ++string) {
-		printchar (out, *string, buflimit);
-		++pc;
-	}
-	for ( ; width > 0; --width) {
-		printchar (out, padchar, buflimit);
-		++pc;
-	}
+	size_t len = 0, fill = 0;
 
-	return pc;
+	/* At most prec characters, if a precision was given. */
+	while( string[ len ] != '\0' && ( prec < 0 || len < ( size_t ) prec ) ) ++len;
+	if( width > 0 && ( size_t ) width > len ) fill = ( size_t ) width - len;
+
+	if( !( pad & PAD_RIGHT ) ) printpad( out, ( pad & PAD_ZERO ) ? '0' : ' ', fill );
+	printstr( out, string, len );
+	if( pad & PAD_RIGHT ) printpad( out, ' ', fill );
 }
 
 /* the following should be enough for 32 bit int */
 #define PRINT_BUF_LEN 12
 
-static int printi(char **out, int i, int b, int sg, int width, int pad, int letbase, char *buflimit)
+/* Prints u in base 10 or 16 after prefix ("-" or "0x"), padded to width and
+with at least prec digits. */
+static void printi( print_out_t *out, unsigned int u, int b, const char *prefix, int width, int prec, int pad, int letbase )
 {
-	char print_buf[PRINT_BUF_LEN];
-	register char *s;
-	register int t, neg = 0, pc = 0;
-	register unsigned int u = (unsigned int)i;
-
-	if (i == 0) {
-		print_buf[0] = '0';
-		print_buf[1] = '\0';
-		return prints (out, print_buf, width, pad, buflimit);
+	char print_buf[ PRINT_BUF_LEN ];
+	char * const end = print_buf + PRINT_BUF_LEN;
+	char *s = end;
+	const char *pair;
+	size_t len, zeros = 0, fill = 0, prefix_len = 0;
+
+	if( b == 10 ) {
+		/* Two digits per division, which the compiler turns into a multiply. */
+		while( u >= 100U ) {
+			unsigned int q = u / 100U;
+			pair = &digit_pairs[ ( u - q * 100U ) * 2U ];
+			*--s = pair[ 1 ];
+			*--s = pair[ 0 ];
+			u = q;
+		}
+		if( u >= 10U ) {
+			pair = &digit_pairs[ u * 2U ];
+			*--s = pair[ 1 ];
+			*--s = pair[ 0 ];
+		}
+		else {
+			*--s = ( char ) ( '0' + u );
+		}
 	}
-
-	if (sg && b == 10 && i < 0) {
-		neg = 1;
-		u = (unsigned int)-i;
+	else {
+		const char *digits = ( letbase == 'A' ) ? "0123456789ABCDEF" : "0123456789abcdef";
+		do {
+			*--s = digits[ u & 0xFU ];
+			u >>= 4;
+		} while( u );
 	}
 
-	s = print_buf + PRINT_BUF_LEN-1;
-	*s = '\0';
-
-	while (u) {
-		t = (unsigned int)u % b;
-		if( t >= 10 )
-			t += letbase - '0' - 10;
-		*--s = (char)(t + '0');
-		u /= b;
+	len = ( size_t ) ( end - s );
+	if( prec >= 0 ) {
+		/* A precision replaces the zero padding, and zero with a precision
+		of 0 prints no digits. */
+		pad &= ~PAD_ZERO;
+		if( prec == 0 && len == 1 && *s == '0' ) len = 0;
+		if( ( size_t ) prec > len ) zeros = ( size_t ) prec - len;
 	}
-
-	if (neg) {
-		if( width && (pad & PAD_ZERO) ) {
-			printchar (out, '-', buflimit);
-			++pc;
-			--width;
-		}
-		else {
-			*--s = '-';
-		}
+	while( prefix && prefix[ prefix_len ] ) ++prefix_len;
+	if( width > 0 && ( size_t ) width > prefix_len + zeros + len ) {
+		fill = ( size_t ) width - ( prefix_len + zeros + len );
 	}
 
-	return pc + prints (out, s, width, pad, buflimit);
+	if( !( pad & ( PAD_RIGHT | PAD_ZERO ) ) ) printpad( out, ' ', fill );
+	printstr( out, prefix, prefix_len );
+	if( ( pad & ( PAD_RIGHT | PAD_ZERO ) ) == PAD_ZERO ) printpad( out, '0', fill );
+	printpad( out, '0', zeros );
+	printstr( out, s, len );
+	if( pad & PAD_RIGHT ) printpad( out, ' ', fill );
 }
 
-static int tiny_print( char **out, const char *format, va_list args, unsigned int buflen )
+static int tiny_print( print_out_t *out, const char *format, va_list args )
 {
-	register int width, pad;
-	register int pc = 0;
-	char scr[2], *buflimit;
-
-	if( buflen == 0 ){
-		buflimit = ( char * ) 0;
-	}
-	else {
-		/* Calculate the last valid buffer space, leaving space for the NULL
-		terminator. */
-		buflimit = ( *out ) + ( buflen - 1 );
-	}
+	const char *start;
+	int width, prec, pad;
+
+	while( *format != '\0' ) {
+		if( *format != '%' ) {
+			/* Copy the text up to the next conversion in one go. */
+			start = format;
+			while( *format != '\0' && *format != '%' ) ++format;
+			printstr( out, start, ( size_t ) ( format - start ) );
+			continue;
+		}
 
-	for (; *format != 0; ++format) {
-		if (*format == '%') {
-			++format;
-			width = pad = 0;
-			if (*format == '\0') break;
-			if (*format == '%') goto out;
-			if (*format == '-') {
-				++format;
-				pad = PAD_RIGHT;
+		start = format++;
+		width = pad = 0;
+		prec = -1;
+		for( ; ; ++format ) {
+			if( *format == '-' ) pad |= PAD_RIGHT;
+			else if( *format == '0' ) pad |= PAD_ZERO;
+			else break;
+		}
+		if( *format == '*' ) {
+			width = va_arg( args, int );
+			if( width < 0 ) {
+				pad |= PAD_RIGHT;
+				width = -width;
 			}
-			while (*format == '0') {
+			++format;
+		}
+		for( ; *format >= '0' && *format <= '9'; ++format ) {
+			width = width * 10 + ( *format - '0' );
+		}
+		if( *format == '.' ) {
+			++format;
+			prec = 0;
+			if( *format == '*' ) {
+				prec = va_arg( args, int );
+				if( prec < 0 ) prec = -1;
 				++format;
-				pad |= PAD_ZERO;
 			}
-			for ( ; *format >= '0' && *format <= '9'; ++format) {
-				width *= 10;
-				width += *format - '0';
+			for( ; *format >= '0' && *format <= '9'; ++format ) {
+				prec = prec * 10 + ( *format - '0' );
 			}
-			if( *format == 's' ) {
-				register char *s = (char *)va_arg( args, int );
-				pc += prints (out, s?s:"(null)", width, pad, buflimit);
-				continue;
-			}
-			if( *format == 'd' ) {
-				pc += printi (out, va_arg( args, int ), 10, 1, width, pad, 'a', buflimit);
-				continue;
-			}
-			if( *format == 'x' ) {
-				pc += printi (out, va_arg( args, int ), 16, 0, width, pad, 'a', buflimit);
-				continue;
+		}
+		/* int, long and size_t are all 32 bits. */
+		while( *format == 'l' || *format == 'h' || *format == 'z' ) ++format;
+
+		switch( *format ) {
+			case 's': {
+				const char *s = va_arg( args, const char * );
+				prints( out, s ? s : "(null)", width, prec, pad );
+				break;
 			}
-			if( *format == 'X' ) {
-				pc += printi (out, va_arg( args, int ), 16, 0, width, pad, 'A', buflimit);
-				continue;
+			case 'c': {
+				/* char are converted to int then pushed on the stack */
+				char scr[ 2 ];
+				scr[ 0 ] = ( char ) va_arg( args, int );
+				scr[ 1 ] = '\0';
+				prints( out, scr, width, -1, pad & PAD_RIGHT );
+				break;
 			}
-			if( *format == 'u' ) {
-				pc += printi (out, va_arg( args, int ), 10, 0, width, pad, 'a', buflimit);
-				continue;
+			case 'd':
+			case 'i': {
+				int i = va_arg( args, int );
+				if( i < 0 ) printi( out, 0U - ( unsigned int ) i, 10, "-", width, prec, pad, 'a' );
+				else printi( out, ( unsigned int ) i, 10, NULL, width, prec, pad, 'a' );
+				break;
 			}
-			if( *format == 'c' ) {
-				/* char are converted to int then pushed on the stack */
-				scr[0] = (char)va_arg( args, int );
-				scr[1] = '\0';
-				pc += prints (out, scr, width, pad, buflimit);
+			case 'u':
+				printi( out, va_arg( args, unsigned int ), 10, NULL, width, prec, pad, 'a' );
+				break;
+			case 'x':
+				printi( out, va_arg( args, unsigned int ), 16, NULL, width, prec, pad, 'a' );
+				break;
+			case 'X':
+				printi( out, va_arg( args, unsigned int ), 16, NULL, width, prec, pad, 'A' );
+				break;
+			case 'p':
+				printi( out, ( unsigned int ) ( size_t ) va_arg( args, void * ), 16, "0x", width, 8, pad, 'a' );
+				break;
+			case '%':
+				printstr( out, "%", 1 );
+				break;
+			case '\0':
+				/* A '%' at the end of the format is ignored. */
 				continue;
-			}
-		}
-		else {
-		out:
-			printchar (out, *format, buflimit);
-			++pc;
+			default:
+				/* Not a conversion, so print it as it stands. */
+				printstr( out, start, ( size_t ) ( format - start ) + 1 );
+				break;
 		}
+		++format;
 	}
-	if (out) **out = '\0';
-	va_end( args );
+
+	if( out->sink != NULL && out->used > 0 ) {
+		out->sink( out->context, out->buf, out->used );
+		out->used = 0;
+	}
+	return out->count;
+}
+
+int xPrintfFormat( PrintfSink_t xSink, void * pvContext, char * pcBuffer, size_t xBufferSize,
+				   const char * pcFormat, va_list xArgs )
+{
+	print_out_t out = { pcBuffer, xBufferSize, 0, xSink, pvContext, 0 };
+
+	return tiny_print( &out, pcFormat, xArgs );
+}
+
+/* Formats into buf, which holds size characters including the terminator
+(unbounded if size is (size_t)-1).  Nothing is written if size is 0. */
+static int print_string( char *buf, size_t size, const char *format, va_list args )
+{
+	print_out_t out = { buf, ( size > 0 ) ? size - 1 : 0, 0, NULL, NULL, 0 };
+	int pc = tiny_print( &out, format, args );
+
+	if( size > 0 ) buf[ out.used ] = '\0';
 	return pc;
 }
 
+int vprintf(const char *format, va_list args)
+{
+	char chunk[ printfCHUNK_SIZE ];
+
+	return xPrintfFormat( printf_sink, printf_context, chunk, sizeof( chunk ), format, args );
+}
+
 int printf(const char *format, ...)
 {
-        va_list args;
+	va_list args;
+	int pc;
 
-        va_start( args, format );
-        return tiny_print( 0, format, args, 0 );
+	va_start( args, format );
+	pc = vprintf( format, args );
+	va_end( args );
+	return pc;
 }
 
 int sprintf(char *out, const char *format, ...)
 {
-        va_list args;
+	va_list args;
+	int pc;
 
-        va_start( args, format );
-        return tiny_print( &out, format, args, 0 );
+	va_start( args, format );
+	pc = print_string( out, ( size_t ) -1, format, args );
+	va_end( args );
+	return pc;
 }
 
-
-int snprintf( char *buf, unsigned int count, const char *format, ... )
+int vsnprintf( char *buf, size_t count, const char *format, va_list args )
 {
-        va_list args;
+	return print_string( buf, count, format, args );
+}
 
-        ( void ) count;
+int snprintf( char *buf, size_t count, const char *format, ... )
+{
+	va_list args;
+	int pc;
 
-        va_start( args, format );
-        return tiny_print( &buf, format, args, count );
+	va_start( args, format );
+	pc = print_string( buf, count, format, args );
+	va_end( args );
+	return pc;
 }
 
 
@@ -264,6 +385,8 @@ int main(void)
 	sprintf(buf, "-3: %04d zero padded\n", -3); printf("%s", buf);
 	sprintf(buf, "-3: %-4d left justif.\n", -3); printf("%s", buf);
 	sprintf(buf, "-3: %4d right justif.\n", -3); printf("%s", buf);
+	snprintf(buf, sizeof(buf), "prec: %.3d %.2s\n", 7, "abc"); printf("%s", buf);
+	snprintf(buf, 6, "truncated"); printf("%s\n", buf);
 
 	return 0;
 }
@@ -296,6 +419,8 @@ int main(void)
  * -3: -003 zero padded
  * -3: -3   left justif.
  * -3:   -3 right justif.
+ * prec: 007 ab
+ * trunc
  */
 
 #endif
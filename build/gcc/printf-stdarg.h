@@ -0,0 +1,53 @@
+/*
+ * Formatted output for the GCC build, in place of the C library's printf().
+ *
+ * printf(), vprintf(), sprintf(), snprintf() and vsnprintf() share a single
+ * formatter, tiny_print() in printf-stdarg.c.  It formats into a buffer and
+ * hands the buffer to a sink each time it fills and once at the end,
+ * instead of emitting one character at a time.  For printf() the buffer is
+ * printfCHUNK_SIZE bytes on the caller's stack and the sink is the console
+ * (xUARTWrite(), blocking or buffered as set by uartUSE_BUFFERED_TX), so a
+ * line reaches the UART driver in one call rather than one per character.  For
+ * the string functions the caller's buffer is the destination and there is no
+ * sink.
+ *
+ * There is no state outside the call, so any number of tasks may print at the
+ * same time.  With the buffered UART each chunk is queued in one piece, so the
+ * output of a printf() of up to printfCHUNK_SIZE characters is never split by
+ * another task's.
+ *
+ * Conversions: %s %c %d %i %u %x %X %p and %%, with the '-' and '0' flags, a
+ * width and a precision (either may be '*'), and the 'l', 'h' and 'z' length
+ * modifiers, which are accepted and ignored as every integer is 32 bits here.
+ * Decimal numbers are converted two digits at a time from a lookup table.
+ */
+
+#ifndef PRINTF_STDARG_H
+#define PRINTF_STDARG_H
+
+#include <stdarg.h>
+#include <stddef.h>
+
+/* Bytes of printf() output buffered on the stack before they go to the sink. */
+#ifndef printfCHUNK_SIZE
+	#define printfCHUNK_SIZE	( 64U )
+#endif
+
+/* Receives each chunk of formatted output.  pvContext is the value given to
+vPrintfSetSink(). */
+typedef void ( * PrintfSink_t )( void * pvContext, const char * pcData, size_t xLength );
+
+/*
+ * Send the output of printf() and vprintf() to xSink rather than to the
+ * console, for example to capture it in a test.  NULL restores the console.
+ */
+void vPrintfSetSink( PrintfSink_t xSink, void * pvContext );
+
+/*
+ * Format into xSink, buffering up to xBufferSize bytes in pcBuffer.  Returns
+ * the number of characters produced.
+ */
+int xPrintfFormat( PrintfSink_t xSink, void * pvContext, char * pcBuffer, size_t xBufferSize,
+				   const char * pcFormat, va_list xArgs );
+
+#endif /* PRINTF_STDARG_H */
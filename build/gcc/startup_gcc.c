@@ -31,8 +31,20 @@
 extern void vPortSVCHandler( void );
 extern void xPortPendSVHandler( void );
 extern void xPortSysTickHandler( void );
-extern void TIMER0_Handler( void );
-extern void TIMER1_Handler( void );
+extern void UARTTX0_Handler( void );
+extern void DUALTIMER_Handler( void );
+
+/* Only defined by the applications that use them: the packet receiver in
+ * UARTPacketRx.c (secure) and the timers in IntQueueTimer.c (full) and
+ * Benchmark.c (bench).  The vector is 0 in the others. */
+extern void UARTRX0_Handler( void ) __attribute__( ( weak ) );
+extern void TIMER0_Handler( void ) __attribute__( ( weak ) );
+extern void TIMER1_Handler( void ) __attribute__( ( weak ) );
+
+/* Only defined when the trace is streamed on UART1 (TRACE_PORT=UART). */
+extern void UARTTX1_Handler( void ) __attribute__( ( weak ) );
+extern void vUARTFlush( void );
+extern void vVerdictHardFault( void );
 
 /* Exception handlers. */
 static void HardFault_Handler( void ) __attribute__( ( naked ) );
@@ -61,17 +73,17 @@ const uint32_t* isr_vector[] __attribute__((section(".isr_vector"), used)) =
     0, // reserved   -3
     ( uint32_t * ) &xPortPendSVHandler, // PendSV handler       -2
     ( uint32_t * ) &xPortSysTickHandler,// SysTick_Handler      -1
-    0,
-    0,
-    0,
-    0,
+    ( uint32_t * ) UARTRX0_Handler,    // UART 0 RX  0
+    ( uint32_t * ) UARTTX0_Handler,    // UART 0 TX  1
+    0,                                 // UART 1 RX  2
+    ( uint32_t * ) UARTTX1_Handler,    // UART 1 TX  3
     0,
     0,
     0,
     0,
     ( uint32_t * ) TIMER0_Handler,     // Timer 0
     ( uint32_t * ) TIMER1_Handler,     // Timer 1
-    0,
+    ( uint32_t * ) DUALTIMER_Handler,  // Dual timer
     0,
     0,
     0, // Ethernet   13
@@ -112,6 +124,12 @@ __attribute__( ( used ) ) void prvGetRegistersFromStack( uint32_t *pulFaultStack
     printf( "Calling prvGetRegistersFromStack() from fault handler" );
     fflush( stdout );
 
+    /* The UART TX interrupt cannot run while the fault is being handled. */
+    vUARTFlush();
+
+    /* Ends a QEMU run with the hard fault status (Verdict.h). */
+    vVerdictHardFault();
+
     /* When the following line is hit, the variables contain the register values. */
     for( ;; );
 }
@@ -9,6 +9,7 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "semphr.h"
+#include "timers.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -18,113 +19,223 @@
 #include <stdlib.h>
 
 /* TraceRecorder includes (if used). */
+#if ( configUSE_TRACE_RECORDER == 1 )
 #include <trcRecorder.h>
+#endif
+
+/* Console output over the QEMU UART. */
+#include "UARTDriver.h"
+
+/* Hot path telemetry is recorded in binary and formatted on the host. */
+#include "BinaryLog.h"
+
+/* Cycle accurate execution time and jitter measurement. */
+#include "TaskTiming.h"
+
+/* Lock-free single writer, multiple reader shared state. */
+#include "SharedState.h"
+
+/* Zero-copy receive ring between the network driver and NetTask. */
+#include "PacketRing.h"
+
+/* Incremental MQTT 3.1.1 decoder for the received byte stream. */
+#include "MqttDecoder.h"
+
+/* Length prefixed packets received on UART0, written into the receive ring. */
+#include "UARTPacketRx.h"
+
+/* Fixed size block pools, optionally serving small malloc() requests. */
+#include "MemPool.h"
+
+/* Allocation counts, sizes and latencies of the heap_4 wrappers below. */
+#include "HeapMonitor.h"
+
+/* Per task CPU load, stack high water marks and context switches. */
+#include "RunTimeStats.h"
+
+/* Stops the tick while every task is blocked. */
+#include "TicklessIdle.h"
+
+/* Interrupt latency and critical section profiling, with make ISR_PROFILE=1. */
+#include "IsrProfiler.h"
+
+/* Ends the QEMU run with an exit status as soon as the outcome is known. */
+#include "Verdict.h"
+
+/* The application main() starts, set by build/gcc/Makefile from its APP
+ * variable.  The blinky, full and bench applications are in main_blinky.c,
+ * main_full.c and main_bench.c; the rest of this file is shared by all four. */
+#define mainAPP_SECURE              1
+#define mainAPP_BLINKY              2
+#define mainAPP_FULL                3
+#define mainAPP_BENCH               4
+#ifndef mainAPP
+#define mainAPP                     mainAPP_SECURE
+#endif
+
+#if ( mainAPP == mainAPP_BLINKY )
+extern void main_blinky( void );
+#elif ( mainAPP == mainAPP_FULL )
+extern void main_full( void );
+extern void vFullDemoTickHookFunction( void );
+#elif ( mainAPP == mainAPP_BENCH )
+extern void main_bench( void );
+#include "Benchmark.h"
+#endif
+
+/* Execution time budget of each task, and how often the timing summary is printed. */
+#define mainSENSOR_DEADLINE_US      ( 5000UL )
+#define mainNET_DEADLINE_US         ( 5000UL )
+#define mainSTATS_PERIOD_MS         ( 5000UL )
+
+/* Most packets NetTask takes from the receive ring per batch. */
+#define mainNET_RX_BATCH            ( 4U )
+
+/* Set to 1 for the legacy receive path, where NetTask polls the ring every
+ * 10 ms, or 0 to have NetTask sleep until the driver notifies it.  Both use
+ * the same simulated driver so the NetRxLat figures can be compared. */
+#define mainNET_RX_POLLING          0
+
+/* Notification array index used for receive events.  Index 0 is left for
+ * kernel objects such as stream buffers. */
+#define mainNET_RX_NOTIFY_INDEX     ( 1U )
+
+/* Set to 1 to receive packets framed on UART0 (UARTPacketRx.h), which is how
+ * fuzz_test.py delivers its inputs, or 0 for the simulated driver that
+ * delivers the same CONNECT packet every mainNET_RX_PERIOD_MS. */
+#define mainNET_RX_FROM_UART        1
+
+/* Interval of the simulated driver, and the longest NetTask sleeps without a
+ * packet before doing its housekeeping. */
+#define mainNET_RX_PERIOD_MS        ( 10UL )
+#define mainNET_HOUSEKEEPING_MS     ( 100UL )
+
+/* Seed of the rand() calls that inject the random delays.  Kept fixed so that
+ * runs in QEMU's deterministic timing mode (-icount) repeat exactly; set with
+ * "make RANDOM_SEED=n". */
+#ifndef mainRANDOM_SEED
+#define mainRANDOM_SEED             ( 1U )
+#endif
 
-/* Hardware setup for QEMU UART prints. */
-#define UART0_ADDRESS         ( 0x40004000UL )
-#define UART0_DATA            ( *( ( volatile uint32_t * ) ( UART0_ADDRESS + 0UL ) ) )
-#define UART0_STATE           ( *( ( volatile uint32_t * ) ( UART0_ADDRESS + 4UL ) ) )
-#define UART0_CTRL            ( *( ( volatile uint32_t * ) ( UART0_ADDRESS + 8UL ) ) )
-#define UART0_BAUDDIV         ( *( ( volatile uint32_t * ) ( UART0_ADDRESS + 16UL ) ) )
-#define TX_BUFFER_MASK        ( 1UL )
+#if ( mainAPP == mainAPP_SECURE )
 
-static void prvUARTInit( void );
 static void vSensorTask( void *pvParameters );
 static void vSecureNetworkTask( void *pvParameters );
+static void vStatsTask( void *pvParameters );
 
-/* Shared resource for concurrency example. */
-static uint16_t sSensorData = 0;
-static SemaphoreHandle_t xSensorMutex = NULL;
+/* Shared resource for concurrency example.  Written only by SensorTask, read
+ * by any task without taking a lock. */
+typedef struct SensorSample
+{
+    uint16_t value;
+    TickType_t timestamp;
+} SensorSample_t;
+
+static SensorSample_t xSensorSlots[ 2 ];
+static SharedState_t xSensorState;
+
+/* Per-task telemetry buffers, emptied by the log drain task. */
+static LogBuffer_t xSensorLog;
+static LogBuffer_t xNetLog;
+
+/* Per-task execution time statistics, printed by the stats task. */
+static TimingStats_t xSensorTiming;
+static TimingStats_t xNetTiming;
+static TimingStats_t xNetLatency;
+
+/* Filled in place by the (simulated) network driver, drained by NetTask. */
+static PacketRing_t xNetRxRing;
+
+/* Decodes the MQTT stream carried by the received packets. */
+static MqttDecoder_t xMqttDecoder;
+
+/* Receive event plumbing between the driver and NetTask. */
+static TaskHandle_t xNetTaskHandle = NULL;
+#if ( mainNET_RX_FROM_UART == 1 )
+#define netRX_STAMP_CYCLES()    ulUARTRxGetStampCycles()
+#else
+static volatile uint32_t ulNetRxStampCycles = 0;
+static void vNetRxTimerCallback( TimerHandle_t xTimer );
+#define netRX_STAMP_CYCLES()    ulNetRxStampCycles
+#endif
+
+#endif /* mainAPP == mainAPP_SECURE */
 
 int main( void )
 {
-#if ( configUSE_TRACE_FACILITY == 1 )
+#if ( configUSE_TRACE_RECORDER == 1 )
     xTraceInitialize();
     xTraceEnable( TRC_START );
     xTraceTimestampSetPeriod(configCPU_CLOCK_HZ / configTICK_RATE_HZ);
 #endif
 
-    /* Initialize random seed (if desired). In real embedded code, you might do a fixed seed. */
-    srand(1);  /* or srand(time(NULL)); if you have time() available */
+    /* Fixed seed, so the injected delays are the same on every run. */
+    srand(mainRANDOM_SEED);
 
-    /* Basic hardware init for UART so printf() goes to QEMU stdio. */
-    prvUARTInit();
+    /* Build the block pool free lists before anything can allocate. */
+    vPoolInit();
 
+    /* Basic hardware init for UART so printf() goes to QEMU stdio. */
+    vUARTInit();
+
+    /* Select the cycle counter used for the real-time checks. */
+    vTimingInit();
+
+    /* Ends the run with a pass after verdictPASS_AFTER_MS, if set. */
+    vVerdictInit();
+
+#if ( mainAPP == mainAPP_BLINKY )
+    /* Creates its tasks and starts the scheduler. */
+    main_blinky();
+#elif ( mainAPP == mainAPP_FULL )
+    main_full();
+#elif ( mainAPP == mainAPP_BENCH )
+    main_bench();
+#else
     printf("Starting FreeRTOS with integrated Sensor & Network tasks in main.c (with RT checks)\n");
+    printf("Random seed %u\n", (unsigned) mainRANDOM_SEED);
+
+    /* Initialise the shared sensor sample before any task can read it. */
+    vSharedStateInit(&xSensorState, xSensorSlots, sizeof(SensorSample_t), NULL);
+    vPacketRingInit(&xNetRxRing);
+    vTimingRegister(&xNetLatency, "NetRxLat", 0, 0);
 
     /* Create the SensorTask (lower priority). */
     xTaskCreate(vSensorTask, "SensorTask", configMINIMAL_STACK_SIZE + 100, NULL, 1, NULL);
 
     /* Create the SecureNetworkTask (higher priority). */
-    xTaskCreate(vSecureNetworkTask, "NetTask", configMINIMAL_STACK_SIZE + 200, NULL, 2, NULL);
+    xTaskCreate(vSecureNetworkTask, "NetTask", configMINIMAL_STACK_SIZE + 200, NULL, 2, &xNetTaskHandle);
+
+#if ( mainNET_RX_FROM_UART == 1 )
+    /* The UART0 RX interrupt frames the bytes from the host into packets. */
+#if ( mainNET_RX_POLLING == 1 )
+    vUARTRxInit(&xNetRxRing, NULL, 0);
+#else
+    vUARTRxInit(&xNetRxRing, xNetTaskHandle, mainNET_RX_NOTIFY_INDEX);
+#endif
+#else
+    /* Stands in for the network RX interrupt, delivering a packet every 10ms. */
+    TimerHandle_t xNetRxTimer = xTimerCreate("NetRx", pdMS_TO_TICKS(mainNET_RX_PERIOD_MS), pdTRUE, NULL, vNetRxTimerCallback);
+    configASSERT(xNetRxTimer);
+    xTimerStart(xNetRxTimer, 0);
+#endif
+
+    /* Moves the binary telemetry records to the console (lowest priority). */
+    vLogStartDrainTask();
+
+    /* Periodically prints the timing statistics (lowest priority). */
+    xTaskCreate(vStatsTask, "Stats", configMINIMAL_STACK_SIZE + 128, NULL, tskIDLE_PRIORITY, NULL);
 
     /* Start the FreeRTOS scheduler. Should never return. */
     vTaskStartScheduler();
+#endif
 
     /* If we ever break out of the scheduler, handle it here. */
     for( ;; );
     return 0;
 }
 
-/* Minimal check to see if a packet looks like MQTT. */
-static int isMqttPacket(const uint8_t *data, size_t length)
-{
-    /* A valid MQTT Control Packet has at least 2 bytes:
-       - byte[0] = Control Packet type/flags
-       - byte[1..n] = Remaining length (using variable-length encoding).
-     */
-    if (length < 2)
-    {
-        return 0;
-    }
-
-    /* Extract control packet type from bits 7..4.  MQTT valid range is 1..14. */
-    uint8_t controlPacketType = (data[0] & 0xF0) >> 4;
-    if (controlPacketType < 1 || controlPacketType > 14)
-    {
-        return 0; /* Not a valid MQTT type. */
-    }
-
-    /* Now parse the variable-length "Remaining Length" field. */
-    size_t offset = 1;        /* Start after the first byte (Control Packet type). */
-    size_t remainingLength = 0;
-    int shift = 0;
-
-    while (1)
-    {
-        /* If we've run out of buffer before finishing "Remaining Length", it's invalid. */
-        if (offset >= length)
-        {
-            return 0; 
-        }
-
-        uint8_t encodedByte = data[offset++];
-        remainingLength += (encodedByte & 0x7F) << shift;
-        shift += 7;
-
-        /* If MSB is 0, we finished reading the Remaining Length. */
-        if ((encodedByte & 0x80) == 0)
-        {
-            break;
-        }
-
-        /* MQTT spec says Remaining Length can be up to 4 bytes. If we exceed that, error out. */
-        if (shift > 28)
-        {
-            return 0;  /* Malformed (very large) Remaining Length. */
-        }
-    }
-
-    /* We’ve parsed the "Remaining Length". Check if the buffer has enough data. */
-    if (remainingLength > (length - offset))
-    {
-        return 0;  /* The stated Remaining Length doesn't fit in the provided packet data. */
-    }
-
-    /* If we got here, it’s minimally valid for MQTT. */
-    return 1;
-}
-
+#if ( mainAPP == mainAPP_SECURE )
 
 /*-----------------------------------------------------------*
  *  Task & Function Definitions
@@ -137,21 +248,15 @@ static uint16_t getSensorReadingFromHardware(void)
     return fakeValue++;
 }
 
-/* SensorTask: concurrency (mutex) + real-time check. */
+/* SensorTask: concurrency (lock-free shared state) + real-time check. */
 static void vSensorTask( void *pvParameters )
 {
     (void) pvParameters;
 
-    if (xSensorMutex == NULL)
-    {
-        xSensorMutex = xSemaphoreCreateMutex();
-        if (xSensorMutex == NULL)
-        {
-            printf("Failed to create sensor mutex!\n");
-            vTaskDelete(NULL);
-            return;
-        }
-    }
+    SensorSample_t sample;
+
+    vLogRegisterBuffer(&xSensorLog);
+    vTimingRegister(&xSensorTiming, "SensorTask", 100000UL, mainSENSOR_DEADLINE_US);
 
     /* Periodic task: every 100ms => 10 times/second => ~50 times in 5 seconds. */
     const TickType_t xPeriod = pdMS_TO_TICKS(100);
@@ -163,16 +268,14 @@ static void vSensorTask( void *pvParameters )
         vTaskDelayUntil(&xNextWakeTime, xPeriod);
 
         /* Start timing for real-time check. */
-        TickType_t startTime = xTaskGetTickCount();
+        vTimingStart(&xSensorTiming);
 
-        /* Lock shared data before updating. */
-        if (xSemaphoreTake(xSensorMutex, pdMS_TO_TICKS(50)) == pdTRUE)
-        {
-            sSensorData = getSensorReadingFromHardware();
-            xSemaphoreGive(xSensorMutex);
-        }
+        /* Publish the new sample; readers never block the writer. */
+        sample.value = getSensorReadingFromHardware();
+        sample.timestamp = xTaskGetTickCount();
+        vSharedStatePublish(&xSensorState, &sample);
 
-        printf("SensorTask: sSensorData=%u\n", sSensorData);
+        logWRITE1(&xSensorLog, logID_SENSOR_DATA, sample.value);
 
         /* -------------------------------
          *  Randomly force extra delay ~1/50 chance
@@ -180,73 +283,130 @@ static void vSensorTask( void *pvParameters )
          * ------------------------------- */
         if ((rand() % 50) == 0)
         {
-            /* Enough delay to exceed a 5-tick threshold. */
-            vTaskDelay(pdMS_TO_TICKS(60));  // ~6 ticks at 10 ms/tick
+            /* Enough delay to exceed the 5 ms budget. */
+            vTaskDelay(pdMS_TO_TICKS(60));
         }
 
-        /* End timing and compute the difference. */
-        TickType_t endTime = xTaskGetTickCount();
-        TickType_t diff = endTime - startTime;
+        /* End timing and compute the execution time. */
+        uint32_t elapsedUs = timingCYCLES_TO_US(ulTimingStop(&xSensorTiming));
 
-        /* If we took more than 5 ticks, consider that a missed deadline. */
-        if (diff > 5)
+        /* If we took more than 5 ms, consider that a missed deadline. */
+        if (elapsedUs > mainSENSOR_DEADLINE_US)
         {
-            printf("SensorTask: MISSED DEADLINE (took %u ticks)\n", (unsigned)diff);
+            logWRITE1(&xSensorLog, logID_SENSOR_MISSED, elapsedUs);
+#if ( verdictEXIT_ON_DEADLINE_MISS == 1 )
+            vVerdictExit(eVerdictDeadlineMissed, "SensorTask");
+#endif
         }
         else
         {
-            printf("SensorTask: took %u ticks\n", (unsigned)diff);
+            logWRITE1(&xSensorLog, logID_SENSOR_TOOK, elapsedUs);
         }
     }
 }
 
-/* A mock function simulating network driver input. */
-static int getIncomingPacket(uint8_t *buffer, size_t bufferSize)
+#if ( mainNET_RX_FROM_UART == 0 )
+
+/* A mock network driver: receives one packet straight into a ring slot. */
+static void simulateNetworkRx(PacketRing_t *ring)
 {
+    uint8_t *buffer = pucPacketRingAcquire(ring);
+    if (buffer == NULL)
+    {
+        /* Ring full - the packet is dropped and counted by the ring. */
+        return;
+    }
+
+    /* Stamp the oldest waiting packet for the NetRxLat latency figures. */
+    if (xPacketRingCount(ring) == 0)
+    {
+        ulNetRxStampCycles = ulTimingGetCycles();
+    }
+
     // Example: Fake an MQTT CONNECT packet of length 14 just for testing
     // (Control packet type = 1 (CONNECT), Remaining Length = 12)
-    if (bufferSize >= 14)
+    static const uint8_t connectPacket[14] =
     {
-        buffer[0] = 0x10; // bits 7..4 = 1 (CONNECT)
-        buffer[1] = 12;   // Remaining length
-        // Fill the rest with dummy payload...
-        for (int i = 2; i < 14; i++)
-        {
-            buffer[i] = (uint8_t)i;
-        }
-        return 14; // bytes read
-    }
-    return 0;
+        0x10, 12,                       // bits 7..4 = 1 (CONNECT), Remaining length
+        0x00, 4, 'M', 'Q', 'T', 'T',    // Protocol name
+        4,                              // Protocol level (3.1.1)
+        0x02,                           // Connect flags: clean session
+        0x00, 60,                       // Keep alive (seconds)
+        0x00, 0                         // Payload: empty client identifier
+    };
+    memcpy(buffer, connectPacket, sizeof(connectPacket));
+    vPacketRingCommit(ring, sizeof(connectPacket)); // bytes received
 }
 
-
-/* Basic boundary checks + real-time measure in "SecureNetworkTask". */
-static void handlePacket(const uint8_t *data, size_t length)
+/* Runs in the timer service task, as the network RX interrupt would. */
+static void vNetRxTimerCallback( TimerHandle_t xTimer )
 {
-    if (length < 2) {
-        return;
-    }
+    (void) xTimer;
 
-    uint8_t packetType = data[0];
-    uint8_t payloadLen = data[1];
+    simulateNetworkRx(&xNetRxRing);
 
-    if (payloadLen > (length - 2)) {
-        /* Avoid buffer overflow scenario. */
-        return;
-    }
+#if ( mainNET_RX_POLLING == 0 )
+    /* An ISR would use vTaskNotifyGiveIndexedFromISR() here instead. */
+    xTaskNotifyGiveIndexed(xNetTaskHandle, mainNET_RX_NOTIFY_INDEX);
+#endif
+}
+
+#endif /* mainNET_RX_FROM_UART */
 
-    /* Existing logging. */
-    printf("NetTask: Got packetType=%u, payloadLen=%u\n", packetType, payloadLen);
+/* Periodic work for NetTask that is not driven by packets. */
+static void netHousekeeping(uint32_t *reportedDrops)
+{
+    uint32_t dropped = xNetRxRing.ulDropped;
 
-    /* --- MQTT MINIMAL CHECK ADDITION --- */
-    if (isMqttPacket(data, length))
+    if (dropped != *reportedDrops)
     {
-        printf("NetTask: Detected a minimal valid MQTT packet!\n");
-        /* Optionally do deeper MQTT processing here... */
+        logWRITE1(&xNetLog, logID_NET_RX_DROPPED, dropped - *reportedDrops);
+        *reportedDrops = dropped;
     }
-    else
+}
+
+
+/* MQTT handlers: every packet type is logged the same way for now. */
+static BaseType_t onMqttHeader(void *context, const MqttPacketInfo_t *info)
+{
+    (void) context;
+
+    logWRITE2(&xNetLog, logID_NET_PACKET, info->ucType, info->ulPayloadLength);
+    return pdTRUE;
+}
+
+static void onMqttComplete(void *context, const MqttPacketInfo_t *info)
+{
+    (void) context;
+    (void) info;
+
+    logWRITE0(&xNetLog, logID_NET_MQTT_VALID);
+}
+
+static const MqttHandler_t xMqttLogHandler = { onMqttHeader, NULL, onMqttComplete };
+
+/* Indexed by control packet type, 0 and 15 are reserved. */
+static const MqttHandler_t * const xMqttHandlers[mqttNUMBER_OF_TYPES] =
+{
+    NULL,
+    &xMqttLogHandler, &xMqttLogHandler, &xMqttLogHandler, &xMqttLogHandler, /* CONNECT .. PUBACK */
+    &xMqttLogHandler, &xMqttLogHandler, &xMqttLogHandler, &xMqttLogHandler, /* PUBREC .. SUBSCRIBE */
+    &xMqttLogHandler, &xMqttLogHandler, &xMqttLogHandler, &xMqttLogHandler, /* SUBACK .. PINGREQ */
+    &xMqttLogHandler, &xMqttLogHandler,                                     /* PINGRESP, DISCONNECT */
+    NULL
+};
+
+/* Feed received bytes to the MQTT decoder, which may hold partial packets
+ * from earlier calls. */
+static void handlePacket(const uint8_t *data, size_t length)
+{
+    MqttStatus_t status = xMqttDecoderFeed(&xMqttDecoder, data, length);
+
+    if (status != eMqttOk)
     {
-        /* Non-MQTT or invalid structure. Handle as usual or ignore. */
+        /* Framing is lost - a real connection would be closed here. */
+        logWRITE1(&xNetLog, logID_NET_MQTT_ERROR, status);
+        vMqttDecoderReset(&xMqttDecoder);
     }
 }
 
@@ -255,56 +415,126 @@ static void vSecureNetworkTask( void *pvParameters )
 {
     (void) pvParameters;
 
-    static uint8_t netBuffer[256];
+    PacketView_t packets[mainNET_RX_BATCH];
+    size_t count;
+    uint32_t reportedDrops = 0;
+
+    vLogRegisterBuffer(&xNetLog);
+    vMqttDecoderInit(&xMqttDecoder, xMqttHandlers, NULL);
+
+    /* Everything below depends on the input, so persistent fuzzing
+     * snapshots the system here (Verdict.h). */
+    vVerdictReady();
+
+#if ( mainNET_RX_POLLING == 1 )
+    vTimingRegister(&xNetTiming, "NetTask", mainNET_RX_PERIOD_MS * 1000UL, mainNET_DEADLINE_US);
 
     /* NetTask runs every 10ms => 100 times/second => ~500 times in 5 seconds. */
-    const TickType_t xPeriod = pdMS_TO_TICKS(10);
+    const TickType_t xPeriod = pdMS_TO_TICKS(mainNET_RX_PERIOD_MS);
     TickType_t xNextWakeTime = xTaskGetTickCount();
+#else
+    /* Released by packets rather than a period, so no jitter figures. */
+    vTimingRegister(&xNetTiming, "NetTask", 0, mainNET_DEADLINE_US);
+
+    const TickType_t xHousekeepingTimeout = pdMS_TO_TICKS(mainNET_HOUSEKEEPING_MS);
+    TickType_t xLastHousekeeping = xTaskGetTickCount();
+#endif
 
     for (;;)
     {
+#if ( mainNET_RX_POLLING == 1 )
         vTaskDelayUntil(&xNextWakeTime, xPeriod);
 
+        if (xPacketRingCount(&xNetRxRing) == 0)
+        {
+            netHousekeeping(&reportedDrops);
+            continue;
+        }
+#else
+        /* Sleep until the driver signals a packet, or housekeeping is due. */
+        uint32_t events = ulTaskNotifyTakeIndexed(mainNET_RX_NOTIFY_INDEX, pdTRUE, xHousekeepingTimeout);
+
+        if ((xTaskGetTickCount() - xLastHousekeeping) >= xHousekeepingTimeout)
+        {
+            xLastHousekeeping = xTaskGetTickCount();
+            netHousekeeping(&reportedDrops);
+        }
+
+        /* Packets that arrived while the last batch was being handled have
+         * already been drained, leaving a notification with nothing to do. */
+        if ((events == 0) || (xPacketRingCount(&xNetRxRing) == 0))
+        {
+            continue;
+        }
+#endif
+
         /* Start timing. */
-        TickType_t startTime = xTaskGetTickCount();
+        vTimingStart(&xNetTiming);
+        vTimingRecord(&xNetLatency, ulTimingGetCycles() - netRX_STAMP_CYCLES());
 
-        int bytesRead = getIncomingPacket(netBuffer, sizeof(netBuffer));
-        if (bytesRead > 0)
+        /* Handle everything that arrived since the last period, in place. */
+        while ((count = xPacketRingPeek(&xNetRxRing, packets, mainNET_RX_BATCH)) > 0)
         {
-            if ((size_t)bytesRead < sizeof(netBuffer))
+            for (size_t i = 0; i < count; i++)
             {
-                netBuffer[bytesRead] = '\0';
+                handlePacket(packets[i].pucData, packets[i].xLength);
             }
-            else
-            {
-                netBuffer[sizeof(netBuffer) - 1] = '\0';
-            }
-
-            handlePacket(netBuffer, bytesRead);
+            vPacketRingRelease(&xNetRxRing, count);
         }
 
         /* Random delay to simulate missed-deadline scenario. */
         if ((rand() % 500) == 0)
         {
-            vTaskDelay(pdMS_TO_TICKS(60)); // ~6 ticks
+            vTaskDelay(pdMS_TO_TICKS(60));
         }
 
         /* End timing. */
-        TickType_t endTime = xTaskGetTickCount();
-        TickType_t diff = endTime - startTime;
+        uint32_t elapsedUs = timingCYCLES_TO_US(ulTimingStop(&xNetTiming));
 
-        /* If we took > 5 ticks for a 10ms task, log a missed deadline. */
-        if (diff > 5)
+        /* If we took > 5 ms for a 10ms task, log a missed deadline. */
+        if (elapsedUs > mainNET_DEADLINE_US)
         {
-            printf("NetTask: MISSED DEADLINE (took %u ticks)\n", (unsigned)diff);
+            logWRITE1(&xNetLog, logID_NET_MISSED, elapsedUs);
+#if ( verdictEXIT_ON_DEADLINE_MISS == 1 )
+            vVerdictExit(eVerdictDeadlineMissed, "NetTask");
+#endif
         }
         else
         {
-            printf("NetTask: took %u ticks\n", (unsigned)diff);
+            logWRITE1(&xNetLog, logID_NET_TOOK, elapsedUs);
         }
     }
 }
 
+/* StatsTask: periodic summary of the WCET and jitter of each task. */
+static void vStatsTask( void *pvParameters )
+{
+    (void) pvParameters;
+
+    const TickType_t xPeriod = pdMS_TO_TICKS(mainSTATS_PERIOD_MS);
+    TickType_t xNextWakeTime = xTaskGetTickCount();
+
+    for (;;)
+    {
+        vTaskDelayUntil(&xNextWakeTime, xPeriod);
+        vTimingPrintSummary();
+        vPoolPrintStats();
+        vHeapMonitorPrint();
+        vRunTimeStatsPrint();
+#if ( mainNET_RX_FROM_UART == 1 )
+        vUARTRxPrintStats();
+#endif
+#if ( configUSE_TICKLESS_IDLE == 2 )
+        vTicklessPrintStats();
+#endif
+#if ( isrprofENABLED == 1 )
+        vIsrProfilerPrint();
+#endif
+    }
+}
+
+#endif /* mainAPP == mainAPP_SECURE */
+
 
 /*-----------------------------------------------------------*
  *  FreeRTOS Hook Implementations
@@ -313,7 +543,12 @@ static void vSecureNetworkTask( void *pvParameters )
 void vApplicationMallocFailedHook( void )
 {
     printf( "\r\n\r\nMalloc failed\r\n" );
+    /* Runs inside pvPortMalloc(), before the wrapper has counted the
+     * failure, but shows how full and how fragmented the heap was. */
+    vHeapMonitorPrint();
+    vVerdictExit( eVerdictMallocFailed, NULL );
     portDISABLE_INTERRUPTS();
+    vUARTFlush();
     for( ; ; );
 }
 
@@ -324,7 +559,9 @@ void vApplicationStackOverflowHook( TaskHandle_t pxTask, char * pcTaskName )
     (void) pcTaskName;
     (void) pxTask;
     printf( "\r\n\r\nStack overflow in %s\r\n", pcTaskName );
+    vVerdictExit( eVerdictStackOverflow, pcTaskName );
     portDISABLE_INTERRUPTS();
+    vUARTFlush();
     for( ; ; );
 }
 
@@ -333,11 +570,20 @@ void SampleOverflowIssue(int x) // Unused function to detect
     (void)x;
 }
 
-void vApplicationTickHook( void ) { }
+void vApplicationTickHook( void )
+{
+#if ( mainAPP == mainAPP_FULL )
+    /* The interrupt tests of the common demo tasks. */
+    vFullDemoTickHookFunction();
+#elif ( mainAPP == mainAPP_BENCH )
+    /* Stamps the tick for the vTaskDelayUntil() wake latency case. */
+    vBenchmarkTickHook();
+#endif
+}
 
 void vApplicationDaemonTaskStartupHook( void )
 {
-#if ( configUSE_TRACE_FACILITY == 1 )
+#if ( configUSE_TRACE_RECORDER == 1 )
     xTraceEnable( TRC_START );
 #endif
 }
@@ -346,8 +592,12 @@ void vAssertCalled( const char * pcFileName, uint32_t ulLine )
 {
     volatile uint32_t ulSetToNonZeroInDebuggerToContinue = 0;
     printf( "ASSERT! Line %d, file %s\r\n", ( int ) ulLine, pcFileName );
+    vVerdictExit( eVerdictAssert, pcFileName );
     taskENTER_CRITICAL();
     {
+        /* The TX interrupt cannot drain the console while in here. */
+        vUARTFlush();
+
         while( ulSetToNonZeroInDebuggerToContinue == 0 )
         {
             __asm volatile ( "NOP" );
@@ -381,32 +631,50 @@ void vApplicationGetTimerTaskMemory( StaticTask_t ** ppxTimerTaskTCBBuffer,
     *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
 }
 
-static void prvUARTInit( void )
-{
-    UART0_BAUDDIV = 16;
-    UART0_CTRL = 1;
-}
-
 int __write( int iFile, char * pcString, int iStringLength )
 {
     (void) iFile;
 
-    for( int iNextChar = 0; iNextChar < iStringLength; iNextChar++ )
+    if( iStringLength <= 0 )
     {
-        while( ( UART0_STATE & TX_BUFFER_MASK ) != 0 ) { }
-        UART0_DATA = *pcString++;
+        return 0;
     }
+
+    /* In buffered mode this only copies into the TX ring.  Report the whole
+     * string as written even if some of it was dropped - the loss is counted
+     * by the UART driver and retrying would block the caller. */
+    ( void ) xUARTWrite( pcString, ( size_t ) iStringLength );
     return iStringLength;
 }
 
 void *malloc(size_t size)
 {
+#if ( poolROUTE_MALLOC == 1 )
+    /* Small requests come from the O(1) block pools while they last. */
+    if (size <= poolROUTE_MALLOC_MAX)
+    {
+        void *block = pvPoolAlloc(size);
+        if (block != NULL)
+        {
+            return block;
+        }
+    }
+#endif
+
     /* Wrap library malloc to FreeRTOS allocation. */
-    return pvPortMalloc(size);
+    return pvHeapMonitorMalloc(size);
 }
 
 void free(void *ptr)
 {
+#if ( poolROUTE_MALLOC == 1 )
+    if (xPoolOwns(ptr) == pdTRUE)
+    {
+        vPoolFree(ptr);
+        return;
+    }
+#endif
+
     /* Likewise wrap free to FreeRTOS deallocation. */
-    vPortFree(ptr);
+    vHeapMonitorFree(ptr);
 }
@@ -0,0 +1,68 @@
+/*
+ * The bench application, built with "make bench".
+ *
+ * main_bench() creates a single task that runs the micro-benchmarks of
+ * Benchmark.c once and then ends the run with a pass (Verdict.h), so a QEMU
+ * run of the image prints one BENCH result line per case and exits.
+ * scripts/build_and_run.py --app bench saves the results, and
+ * scripts/bench_compare.py compares those of two builds.
+ *
+ * Generic functions, such as the FreeRTOS hook functions, are defined in
+ * main.c.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Application includes. */
+#include "Benchmark.h"
+#include "IsrProfiler.h"
+#include "Verdict.h"
+
+/* Leaves a priority above it for the helper tasks of the latency cases, and
+ * is above the idle task so tickless idle only runs while it is blocked. */
+#define mainBENCH_TASK_PRIORITY    ( tskIDLE_PRIORITY + 2 )
+
+/* printf() and the result buffers of each case. */
+#define mainBENCH_STACK_SIZE       ( configMINIMAL_STACK_SIZE + 256 )
+
+/*-----------------------------------------------------------*/
+
+static void prvBenchTask( void * pvParameters );
+
+/*-----------------------------------------------------------*/
+
+void main_bench( void )
+{
+    xTaskCreate( prvBenchTask, "Bench", mainBENCH_STACK_SIZE, NULL, mainBENCH_TASK_PRIORITY, NULL );
+
+    vTaskStartScheduler();
+
+    /* Only reached if there was not enough heap to start the scheduler. */
+    for( ; ; )
+    {
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvBenchTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    vBenchmarkRunAll();
+
+    #if ( isrprofENABLED == 1 )
+        vIsrProfilerPrint();
+    #endif
+
+    printf( "Bench: done\n" );
+    vVerdictExit( eVerdictPass, "bench" );
+
+    /* vVerdictExit() returns when semihosting is not available. */
+    vTaskDelete( NULL );
+}
+/*-----------------------------------------------------------*/
@@ -82,6 +82,11 @@
 #define mainVALUE_SENT_FROM_TASK           ( 100UL )
 #define mainVALUE_SENT_FROM_TIMER          ( 200UL )
 
+/* Built with TRACE=0 the user events are only printed. */
+#if ( configUSE_TRACE_RECORDER == 0 )
+    #define xTracePrint( xChannel, pcString )
+#endif
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -114,7 +119,9 @@ void main_blinky( void )
     xQueue = xQueueCreate( mainQUEUE_LENGTH, sizeof( uint32_t ) );
 
     /* TODO TraceRecorder (Tweak 4): Setting a name for the queue (optional). */
-    vTraceSetQueueName(xQueue, "Blinky-Queue");
+    #if ( configUSE_TRACE_RECORDER == 1 )
+        vTraceSetQueueName(xQueue, "Blinky-Queue");
+    #endif
 
     if( xQueue != NULL )
     {
@@ -210,8 +217,10 @@ static void prvQueueReceiveTask( void * pvParameters )
     ( void ) pvParameters;
 
     /* TraceRecorder: Registering a channel name for the user events. */
-    TraceStringHandle_t xUserEventLogChannel;
-    xTraceStringRegister("Log", &xUserEventLogChannel);
+    #if ( configUSE_TRACE_RECORDER == 1 )
+        TraceStringHandle_t xUserEventLogChannel;
+        xTraceStringRegister("Log", &xUserEventLogChannel);
+    #endif
 
     for( ; ; )
     {
@@ -95,6 +95,10 @@
 #include "StreamBufferInterrupt.h"
 #include "IntSemTest.h"
 
+/* Application includes. */
+#include "RunTimeStats.h"
+#include "IsrProfiler.h"
+
 /*-----------------------------------------------------------*/
 
 /* Task priorities. */
@@ -115,6 +119,10 @@
 #define mainREG_TEST_TASK_1_PARAMETER    ( ( void * ) 0x12345678 )
 #define mainREG_TEST_TASK_2_PARAMETER    ( ( void * ) 0x87654321 )
 
+/* The check task prints the per task run time statistics every this many of
+ * its 5 second periods.  0 to not print them. */
+#define mainRUN_TIME_STATS_EVERY         ( 1UL )
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -204,6 +212,7 @@ static void prvCheckTask( void * pvParameters )
 {
     static const char * pcMessage = "PASS";
     unsigned long ulLastRegTest1Value = 0, ulLastRegTest2Value = 0;
+    unsigned long ulPeriodsSinceStats = 0;
 
     const TickType_t xTaskPeriod = pdMS_TO_TICKS( 5000UL );
     TickType_t xPreviousWakeTime;
@@ -333,6 +342,19 @@ static void prvCheckTask( void * pvParameters )
         /* It is normally not good to call printf() from an embedded system,
          * although it is ok in this simulated case. */
         printf( "%s : %d (%d)\r\n", pcMessage, ( int ) xTaskGetTickCount(), ( int ) ulNestCount );
+
+        #if ( mainRUN_TIME_STATS_EVERY > 0 )
+        {
+            if( ++ulPeriodsSinceStats >= mainRUN_TIME_STATS_EVERY )
+            {
+                ulPeriodsSinceStats = 0;
+                vRunTimeStatsPrint();
+                #if ( isrprofENABLED == 1 )
+                    vIsrProfilerPrint();
+                #endif
+            }
+        }
+        #endif
     }
 }
 /*-----------------------------------------------------------*/
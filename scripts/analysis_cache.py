@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+
+"""
+Incremental analysis cache for analyze_results.py.
+
+Every refine cycle leaves the crash logs and static analysis reports of the
+earlier cycles in test_artifacts/, so without a cache each run rescans all of
+them and reports the same findings again. The cache, kept as JSON in
+test_artifacts/analysis_cache.json, holds:
+  - files: the size, modification time and SHA-256 of each artifact scanned,
+    so an unchanged file is not even read again
+  - contents: the findings for each SHA-256, so a file rewritten with the same
+    content (a fuzz run that finds the same crash) is hashed but not scanned
+  - reported: the fingerprint of every finding already reported, so a finding
+    seen in an earlier iteration, or in another file of this one, is reported
+    once
+
+A fingerprint is the keyword, the source location named in the line (a
+"file.c:123" or "Line 123, file file.c" reference, if there is one) and the
+line with its numbers and addresses masked, so that "took 60123 us" and
+"took 60231 us" count as the same finding. The firmware prints no stack
+traces, so the masked line stands in for a stack signature.
+
+Usage:
+  python3 analysis_cache.py [CACHE]    # summarise a cache
+"""
+
+import datetime
+import hashlib
+import json
+import os
+import re
+import sys
+
+CACHE_FILE = "analysis_cache.json"
+CACHE_VERSION = 1
+
+_LOCATION_RES = (
+    re.compile(r"([\w./\\-]+\.(?:c|h|s|S|cpp|hpp)):(\d+)"),
+    re.compile(r"line (\d+), file ([\w./\\-]+)", re.IGNORECASE),
+)
+_NUMBER_RE = re.compile(r"0x[0-9a-fA-F]+|\d+")
+
+
+def source_location(text):
+    """
+    "file:line" of the first source reference in text, or "".
+    """
+    match = _LOCATION_RES[0].search(text)
+    if match:
+        return f"{os.path.basename(match.group(1))}:{match.group(2)}"
+    match = _LOCATION_RES[1].search(text)
+    if match:
+        return f"{os.path.basename(match.group(2))}:{match.group(1)}"
+    return ""
+
+
+def fingerprint(item):
+    """
+    Identifies a finding independently of the file and line it was found at.
+    """
+    text = item["line_text"]
+    key = "\0".join((item["keyword"], source_location(text), _NUMBER_RE.sub("#", text)))
+    return hashlib.sha1(key.encode("utf-8", errors="ignore")).hexdigest()[:16]
+
+
+def file_stat(path):
+    st = os.stat(path)
+    return [st.st_size, st.st_mtime_ns]
+
+
+class AnalysisCache:
+    """
+    The on-disk index. Findings are stored without their "file" key, which is
+    added back for the file being reported.
+    """
+
+    def __init__(self, path):
+        self.path = path
+        self.files = {}
+        self.contents = {}
+        self.reported = {}
+        self.load()
+
+    def load(self):
+        try:
+            with open(self.path, "r", encoding="utf-8") as f:
+                data = json.load(f)
+        except (OSError, ValueError):
+            return
+        if data.get("version") != CACHE_VERSION:
+            return
+        self.files = data.get("files", {})
+        self.contents = data.get("contents", {})
+        self.reported = data.get("reported", {})
+
+    def save(self, current_paths=None):
+        """
+        Writes the cache, first dropping the files not in current_paths and the
+        contents no remaining file has.
+        """
+        if current_paths is not None:
+            keep = {os.path.abspath(p) for p in current_paths}
+            self.files = {p: e for p, e in self.files.items() if p in keep}
+            used = {e["sha256"] for e in self.files.values()}
+            self.contents = {d: f for d, f in self.contents.items() if d in used}
+        data = {"version": CACHE_VERSION, "files": self.files,
+                "contents": self.contents, "reported": self.reported}
+        tmp = self.path + ".tmp"
+        with open(tmp, "w", encoding="utf-8") as f:
+            json.dump(data, f)
+        os.replace(tmp, self.path)
+
+    def unchanged(self, path):
+        """
+        The SHA-256 of path if it has not changed since it was scanned, else None.
+        """
+        entry = self.files.get(os.path.abspath(path))
+        try:
+            if entry is not None and entry["stat"] == file_stat(path):
+                return entry["sha256"]
+        except OSError:
+            pass
+        return None
+
+    def findings(self, digest, path):
+        """
+        The cached findings for content digest, as found in path.
+        """
+        abspath = os.path.abspath(path)
+        return [dict(item, file=abspath) for item in self.contents.get(digest, [])]
+
+    def store(self, path, stat, digest, findings=None):
+        """
+        Records that path, with stat and content digest, was scanned. findings
+        is None when the content was already known.
+        """
+        self.files[os.path.abspath(path)] = {"stat": stat, "sha256": digest}
+        if findings is not None:
+            self.contents[digest] = [{k: v for k, v in item.items() if k != "file"}
+                                     for item in findings]
+
+    def is_reported(self, fp):
+        return fp in self.reported
+
+    def mark_reported(self, fp, item):
+        self.reported[fp] = {"first_seen": datetime.datetime.now().isoformat(timespec="seconds"),
+                             "file": item["file"], "line": item["line"],
+                             "keyword": item["keyword"]}
+
+
+def main():
+    path = sys.argv[1] if len(sys.argv) > 1 else os.path.join("test_artifacts", CACHE_FILE)
+    cache = AnalysisCache(path)
+    findings = sum(len(f) for f in cache.contents.values())
+    print(f"{path}: {len(cache.files)} files, {len(cache.contents)} distinct contents "
+          f"with {findings} findings, {len(cache.reported)} findings reported")
+
+
+if __name__ == "__main__":
+    main()
@@ -7,15 +7,40 @@ Parses logs from fuzz_test.py and static_analysis.py to locate error indicators.
 Correlates each with a threat category/CWE (from Step 1).
 
 Outputs:
-  - A JSON report (analysis_report.json) in test_artifacts/
+  - A JSON Lines report (analysis_report.jsonl) in test_artifacts/, one
+    finding per line, written as the files are scanned
   - A console summary
 
+Each log is read in large blocks of whole lines, so memory use does not grow
+with the log. A block is lowercased and scanned once with a single compiled
+alternation of all THREAT_KEYWORDS, so lines without any keyword - nearly all
+of a long console log - are skipped by the regex engine without being
+decoded. Only the lines it stops on are checked for each keyword, giving the
+same findings as checking every keyword on every line. Files are scanned in
+parallel by a pool of processes.
+
+Results are cached across refine iterations (analysis_cache.py): files that
+have not changed since the last run are not read again, files with content
+that was scanned before are only hashed, and a finding already reported -
+in an earlier iteration or in another file - is not reported again, so
+llm_refine.py only sees new evidence. --all reports every finding, and
+--no-cache scans everything as if there were no earlier runs.
+
+A Report can be given files in several batches, which is how pipeline.py
+scans each crash log as soon as fuzz_test.py writes it.
+
 Usage:
-  python3 analyze_results.py
+  python3 analyze_results.py [--jobs N] [--out REPORT] [--show N] [--all | --no-cache]
 """
 
+import argparse
+import hashlib
+import multiprocessing
 import os
 import json
+import re
+
+import analysis_cache
 
 # Directory where fuzz logs and static analysis logs are stored
 TEST_ARTIFACTS_DIR = "test_artifacts"
@@ -61,19 +86,47 @@ THREAT_KEYWORDS = {
         "threat": "Generic Error",
         "cwe": "N/A"
     },
-    "malloc failed": {
-        "threat": "Memory Allocation Failure",
-        "cwe": "CWE-401: Memory Leak or Resource Exhaustion"
-    },
     "freeze": {
         "threat": "Potential Freeze/Hang",
         "cwe": "CWE-400: Uncontrolled Resource Consumption"
      }
 }
 
+REPORT_FILE = "analysis_report.jsonl"
+
+# Issues printed in full on the console; the rest are only counted.
+SHOW_ISSUES = 20
+
+# Bytes read at a time, extended to the end of the last line.
+CHUNK_SIZE = 1 << 23
+
+# Matches any keyword in lowercased text. Longer keywords first, though any
+# match will do: it only finds the lines to check. Lowercasing the block and
+# matching case sensitively is much faster than re.IGNORECASE.
+_KEYWORD_RE = re.compile(
+    b"|".join(re.escape(k.encode()) for k in sorted(THREAT_KEYWORDS, key=len, reverse=True)))
+
+def _line_blocks(f):
+    """
+    Yields the file in blocks of about CHUNK_SIZE bytes that end at a newline,
+    except the last.
+    """
+    rest = b""
+    while True:
+        block = f.read(CHUNK_SIZE)
+        if not block:
+            if rest:
+                yield rest
+            return
+        block = rest + block
+        cut = block.rfind(b"\n") + 1
+        rest = block[cut:]
+        if cut:
+            yield block[:cut]
+
 def parse_file_for_threats(filepath):
     """
-    Reads file line by line, searching for known error keywords.
+    Scans the file in one pass for known error keywords.
     Returns a list of discovered vulnerabilities, each as a dict:
       {
         "file": <filename>,
@@ -88,83 +141,264 @@ def parse_file_for_threats(filepath):
     if not os.path.isfile(filepath):
         return vulnerabilities
 
-    with open(filepath, "r", encoding="utf-8", errors="ignore") as f:
-        lines = f.readlines()
-
-    for i, line in enumerate(lines):
-        line_lower = line.lower()
-        for keyword, info in THREAT_KEYWORDS.items():
-            if keyword in line_lower:
-                vulnerabilities.append({
-                    "file": os.path.abspath(filepath),
-                    "line": i + 1,
-                    "keyword": keyword,
-                    "threat": info["threat"],
-                    "cwe": info["cwe"],
-                    "line_text": line.strip()
-                })
+    abspath = os.path.abspath(filepath)
+    line_number = 1
+    with open(filepath, "rb") as f:
+        for block in _line_blocks(f):
+            lowered = block.lower()
+            counted = 0     # offset up to which newlines have been counted
+            pos = 0
+            while True:
+                match = _KEYWORD_RE.search(lowered, pos)
+                if match is None:
+                    break
+                start = lowered.rfind(b"\n", 0, match.start()) + 1
+                end = lowered.find(b"\n", match.end())
+                if end < 0:
+                    end = len(lowered)
+                line_number += lowered.count(b"\n", counted, start)
+                counted = start
+                pos = end + 1
+
+                line_lower = lowered[start:end].decode("utf-8", errors="ignore")
+                for keyword, info in THREAT_KEYWORDS.items():
+                    if keyword in line_lower:
+                        vulnerabilities.append({
+                            "file": abspath,
+                            "line": line_number,
+                            "keyword": keyword,
+                            "threat": info["threat"],
+                            "cwe": info["cwe"],
+                            "line_text": block[start:end].decode("utf-8", errors="ignore").strip()
+                        })
+            line_number += lowered.count(b"\n", counted)
     return vulnerabilities
 
-def analyze_fuzz_logs(results):
+# Content hashes whose findings the cache already holds, set in each worker.
+_known_digests = frozenset()
+
+def _init_worker(known_digests):
+    global _known_digests
+    _known_digests = known_digests
+
+def file_digest(filepath):
+    h = hashlib.sha256()
+    with open(filepath, "rb") as f:
+        for block in iter(lambda: f.read(CHUNK_SIZE), b""):
+            h.update(block)
+    return h.hexdigest()
+
+def scan_file(filepath):
+    """
+    Returns (path, stat, digest, findings) for a file that is new or has
+    changed, findings being None if the content is already in the cache.
+    """
+    stat = analysis_cache.file_stat(filepath)
+    digest = file_digest(filepath)
+    if digest in _known_digests:
+        return filepath, stat, digest, None
+    return filepath, stat, digest, parse_file_for_threats(filepath)
+
+def find_fuzz_logs():
     """
-    Searches for fuzz_crashlog_*.txt files in test_artifacts/ and parses them.
+    Returns the fuzz_crashlog_*.txt files in test_artifacts/ and in the
+    worker directories that fuzz_test.py creates under it.
     """
+    paths = []
     if not os.path.isdir(TEST_ARTIFACTS_DIR):
-        return
+        return paths
 
-    for fname in os.listdir(TEST_ARTIFACTS_DIR):
-        if fname.endswith(".txt") and any(fname.startswith(p) for p in FUZZ_PATTERNS):
-            full_path = os.path.join(TEST_ARTIFACTS_DIR, fname)
-            vulns = parse_file_for_threats(full_path)
-            results.extend(vulns)
+    for dirpath, dirnames, filenames in os.walk(TEST_ARTIFACTS_DIR):
+        # Static analysis logs are handled by find_static_analysis_logs().
+        if STATIC_ANALYSIS_DIR in dirnames:
+            dirnames.remove(STATIC_ANALYSIS_DIR)
+        dirnames.sort()
+        for fname in sorted(filenames):
+            if fname.endswith(".txt") and any(fname.startswith(p) for p in FUZZ_PATTERNS):
+                paths.append(os.path.join(dirpath, fname))
+    return paths
 
-def analyze_static_analysis_logs(results):
+def find_static_analysis_logs():
     """
-    Looks in test_artifacts/static_analysis/ for typical logs 
-    (cppcheck_report.txt, clang_scanbuild_results.txt).
+    Returns the typical logs in test_artifacts/static_analysis/
+    (cppcheck_report.txt, clang_analyzer_results.txt).
     """
     analysis_dir = os.path.join(TEST_ARTIFACTS_DIR, STATIC_ANALYSIS_DIR)
     if not os.path.isdir(analysis_dir):
+        return []
+
+    return [os.path.join(analysis_dir, fname) for fname in sorted(os.listdir(analysis_dir))
+            if fname.endswith(".txt") or fname.endswith(".log")]
+
+def scan_files(paths, jobs, known_digests=frozenset()):
+    """
+    Yields scan_file() for each path in turn, from a pool of jobs processes.
+    """
+    if jobs <= 1 or len(paths) <= 1:
+        _init_worker(known_digests)
+        for path in paths:
+            yield scan_file(path)
         return
+    with multiprocessing.Pool(min(jobs, len(paths)), _init_worker, (known_digests,)) as pool:
+        # In order, so the report is the same from run to run.
+        yield from pool.imap(scan_file, paths)
 
-    for fname in os.listdir(analysis_dir):
-        if fname.endswith(".txt") or fname.endswith(".log"):
-            full_path = os.path.join(analysis_dir, fname)
-            vulns = parse_file_for_threats(full_path)
-            results.extend(vulns)
+def collect_findings(paths, jobs, cache, report_all):
+    """
+    Yields the findings of each file in path order, taking them from the cache
+    where it can, and counts what was done in the returned stats dict.
+    """
+    stats = {"scanned": 0, "known": 0, "unchanged": 0}
 
-def main():
-    results = []
+    def generate():
+        todo = []
+        unchanged = {}
+        for path in paths:
+            digest = cache.unchanged(path) if cache is not None else None
+            if digest is not None:
+                unchanged[path] = digest
+            else:
+                todo.append(path)
 
-    # 1. Collect fuzz logs
-    analyze_fuzz_logs(results)
+        known = frozenset(cache.contents) if cache is not None else frozenset()
+        scanned = scan_files(todo, jobs, known)
+        for path in paths:
+            if path in unchanged:
+                stats["unchanged"] += 1
+                # Everything in it was reported when it was first scanned.
+                if report_all:
+                    yield cache.findings(unchanged[path], path)
+                continue
+            path, stat, digest, new_findings = next(scanned)
+            if cache is not None:
+                cache.store(path, stat, digest, new_findings)
+            if new_findings is None:
+                stats["known"] += 1
+                yield cache.findings(digest, path)
+            else:
+                stats["scanned"] += 1
+                yield new_findings
 
-    # 2. Collect static analysis logs
-    analyze_static_analysis_logs(results)
+    return generate(), stats
 
-    # 3. If you store any QEMU console output in test_artifacts/console_log.txt,
-    #    you can parse that too with parse_file_for_threats.
+def print_issue(i, item):
+    print(f"Issue #{i}:")
+    print(f"  File: {item['file']} (Line {item['line']})")
+    print(f"  Keyword: {item['keyword']}")
+    print(f"  Threat: {item['threat']}")
+    print(f"  CWE: {item['cwe']}")
+    print(f"  Context: \"{item['line_text']}\"")
+    print("")
 
-    if not results:
-        print("No vulnerabilities or errors found in logs.")
-        return
+class Report:
+    """
+    The JSON Lines report of the new findings in the files given to add(),
+    written as they are scanned. Call close() once all files are added, to
+    save the cache.
+
+    Findings whose fingerprint is in recheck are reported again although the
+    cache holds them, once each, with "still_failing" set.
+    """
+
+    def __init__(self, path, cache=None, jobs=1, report_all=False, show=SHOW_ISSUES, recheck=()):
+        self.path = path
+        self.cache = cache
+        self.jobs = jobs
+        self.report_all = report_all
+        self.show = show
+        self.paths = []
+        self.count = 0
+        self.repeated = 0
+        self.recheck = recheck
+        self.still_failing = []
+        self.threats = {}
+        self.stats = {"scanned": 0, "known": 0, "unchanged": 0}
+        os.makedirs(os.path.dirname(path) or ".", exist_ok=True)
+        self._file = open(path, "w", encoding="utf-8")
+
+    def add(self, paths):
+        """
+        Scans paths and reports their new findings, printing the first few.
+        Returns the findings reported.
+        """
+        reported = []
+        self.paths += paths
+        findings_per_file, stats = collect_findings(paths, self.jobs, self.cache, self.report_all)
+        for findings in findings_per_file:
+            for item in findings:
+                item["fingerprint"] = analysis_cache.fingerprint(item)
+                if self.cache is not None:
+                    if not self.cache.is_reported(item["fingerprint"]):
+                        self.cache.mark_reported(item["fingerprint"], item)
+                    elif item["fingerprint"] in self.recheck and \
+                            item["fingerprint"] not in {i["fingerprint"] for i in self.still_failing}:
+                        item["still_failing"] = True
+                        self.still_failing.append(item)
+                    elif not self.report_all:
+                        self.repeated += 1
+                        continue
+                self._file.write(json.dumps(item) + "\n")
+                reported.append(item)
+                self.count += 1
+                self.threats[item["threat"]] = self.threats.get(item["threat"], 0) + 1
+                if self.count <= self.show:
+                    print_issue(self.count, item)
+        # Each file is scanned before the next batch is added.
+        self._file.flush()
+        for key, value in stats.items():
+            self.stats[key] += value
+        return reported
+
+    def close(self):
+        self._file.close()
+        if self.cache is not None:
+            self.cache.save(self.paths)
+
+    def print_summary(self):
+        stats = self.stats
+        print(f"{len(self.paths)} files: {stats['scanned']} scanned, {stats['known']} with known content, "
+              f"{stats['unchanged']} unchanged; {self.repeated} findings already reported.")
+        if self.still_failing:
+            print(f"{len(self.still_failing)} findings reported before are still failing.")
+        if not self.count:
+            print("No new vulnerabilities or errors found in logs.")
+            return
+
+        if self.count > self.show:
+            print(f"... and {self.count - self.show} more.\n")
+        print(f"Discovered {self.count} potential issues in {len(self.paths)} files. "
+              f"Detailed report in {self.path}")
+        for threat, n in sorted(self.threats.items(), key=lambda t: -t[1]):
+            print(f"  {threat}: {n}")
+
+def main():
+    parser = argparse.ArgumentParser(description="Scan fuzz and static analysis logs for threats.")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count() or 1,
+                        help="files scanned at once (default: one per CPU)")
+    parser.add_argument("-o", "--out", default=os.path.join(TEST_ARTIFACTS_DIR, REPORT_FILE),
+                        help="JSON Lines report (default: %(default)s)")
+    parser.add_argument("--show", type=int, default=SHOW_ISSUES,
+                        help="issues to print in full (default: %(default)s)")
+    mode = parser.add_mutually_exclusive_group()
+    mode.add_argument("--all", action="store_true",
+                      help="report every finding, including those reported by earlier runs")
+    mode.add_argument("--no-cache", action="store_true",
+                      help="neither use nor update the analysis cache")
+    args = parser.parse_args()
+
+    # Fuzz logs, then static analysis logs. Any QEMU console output stored
+    # in test_artifacts/ can be scanned the same way with parse_file_for_threats.
+    paths = find_fuzz_logs() + find_static_analysis_logs()
+
+    cache = None
+    if not args.no_cache:
+        os.makedirs(TEST_ARTIFACTS_DIR, exist_ok=True)
+        cache = analysis_cache.AnalysisCache(os.path.join(TEST_ARTIFACTS_DIR, analysis_cache.CACHE_FILE))
 
-    # Create a final JSON report
-    report_path = os.path.join(TEST_ARTIFACTS_DIR, "analysis_report.json")
-    with open(report_path, "w", encoding="utf-8") as rf:
-        json.dump(results, rf, indent=2)
-
-    print(f"Discovered {len(results)} potential issues. Detailed report in {report_path}\n")
-
-    # Print a console summary
-    for i, item in enumerate(results, start=1):
-        print(f"Issue #{i}:")
-        print(f"  File: {item['file']} (Line {item['line']})")
-        print(f"  Keyword: {item['keyword']}")
-        print(f"  Threat: {item['threat']}")
-        print(f"  CWE: {item['cwe']}")
-        print(f"  Context: \"{item['line_text']}\"")
-        print("")
+    report = Report(args.out, cache, args.jobs, args.all, args.show)
+    report.add(paths)
+    report.close()
+    report.print_summary()
 
 if __name__ == "__main__":
     main()
@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+
+"""
+Compare the micro-benchmark results of two firmware builds.
+
+The bench application (make APP=bench, Benchmark.h) prints one result per
+case on the console, as "BENCH " followed by a JSON object with the case name
+and the smallest, median and largest cost per operation, in cycles, of its
+repetitions. build_and_run.py --app bench saves them as BENCH_FILE in the
+build directory, together with the settings of the run, and this script
+also reads them straight from a saved console log.
+
+For each case the chosen metric (--metric, the median by default) of the new
+results is compared with the base results. A case is a regression if it got
+slower by at least --threshold percent and at least --min-cycles cycles,
+so that a case of a few cycles does not trip on a one cycle change. Cases
+found in only one of the two are listed too. The exit status is 1 if there
+was any regression, so the comparison can gate a pipeline.
+
+Cycle counts under QEMU are only repeatable with -icount (build_and_run.py
+--icount), so both runs should use the same timing mode; a warning is printed
+if the saved settings say otherwise.
+
+Usage:
+  python3 bench_compare.py BASE NEW [--metric {min,median,max}]
+                           [--threshold PCT] [--min-cycles N] [--json FILE]
+"""
+
+import argparse
+import json
+import os
+import sys
+
+# Starts each result line of the firmware (benchRESULT_PREFIX).
+RESULT_PREFIX = "BENCH "
+
+# Saved by build_and_run.py --app bench, inside its build directory.
+BENCH_FILE = "bench_results.json"
+
+METRICS = ("min", "median", "max")
+DEFAULT_METRIC = "median"
+
+# Slower by more than this percentage, and by at least MIN_CYCLES, is a
+# regression.
+THRESHOLD = 5.0
+MIN_CYCLES = 2
+
+# Setting of the run (run_config.py) that changes the cycle counts.
+_TIMING_KEY = "timing"
+
+
+def parse_lines(lines):
+    """
+    The results in console output, by case name. Lines that are not results,
+    or are corrupted, are skipped.
+    """
+    results = {}
+    for line in lines:
+        start = line.find(RESULT_PREFIX)
+        if start < 0:
+            continue
+        try:
+            result = json.loads(line[start + len(RESULT_PREFIX):])
+        except ValueError:
+            continue
+        if isinstance(result, dict) and "name" in result:
+            results[result.pop("name")] = result
+    return results
+
+
+def write_results(path, results, config=None):
+    """
+    Saves results, and the settings of the run they came from, as JSON.
+    """
+    with open(path, "w", encoding="utf-8") as f:
+        json.dump({"config": config or {}, "results": results}, f, indent=2)
+
+
+def load(path):
+    """
+    (results, config) from a file saved by write_results() or a console log.
+    """
+    with open(path, "r", encoding="utf-8", errors="ignore") as f:
+        text = f.read()
+    try:
+        data = json.loads(text)
+    except ValueError:
+        data = None
+    if isinstance(data, dict) and "results" in data:
+        return data["results"], data.get("config", {})
+    return parse_lines(text.splitlines()), {}
+
+
+def compare(base, new, metric=DEFAULT_METRIC, threshold=THRESHOLD, min_cycles=MIN_CYCLES):
+    """
+    One row per case in either set of results, in the order of the new
+    results, each with its "status": regression, improvement, same, removed
+    (only in base) or added (only in new).
+    """
+    rows = []
+    for name in list(new) + [n for n in base if n not in new]:
+        row = {"name": name, "base": None, "new": None, "change": None}
+        if name in base:
+            row["base"] = base[name].get(metric)
+        if name in new:
+            row["new"] = new[name].get(metric)
+
+        if row["base"] is None:
+            row["status"] = "added"
+        elif row["new"] is None:
+            row["status"] = "removed"
+        else:
+            delta = row["new"] - row["base"]
+            limit = max(row["base"] * threshold / 100.0, min_cycles)
+            row["change"] = (100.0 * delta / row["base"]) if row["base"] else None
+            if delta >= limit:
+                row["status"] = "regression"
+            elif -delta >= limit:
+                row["status"] = "improvement"
+            else:
+                row["status"] = "same"
+        rows.append(row)
+    return rows
+
+
+def timing_warning(base_config, new_config):
+    """
+    A warning if the two runs were saved with different timing settings.
+    """
+    base, new = base_config.get(_TIMING_KEY), new_config.get(_TIMING_KEY)
+    if base is not None and new is not None and base != new:
+        return (f"warning: the runs used different timing modes ({base} and {new}), "
+                f"so the cycle counts are not comparable")
+    return None
+
+
+def format_rows(rows, metric):
+    def cell(value):
+        return "-" if value is None else str(value)
+
+    width = max([len(r["name"]) for r in rows] + [4])
+    lines = [f"{'case':<{width}}  {'base':>8}  {'new':>8}  {'change':>8}  ({metric} cycles/op)"]
+    for r in rows:
+        change = "" if r["change"] is None else f"{r['change']:+.1f}%"
+        flag = "" if r["status"] == "same" else f"  {r['status'].upper()}"
+        lines.append(f"{r['name']:<{width}}  {cell(r['base']):>8}  {cell(r['new']):>8}  "
+                     f"{change:>8}{flag}")
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare the bench results of two builds.")
+    parser.add_argument("base", help=f"base results ({BENCH_FILE} or a console log)")
+    parser.add_argument("new", help="results to check against the base")
+    parser.add_argument("--metric", choices=METRICS, default=DEFAULT_METRIC,
+                        help="statistic of the repetitions compared (default: %(default)s)")
+    parser.add_argument("--threshold", type=float, default=THRESHOLD,
+                        help="percentage slowdown flagged as a regression (default: %(default)s)")
+    parser.add_argument("--min-cycles", type=int, default=MIN_CYCLES,
+                        help="smallest slowdown in cycles flagged (default: %(default)s)")
+    parser.add_argument("--json", help="also write the comparison as JSON")
+    args = parser.parse_args()
+
+    for path in (args.base, args.new):
+        if not os.path.isfile(path):
+            sys.exit(f"{path}: no such file")
+    base, base_config = load(args.base)
+    new, new_config = load(args.new)
+    if not base or not new:
+        sys.exit(f"no results in {args.base if not base else args.new}")
+
+    warning = timing_warning(base_config, new_config)
+    if warning:
+        print(warning)
+
+    rows = compare(base, new, args.metric, args.threshold, args.min_cycles)
+    print(format_rows(rows, args.metric))
+
+    counts = {}
+    for r in rows:
+        counts[r["status"]] = counts.get(r["status"], 0) + 1
+    print("\n" + ", ".join(f"{counts.get(s, 0)} {s}" for s in
+                           ("regression", "improvement", "same", "added", "removed")))
+
+    if args.json:
+        with open(args.json, "w", encoding="utf-8") as f:
+            json.dump({"base": os.path.abspath(args.base), "new": os.path.abspath(args.new),
+                       "metric": args.metric, "threshold": args.threshold,
+                       "min_cycles": args.min_cycles, "cases": rows}, f, indent=2)
+
+    sys.exit(1 if counts.get("regression") else 0)
+
+
+if __name__ == "__main__":
+    main()
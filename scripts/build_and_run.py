@@ -6,69 +6,175 @@ Step 3: Integration & Build with FreeRTOS
 This script:
 1. Calls 'make' in the specified build directory to compile the FreeRTOS QEMU demo.
 2. Runs the resulting RTOSDemo.out under QEMU, printing console output.
+   Binary log frames from the firmware are decoded back to text on the way.
+3. Saves the TraceRecorder stream from UART1 to TRACE_FILE (trace_capture.py).
+4. Stops as soon as the firmware reports its verdict through semihosting
+   (Verdict.h) and exits with the same status, so it can gate a pipeline.
+5. With --icount, runs QEMU in the deterministic timing mode, and with --seed
+   builds the firmware with that seed for its injected delays, so the timing
+   figures of two builds can be compared (run_config.py). The settings of the
+   run are saved as RUN_CONFIG_FILE next to the trace.
+6. With --app, builds and runs the blinky or full demo instead of the secure
+   application, and with --no-trace builds without TraceRecorder (make
+   TRACE=0), in which case no trace is saved. --profile selects the
+   Makefile's optimisation PROFILE.
+7. With --app bench, runs the micro-benchmarks (Benchmark.h) and saves their
+   results as bench_compare.BENCH_FILE, with the settings of the run, for
+   bench_compare.py to compare with those of another build.
 
 Adjust 'BUILD_DIR' or 'QEMU_KERNEL' below if your build artifacts differ.
+
+Usage:
+  python3 build_and_run.py [--app {secure,blinky,full,bench}] [--no-trace]
+                           [--profile {release,debug,perf}]
+                           [--icount [SHIFT]] [--icount-align] [--seed N]
 """
 
+import argparse
 import subprocess
 import sys
 import os
 
+from decode_binlog import BinaryLogDecoder
+import bench_compare
+import run_config
+import trace_capture
+import verdict
+
 # Path to the directory where your FreeRTOS demo gets built.
 BUILD_DIR = "/home/arampour/FreeRTOS/FreeRTOS/Demo/CORTEX_MPS2_QEMU_IAR_GCC/build/gcc"
 
-# Relative path (inside BUILD_DIR) to the compiled ELF.
-QEMU_KERNEL = "output/RTOSDemo.out"
+# Applications the Makefile builds (make APP=...), each into its own directory.
+APPS = ("secure", "blinky", "full", "bench")
+DEFAULT_APP = "secure"
+
+# Optimisation profiles of the Makefile (make PROFILE=...).
+PROFILES = ("release", "debug", "perf")
+DEFAULT_PROFILE = "release"
+
+# Relative path (inside BUILD_DIR) to the compiled ELF of an application,
+# built into output/<app>-notrace/ with TRACE=0.
+QEMU_KERNEL = "output/{app}{suffix}/RTOSDemo.out"
+
+# Where the trace of each run is saved (inside BUILD_DIR), overwritten by the
+# next run.
+TRACE_FILE = "trace.psf"
+
+def make_variables(app=DEFAULT_APP, trace=True, seed=None, profile=DEFAULT_PROFILE, options=None):
+    """
+    The make variables of a build, with RANDOM_SEED set to seed if given and
+    options holding any others, such as COVERAGE. Other make targets given the
+    same variables describe the same build.
+    """
+    variables = [f"APP={app}", f"TRACE={int(trace)}", f"PROFILE={profile}"]
+    if seed is not None:
+        # The Makefile rebuilds what the new flags affect.
+        variables.append(f"RANDOM_SEED={seed}")
+    variables += [f"{name}={value}" for name, value in (options or {}).items()]
+    return variables
 
-def build_firmware():
+def build_firmware(app=DEFAULT_APP, trace=True, seed=None, profile=DEFAULT_PROFILE, options=None):
     """
-    Run 'make' in the BUILD_DIR to compile the project.
+    Run 'make' in the BUILD_DIR to compile the application, with the
+    variables of make_variables(). Returns whether the build succeeded.
     """
-    print(f"Building firmware in {BUILD_DIR} ...")
-    result = subprocess.run(["make", "-j"], cwd=BUILD_DIR, capture_output=True, text=True)
+    print(f"Building {app} firmware ({profile}) in {BUILD_DIR} ...")
+    make_cmd = ["make", "-j"] + make_variables(app, trace, seed, profile, options)
+    result = subprocess.run(make_cmd, cwd=BUILD_DIR, capture_output=True, text=True)
     if result.returncode != 0:
         print("Build failed:\n")
         print(result.stdout)
         print(result.stderr)
-        sys.exit(1)
-    else:
-        print("Build succeeded.")
-        print(result.stdout)
+        return False
+    print("Build succeeded.")
+    print(result.stdout)
+    return True
 
-def run_qemu():
+def run_qemu(app=DEFAULT_APP, trace=True, icount=None, icount_align=False, seed=None,
+             profile=DEFAULT_PROFILE):
     """
     Launch QEMU to run the newly built firmware, routing output to the console.
+    Returns QEMU's exit status, None if the run was interrupted.
     """
+    kernel = QEMU_KERNEL.format(app=app, suffix="" if trace else "-notrace")
     qemu_cmd = [
         "qemu-system-arm",
         "-M", "mps2-an385",
-        "-kernel", QEMU_KERNEL,
+        "-kernel", kernel,
         "-serial", "mon:stdio",
         "-nographic",
-    ]
+    ] + run_config.qemu_icount_args(icount, icount_align) + verdict.qemu_verdict_args()
+    if trace:
+        qemu_cmd += trace_capture.qemu_trace_args(TRACE_FILE)
+
+    config = run_config.write(os.path.join(BUILD_DIR, run_config.RUN_CONFIG_FILE),
+                              os.path.join(BUILD_DIR, kernel), qemu_cmd, icount, icount_align,
+                              app=app, trace=trace, profile=profile,
+                              random_seed=seed if seed is not None else "Makefile default")
 
-    print(f"Running QEMU with kernel: {QEMU_KERNEL}\n")
-    process = subprocess.Popen(qemu_cmd, cwd=BUILD_DIR, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+    print(f"Running QEMU with kernel: {kernel} "
+          f"({run_config.timing_mode(icount, icount_align)})\n")
+    process = subprocess.Popen(qemu_cmd, cwd=BUILD_DIR, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    decoder = BinaryLogDecoder()
+    # The bench results are picked out of the console output afterwards.
+    console = [] if app == "bench" else None
 
     try:
-        # Stream QEMU's stdout to our console
-        for line in process.stdout:
-            print(line, end="")
+        # Stream QEMU's stdout to our console, decoding binary log frames
+        while True:
+            chunk = process.stdout.read1(4096)
+            if not chunk:
+                break
+            text = decoder.feed(chunk)
+            print(text, end="", flush=True)
+            if console is not None:
+                console.append(text)
     except KeyboardInterrupt:
         # If user hits Ctrl+C, stop QEMU gracefully
         pass
+    text = decoder.flush()
+    print(text, end="")
 
-    # Terminate QEMU (if still running)
-    process.kill()
+    # The output ends when the firmware exits with its verdict, otherwise
+    # terminate QEMU
+    try:
+        returncode = process.wait(timeout=1)
+    except subprocess.TimeoutExpired:
+        process.kill()
+        returncode = None
     out, err = process.communicate()
 
-    print("\nQEMU finished.")
+    print(f"\nQEMU finished. Verdict: {verdict.describe(returncode)}")
     if err:
-        print("Error output:\n", err)
+        print("Error output:\n", err.decode("latin-1"))
+    if trace:
+        trace_capture.report(os.path.join(BUILD_DIR, TRACE_FILE))
+    if console is not None:
+        console.append(text)
+        results = bench_compare.parse_lines("".join(console).splitlines())
+        bench_file = os.path.join(BUILD_DIR, bench_compare.BENCH_FILE)
+        bench_compare.write_results(bench_file, results, config)
+        print(f"{len(results)} benchmark results saved to {bench_file}")
+    return returncode
 
 def main():
-    build_firmware()
-    run_qemu()
+    parser = argparse.ArgumentParser(description="Build the firmware and run it under QEMU.")
+    parser.add_argument("--app", choices=APPS, default=DEFAULT_APP,
+                        help="application to build and run (default: %(default)s)")
+    parser.add_argument("--no-trace", dest="trace", action="store_false",
+                        help="build without TraceRecorder (make TRACE=0)")
+    parser.add_argument("--profile", choices=PROFILES, default=DEFAULT_PROFILE,
+                        help="optimisation profile (default: %(default)s)")
+    run_config.add_arguments(parser)
+    parser.add_argument("--seed", type=int, default=None,
+                        help="seed of the firmware's injected delays (make RANDOM_SEED)")
+    args = parser.parse_args()
+
+    if not build_firmware(args.app, args.trace, args.seed, args.profile):
+        sys.exit(1)
+    returncode = run_qemu(args.app, args.trace, args.icount, args.icount_align, args.seed,
+                          args.profile)
+    sys.exit(returncode if returncode is not None and returncode >= 0 else 0)
 
 if __name__ == "__main__":
     main()
@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+
+"""
+Binary Log Decoder
+------------------
+The firmware sends hot path telemetry as compact binary frames (see
+BinaryLog.h) mixed in with ordinary printf() text on the QEMU console.
+This module turns that console stream back into the plain text lines the
+rest of the pipeline (fuzz_test.py, analyze_results.py) expects.
+
+The message formats are read from LogMessages.h, so the decoder always
+matches the firmware it was built from.
+
+Usage:
+  python3 decode_binlog.py console.bin [-o console.txt] [--timestamps]
+  qemu-system-arm ... | python3 decode_binlog.py -
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+DEFAULT_FORMATS_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                    "..", "LogMessages.h")
+
+# Must match BinaryLog.h.
+FRAME_MARKER = 0x1E
+FRAME_HEADER_SIZE = 9
+MAX_ARGS = 3
+
+# One X( identifier, "format" ) entry of logMESSAGE_TABLE.
+_TABLE_ENTRY = re.compile(r'X\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+
+# printf conversions understood by the firmware side.
+_CONVERSION = re.compile(r'%(?:%|[-0 +#]*\d*([diuxXc]))')
+
+_C_ESCAPES = {"n": "\n", "r": "\r", "t": "\t", "\\": "\\", '"': '"', "0": "\0"}
+
+
+def _unescape_c_string(text):
+    return re.sub(r'\\(.)', lambda m: _C_ESCAPES.get(m.group(1), m.group(1)), text)
+
+
+def load_formats(path=DEFAULT_FORMATS_PATH):
+    """
+    Returns a list of (identifier, format, signed_flags) indexed by message id.
+    signed_flags has one entry per conversion, True where the argument should
+    be reinterpreted as a signed 32-bit value.
+    """
+    with open(path, "r", encoding="utf-8") as f:
+        content = f.read()
+
+    # Skip the file comment, which also mentions the entry layout.
+    start = content.find("#define logMESSAGE_TABLE")
+    if start < 0:
+        raise ValueError(f"{path}: logMESSAGE_TABLE not found")
+
+    formats = []
+    for identifier, fmt in _TABLE_ENTRY.findall(content, start):
+        fmt = _unescape_c_string(fmt)
+        signed = [conv in ("d", "i") for conv in _CONVERSION.findall(fmt) if conv]
+        formats.append((identifier, fmt, signed))
+    return formats
+
+
+class BinaryLogDecoder:
+    """
+    Incremental decoder: feed() it console bytes as they arrive and it
+    returns the text decoded so far.  Frames split across feed() calls are
+    held back until complete.
+    """
+
+    def __init__(self, formats=None, timestamps=False):
+        self.formats = formats if formats is not None else load_formats()
+        self.timestamps = timestamps
+        self.buffer = bytearray()
+        self.frames = 0
+        self.bad_frames = 0
+        self.unknown_ids = 0
+
+    def _format_record(self, msg_id, timestamp, args):
+        if msg_id >= len(self.formats):
+            self.unknown_ids += 1
+            text = f"<unknown log id {msg_id} args={list(args)}>\n"
+        else:
+            _, fmt, signed = self.formats[msg_id]
+            values = []
+            for i, value in enumerate(args):
+                if i < len(signed) and signed[i] and value >= 0x80000000:
+                    value -= 0x100000000
+                values.append(value)
+            try:
+                text = fmt % tuple(values)
+            except (TypeError, ValueError):
+                self.unknown_ids += 1
+                text = f"<bad args for log id {msg_id} args={list(args)}>\n"
+
+        if self.timestamps:
+            text = f"[{timestamp}] {text}"
+        return text
+
+    def feed(self, data):
+        self.buffer.extend(data)
+        out = []
+        buf = self.buffer
+        pos = 0
+
+        while True:
+            marker = buf.find(FRAME_MARKER, pos)
+            if marker < 0:
+                out.append(buf[pos:].decode("latin-1"))
+                pos = len(buf)
+                break
+
+            out.append(buf[pos:marker].decode("latin-1"))
+            pos = marker
+
+            if len(buf) - pos < FRAME_HEADER_SIZE:
+                break
+
+            argc = buf[pos + 2]
+            if argc > MAX_ARGS:
+                # Not a frame start (or a frame damaged by dropped console
+                # bytes) - skip the marker and carry on scanning.
+                self.bad_frames += 1
+                pos += 1
+                continue
+
+            frame_len = FRAME_HEADER_SIZE + 4 * argc + 1
+            if len(buf) - pos < frame_len:
+                break
+
+            checksum = 0
+            for b in buf[pos + 1:pos + frame_len - 1]:
+                checksum ^= b
+            if checksum != buf[pos + frame_len - 1]:
+                self.bad_frames += 1
+                pos += 1
+                continue
+
+            msg_id = buf[pos + 1]
+            timestamp, = struct.unpack_from("<I", buf, pos + 5)
+            args = struct.unpack_from(f"<{argc}I", buf, pos + FRAME_HEADER_SIZE)
+            out.append(self._format_record(msg_id, timestamp, args))
+            self.frames += 1
+            pos += frame_len
+
+        del buf[:pos]
+        return "".join(out)
+
+    def flush(self):
+        """
+        Returns whatever is still buffered as text (a frame truncated by the
+        end of the stream is reported rather than silently dropped).
+        """
+        if not self.buffer:
+            return ""
+        self.bad_frames += 1
+        text = f"<truncated log frame: {len(self.buffer)} bytes>\n"
+        self.buffer.clear()
+        return text
+
+
+def decode_bytes(data, formats=None, timestamps=False):
+    """
+    Decodes a complete console capture in one call.
+    """
+    decoder = BinaryLogDecoder(formats, timestamps)
+    return decoder.feed(data) + decoder.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode binary log frames in a QEMU console capture.")
+    parser.add_argument("input", help="Console capture file, or - for stdin")
+    parser.add_argument("-o", "--output", help="Output text file (default: stdout)")
+    parser.add_argument("--formats", default=DEFAULT_FORMATS_PATH, help="Path to LogMessages.h")
+    parser.add_argument("--timestamps", action="store_true", help="Prefix decoded records with their timestamp")
+    args = parser.parse_args()
+
+    decoder = BinaryLogDecoder(load_formats(args.formats), args.timestamps)
+    src = sys.stdin.buffer if args.input == "-" else open(args.input, "rb")
+    dst = open(args.output, "w", encoding="utf-8") if args.output else sys.stdout
+
+    try:
+        while True:
+            chunk = src.read1(65536) if hasattr(src, "read1") else src.read(65536)
+            if not chunk:
+                break
+            dst.write(decoder.feed(chunk))
+            dst.flush()
+        dst.write(decoder.flush())
+    finally:
+        if src is not sys.stdin.buffer:
+            src.close()
+        if dst is not sys.stdout:
+            dst.close()
+
+    if decoder.bad_frames or decoder.unknown_ids:
+        print(f"[WARN] {decoder.bad_frames} damaged frames, {decoder.unknown_ids} unknown records",
+              file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,370 @@
+#!/usr/bin/env python3
+
+"""
+Corpus, coverage and mutations for coverage guided fuzzing (fuzz_test.py --coverage).
+
+A firmware built with "make COVERAGE=1" writes the edge coverage of each run
+to coverage.bin in QEMU's working directory (see Coverage.h). An input is a
+list of packets, sent in the UART0 framing of UARTPacketRx.h. Inputs whose
+coverage sets a bit that no earlier input set - a new edge, or a known edge
+taken a new number of times, bucketed as AFL does - are kept in the corpus,
+and new inputs are mutations of corpus entries: bit flips, interesting bytes,
+inserted and removed bytes, changes to the MQTT remaining length that keep or
+deliberately break its variable length encoding, and splices of two entries.
+
+Corpus entries are saved as framed streams, so any of them can be replayed:
+  qemu-system-arm ... -serial stdio < test_artifacts/corpus/<id>.bin
+
+Usage:
+  python3 fuzz_corpus.py [CORPUS_DIR]    # summarise a corpus
+"""
+
+import hashlib
+import os
+import sys
+import threading
+
+# Must match Coverage.h.
+MAP_SIZE = 4096
+COVERAGE_FILE = "coverage.bin"
+
+# Must match UARTPacketRx.h and PacketRing.h.
+FRAME_MARKER = 0xA5
+MAX_PACKET_SIZE = 256
+
+# Most packets in one input.
+MAX_PACKETS = 16
+
+# Most mutations stacked onto one input.
+MAX_STACKED_MUTATIONS = 8
+
+# Hit count buckets: 1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128+.
+_BUCKETS = bytes(
+    0 if n == 0 else
+    1 if n == 1 else
+    2 if n == 2 else
+    4 if n == 3 else
+    8 if n < 8 else
+    16 if n < 16 else
+    32 if n < 32 else
+    64 if n < 128 else
+    128
+    for n in range(256))
+
+_INTERESTING_BYTES = (0x00, 0x01, 0x02, 0x7F, 0x80, 0x81, 0xFE, 0xFF)
+
+# Remaining lengths at the edges of each encoded size, and the largest allowed.
+INTERESTING_LENGTHS = (0, 1, 127, 128, 16383, 16384, 2097151, 2097152, 268435455)
+
+# One of each MQTT 3.1.1 control packet, to start an empty corpus.
+SEED_PACKETS = (
+    bytes([0x10, 12, 0x00, 4]) + b"MQTT" + bytes([4, 0x02, 0x00, 60, 0x00, 0]),  # CONNECT
+    bytes([0x20, 2, 0x00, 0x00]),                                              # CONNACK
+    bytes([0x30, 9, 0x00, 3]) + b"a/b" + b"data",                              # PUBLISH QoS 0
+    bytes([0x32, 11, 0x00, 3]) + b"a/b" + bytes([0x00, 1]) + b"data",          # PUBLISH QoS 1
+    bytes([0x40, 2, 0x00, 1]),                                                 # PUBACK
+    bytes([0x50, 2, 0x00, 1]),                                                 # PUBREC
+    bytes([0x62, 2, 0x00, 1]),                                                 # PUBREL
+    bytes([0x70, 2, 0x00, 1]),                                                 # PUBCOMP
+    bytes([0x82, 8, 0x00, 1, 0x00, 3]) + b"a/b" + bytes([0]),                  # SUBSCRIBE
+    bytes([0x90, 3, 0x00, 1, 0]),                                              # SUBACK
+    bytes([0xA2, 7, 0x00, 1, 0x00, 3]) + b"a/b",                               # UNSUBSCRIBE
+    bytes([0xB0, 2, 0x00, 1]),                                                 # UNSUBACK
+    bytes([0xC0, 0]),                                                          # PINGREQ
+    bytes([0xD0, 0]),                                                          # PINGRESP
+    bytes([0xE0, 0]),                                                          # DISCONNECT
+)
+
+
+def frame_packet(payload):
+    """
+    Returns payload framed for UART0: marker, 16-bit big endian length, payload.
+    """
+    return bytes([FRAME_MARKER, (len(payload) >> 8) & 0xFF, len(payload) & 0xFF]) + payload
+
+
+def frame_packets(packets):
+    return b"".join(frame_packet(p) for p in packets)
+
+
+def unframe(stream):
+    """
+    Splits a framed stream back into its packets, skipping bytes outside frames
+    like the firmware does.
+    """
+    packets = []
+    i = 0
+    while i + 3 <= len(stream):
+        if stream[i] != FRAME_MARKER:
+            i += 1
+            continue
+        length = (stream[i + 1] << 8) | stream[i + 2]
+        packets.append(bytes(stream[i + 3:i + 3 + length]))
+        i += 3 + length
+    return packets
+
+
+def read_coverage(directory):
+    """
+    Reads and removes the coverage map a run left in directory. Returns None
+    if the run did not write one, as when it was stopped by a timeout.
+    """
+    path = os.path.join(directory, COVERAGE_FILE)
+    try:
+        with open(path, "rb") as f:
+            data = f.read()
+        os.remove(path)
+    except FileNotFoundError:
+        return None
+    return data if len(data) == MAP_SIZE else None
+
+
+def classify(bitmap):
+    """
+    Hit counts to bucket bits, so that taking an edge a few more times is not
+    new coverage but taking it an order of magnitude more often is.
+    """
+    return bitmap.translate(_BUCKETS)
+
+
+def encode_remaining_length(value, minimal=True):
+    """
+    MQTT variable length encoding. With minimal False, one more continuation
+    byte than needed is used, which the specification forbids.
+    """
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value or not minimal:
+            out.append(byte | 0x80)
+            if not value:
+                out.append(0)
+                break
+        else:
+            out.append(byte)
+            break
+    return bytes(out)
+
+
+def decode_remaining_length(packet):
+    """
+    Returns (value, encoded size) of the remaining length at offset 1, or None
+    if the packet is too short or the encoding does not end within 4 bytes.
+    """
+    value = 0
+    for i in range(4):
+        if 1 + i >= len(packet):
+            return None
+        byte = packet[1 + i]
+        value |= (byte & 0x7F) << (7 * i)
+        if not byte & 0x80:
+            return value, i + 1
+    return None
+
+
+class Mutator:
+    """
+    Derives new inputs from corpus entries. Inputs are lists of packets.
+    """
+
+    def __init__(self, rng):
+        self.rng = rng
+        self._packet_ops = (self.flip_bit, self.set_interesting_byte, self.set_random_byte,
+                            self.insert_bytes, self.delete_bytes, self.tweak_remaining_length,
+                            self.tweak_remaining_length)
+        self._input_ops = (self.duplicate_packet, self.drop_packet, self.swap_packets)
+
+    def mutate(self, packets, other):
+        """
+        Returns a mutated copy of packets. other is a second corpus entry to
+        splice from.
+        """
+        packets = [bytearray(p) for p in packets] or [bytearray(self.rng.choice(SEED_PACKETS))]
+        for _ in range(self.rng.randint(1, MAX_STACKED_MUTATIONS)):
+            choice = self.rng.randint(0, 9)
+            if choice == 0 and other:
+                packets = self.splice(packets, other)
+            elif choice == 1:
+                self.rng.choice(self._input_ops)(packets)
+            else:
+                i = self.rng.randrange(len(packets))
+                packets[i] = self.rng.choice(self._packet_ops)(packets[i])
+        return [bytes(p[:MAX_PACKET_SIZE]) for p in packets if p][:MAX_PACKETS] or [bytes(SEED_PACKETS[0])]
+
+    # Packet level mutations. Each returns the new packet.
+
+    def flip_bit(self, p):
+        if p:
+            p[self.rng.randrange(len(p))] ^= 1 << self.rng.randrange(8)
+        return p
+
+    def set_interesting_byte(self, p):
+        if p:
+            p[self.rng.randrange(len(p))] = self.rng.choice(_INTERESTING_BYTES)
+        return p
+
+    def set_random_byte(self, p):
+        if p:
+            p[self.rng.randrange(len(p))] = self.rng.randrange(256)
+        return p
+
+    def insert_bytes(self, p):
+        at = self.rng.randint(0, len(p))
+        count = self.rng.randint(1, 16)
+        p[at:at] = bytes(self.rng.randrange(256) for _ in range(count))
+        return p
+
+    def delete_bytes(self, p):
+        if len(p) > 1:
+            at = self.rng.randrange(len(p))
+            del p[at:at + self.rng.randint(1, min(16, len(p) - at))]
+        return p
+
+    def tweak_remaining_length(self, p):
+        """
+        Rewrites the MQTT remaining length: to the true length, a value next
+        to the current one, or one at an encoding boundary, sometimes with a
+        non-minimal encoding.
+        """
+        decoded = decode_remaining_length(p)
+        if decoded is None:
+            return p
+        value, size = decoded
+        true_length = len(p) - 1 - size
+        choice = self.rng.randint(0, 3)
+        if choice == 0:
+            value = true_length
+        elif choice == 1:
+            value = max(0, value + self.rng.choice((-2, -1, 1, 2)))
+        else:
+            value = self.rng.choice(INTERESTING_LENGTHS)
+        minimal = self.rng.randint(0, 7) != 0 or value > 2097151
+        p[1:1 + size] = encode_remaining_length(value, minimal)
+        return p
+
+    # Input level mutations, in place.
+
+    def duplicate_packet(self, packets):
+        if len(packets) < MAX_PACKETS:
+            i = self.rng.randrange(len(packets))
+            packets.insert(i, bytearray(packets[i]))
+
+    def drop_packet(self, packets):
+        if len(packets) > 1:
+            del packets[self.rng.randrange(len(packets))]
+
+    def swap_packets(self, packets):
+        if len(packets) > 1:
+            i, j = self.rng.sample(range(len(packets)), 2)
+            packets[i], packets[j] = packets[j], packets[i]
+
+    def splice(self, packets, other):
+        """
+        Either takes packets from both inputs, or joins the start of one of
+        this input's packets to the end of one of the other's.
+        """
+        if self.rng.randint(0, 1):
+            cut = self.rng.randint(1, len(packets))
+            other_cut = self.rng.randint(0, len(other))
+            return packets[:cut] + [bytearray(p) for p in other[other_cut:]]
+        i = self.rng.randrange(len(packets))
+        donor = self.rng.choice(other)
+        a = self.rng.randint(0, len(packets[i]))
+        b = self.rng.randint(0, len(donor))
+        packets[i] = packets[i][:a] + bytearray(donor[b:])
+        return packets
+
+
+class Corpus:
+    """
+    The inputs that reached new coverage, shared by every fuzz worker.
+    """
+
+    def __init__(self, directory):
+        self.directory = directory
+        self._lock = threading.Lock()
+        self._entries = []
+        self._virgin = bytearray(MAP_SIZE)  # bucket bits seen so far
+        os.makedirs(directory, exist_ok=True)
+
+    def load(self):
+        """
+        Loads the entries saved by an earlier run, or the seed packets if there
+        are none. Returns the number of entries. Their coverage is not known
+        until they are run again, so they do not count as covered.
+        """
+        for fname in sorted(os.listdir(self.directory)):
+            if fname.endswith(".bin"):
+                with open(os.path.join(self.directory, fname), "rb") as f:
+                    packets = unframe(f.read())
+                if packets:
+                    self._entries.append(packets)
+        if not self._entries:
+            for packet in SEED_PACKETS:
+                self._entries.append([packet])
+        return len(self._entries)
+
+    def __len__(self):
+        with self._lock:
+            return len(self._entries)
+
+    def pick(self, rng):
+        """
+        Returns two entries, the one to mutate and one to splice from.
+        Recent entries are favoured, as they are the ones nearest the edge of
+        what has been covered.
+        """
+        with self._lock:
+            n = len(self._entries)
+            i = n - 1 - min(int(rng.expovariate(4.0 / n)), n - 1)
+            return self._entries[i], self._entries[rng.randrange(n)]
+
+    def add(self, packets, bitmap):
+        """
+        Merges a run's coverage. If it set any new bucket bit the input is
+        kept and saved, and the number of new bits is returned, otherwise 0.
+        """
+        classified = classify(bitmap)
+        with self._lock:
+            new_bits = 0
+            virgin = self._virgin
+            for i, bits in enumerate(classified):
+                new = bits & ~virgin[i]
+                if new:
+                    new_bits += bin(new).count("1")
+                    virgin[i] |= new
+            if not new_bits:
+                return 0
+            self._entries.append([bytes(p) for p in packets])
+            stream = frame_packets(packets)
+            name = hashlib.sha1(stream).hexdigest()[:16] + ".bin"
+            with open(os.path.join(self.directory, name), "wb") as f:
+                f.write(stream)
+            return new_bits
+
+    def sizes(self):
+        """
+        Bytes of packet data in each entry.
+        """
+        with self._lock:
+            return [sum(len(p) for p in e) for e in self._entries]
+
+    def edges(self):
+        """
+        Number of map entries any input has reached.
+        """
+        with self._lock:
+            return sum(1 for b in self._virgin if b)
+
+
+def main():
+    directory = sys.argv[1] if len(sys.argv) > 1 else os.path.join("test_artifacts", "corpus")
+    corpus = Corpus(directory)
+    count = corpus.load()
+    sizes = corpus.sizes()
+    print(f"{directory}: {count} entries, {sum(sizes)} bytes, largest {max(sizes)} bytes")
+
+
+if __name__ == "__main__":
+    main()
@@ -5,40 +5,117 @@ Step 4: Security & Reliability Testing - Fuzzing
 ------------------------------------------------
 Modifications:
   - Outputs artifacts into ./test_artifacts/ so analyze_results.py can parse them.
+  - Decodes the firmware's binary log frames (decode_binlog.py) so the logs
+    contain the same text lines as before.
+  - Saves the TraceRecorder stream of every run as
+    fuzz_trace_<iteration>.psf (trace_capture.py).
+  - Runs several QEMU instances at once. Each worker has its own artifact
+    directory, test_artifacts/worker_<n>/, and its own random generator seeded
+    from the base seed, so a run can be repeated with --seed. Results are
+    collected as they finish, and the throughput of the whole run and of each
+    worker is reported at the end.
+  - The firmware ends a run through semihosting as soon as its outcome is
+    known (Verdict.h), so a run only lasts its full random timeout when
+    nothing went wrong. The exit status names the finding (verdict.py).
+  - Sends the random data as packets in the firmware's UART0 framing
+    (UARTPacketRx.h), so each run feeds NetTask's MQTT decoder different
+    packets.
+  - With --coverage, and firmware built with "make COVERAGE=1", inputs are
+    mutated from a corpus of earlier inputs that reached new edges instead of
+    being random (fuzz_corpus.py). The corpus is kept in test_artifacts/corpus/
+    across fuzz runs, and the summary reports the inputs added to it per CPU
+    hour.
+  - With --persistent, and firmware built with "make PERSISTENT=1", each
+    worker boots QEMU once and restores a snapshot taken when NetTask is ready
+    for input before every run (persistent_qemu.py), instead of booting the
+    firmware for each input. No trace is recorded in this mode.
+  - Random mode builds its packets from the MQTT grammar, a share of them
+    deliberately malformed (mqtt_gen.py), rather than from random bytes that
+    the decoder rejects at the first byte. With --inputs the packets are
+    instead taken from a file pre-generated by mqtt_gen.py.
+  - With --icount, QEMU runs in the deterministic timing mode (run_config.py),
+    so whether an input misses a deadline does not depend on the host or its
+    load. The settings of the fuzz run are saved in
+    test_artifacts/run_config.json, and each crash log names the timing mode.
+  - run() fuzzes as main() does and can report each crash log as soon as it
+    is written, for pipeline.py to analyse it while fuzzing goes on.
 
 Usage:
-  python3 fuzz_test.py
+  python3 fuzz_test.py [--workers N] [--iterations N | --duration SECONDS] [--seed S]
+                       [--coverage [--corpus DIR] | --inputs FILE] [--persistent]
+                       [--icount [SHIFT] [--icount-align]]
 """
 
+import argparse
 import os
+import queue
 import random
 import subprocess
+import threading
 import time
 import shutil
 
+from decode_binlog import decode_bytes, load_formats
+import fuzz_corpus
+from fuzz_corpus import MAX_PACKET_SIZE, MAX_PACKETS, frame_packet, frame_packets
+from mqtt_gen import MqttGenerator
+from persistent_qemu import PersistentQemu
+import run_config
+import trace_capture
+import verdict
+
 # If you want to automatically build first, set to True and update the path:
 AUTO_BUILD = False
 BUILD_SCRIPT = "./build_and_run.py"  # Or the path to your Step 3 script
 
 # Where is your QEMU kernel after building?
-FIRMWARE_PATH = "/home/arampour/FreeRTOS/FreeRTOS/Demo/CORTEX_MPS2_QEMU_IAR_GCC/build/gcc/output/RTOSDemo.out"
+FIRMWARE_PATH = "/home/arampour/FreeRTOS/FreeRTOS/Demo/CORTEX_MPS2_QEMU_IAR_GCC/build/gcc/output/secure/RTOSDemo.out"
 
 # Directory to store fuzz inputs and logs
 TEST_ARTIFACTS_DIR = "test_artifacts"
+WORKER_DIR_PREFIX = "worker_"
+CRASHLOG_PREFIX = "fuzz_crashlog_"
 NUM_ITERATIONS = 10
 
+CORPUS_DIR = os.path.join(TEST_ARTIFACTS_DIR, "corpus")
+
+# Longest a coverage run may take. The firmware normally ends it much sooner,
+# COVERAGE_RUN_MS (build/gcc/Makefile) after boot.
+COVERAGE_TIMEOUT = 5
+
+# Seconds between progress lines while fuzzing.
+PROGRESS_INTERVAL = 10.0
+
+# Message formats for the binary log frames in the QEMU output.
+LOG_FORMATS = load_formats()
+
+# Names of the firmware's exit statuses.
+VERDICTS = verdict.load_verdicts()
+
+# Outcomes that are not findings: the firmware passed, or was still running
+# when its time was up.
+CLEAN_VERDICTS = ("Pass", "Timeout")
+
+# Timing mode options for every QEMU run, set from the command line.
+TIMING_ARGS = []
+TIMING_MODE = run_config.timing_mode(None)
+
 def clear_old_logs():
     """
-    Removes old fuzz logs and input files from test_artifacts/ before
-    starting a new fuzz test run.
+    Removes old fuzz logs, input files and worker directories from
+    test_artifacts/ before starting a new fuzz test run.
     """
     if os.path.isdir(TEST_ARTIFACTS_DIR):
         for fname in os.listdir(TEST_ARTIFACTS_DIR):
+            path = os.path.join(TEST_ARTIFACTS_DIR, fname)
             # Remove old fuzz inputs and logs
-            if (fname.startswith("fuzz_crashlog_") or
+            if (fname.startswith(CRASHLOG_PREFIX) or
                 fname.startswith("fuzz_freezelog_") or
-                fname.startswith("fuzz_input_")):
-                os.remove(os.path.join(TEST_ARTIFACTS_DIR, fname))
+                fname.startswith("fuzz_input_") or
+                fname.startswith("fuzz_trace_")):
+                os.remove(path)
+            elif fname.startswith(WORKER_DIR_PREFIX) and os.path.isdir(path):
+                shutil.rmtree(path)
     else:
         print(f"[INFO] Directory '{TEST_ARTIFACTS_DIR}' does not exist; no old logs to clear.")
 
@@ -57,95 +134,409 @@ def build_firmware_if_needed():
         else:
             print("Build succeeded, continuing to fuzzing...")
 
-def create_random_data(max_size=512):
+def create_random_data(rng, max_size=MAX_PACKET_SIZE):
     """
     Returns a randomly sized bytes object, sometimes exceeding max_size to test boundary checks.
     """
-    size = random.randint(1, max_size * 2)  # occasionally exceed expected
-    return bytes([random.randint(0, 255) for _ in range(size)])
+    size = rng.randint(1, max_size * 2)  # occasionally exceed expected
+    return rng.randbytes(size)
 
-def fuzz_once(iteration):
+def create_fuzz_input(rng, generator):
     """
-    1. Generate random input
-    2. Launch QEMU
-    3. Check output only for 'Deadline Missed'
+    Returns a stream of randomly many framed packets, mostly from the MQTT
+    generator. The occasional random packet larger than the firmware's slots
+    is skipped by its framing, and stray bytes between frames exercise its
+    resynchronisation.
     """
-    fuzz_data = create_random_data()
+    stream = bytearray()
+    for _ in range(rng.randint(1, MAX_PACKETS)):
+        if rng.randint(0, 15) == 0:
+            stream += create_random_data(rng, 4)
+        if rng.randint(0, 15) == 0:
+            payload = create_random_data(rng)  # may not fit a slot
+        else:
+            payload = generator.packet()
+        stream += frame_packet(payload)
+    return bytes(stream)
 
-    input_filename = os.path.join(TEST_ARTIFACTS_DIR, f"fuzz_input_{iteration}.bin")
-    with open(input_filename, "wb") as f:
-        f.write(fuzz_data)
+def load_inputs(path):
+    """
+    Returns the packets of a file written by mqtt_gen.py.
+    """
+    with open(path, "rb") as f:
+        packets = fuzz_corpus.unframe(f.read())
+    if not packets:
+        raise SystemExit(f"No framed packets in {path}.")
+    return packets
 
-    print(f"[Iteration {iteration}] Starting QEMU with {len(fuzz_data)} bytes of fuzz data...")
+def take_inputs(rng, packets):
+    """
+    Returns randomly many consecutive packets from a pre-generated file, framed.
+    """
+    count = rng.randint(1, MAX_PACKETS)
+    start = rng.randrange(max(1, len(packets) - count + 1))
+    return frame_packets(packets[start:start + count])
 
-    qemu_cmd = [
+def qemu_base_cmd():
+    """
+    The QEMU command line shared by both modes, without the monitor and
+    serial port options.
+    """
+    return [
         "qemu-system-arm",
         "-machine", "mps2-an385",            # MPS2-AN385 board
         "-cpu", "cortex-m3",                # Explicitly select the CPU core
         "-kernel", FIRMWARE_PATH,           # Your firmware ELF/AXF/OUT
-        "-monitor", "none",                 # Disable QEMU monitor
         "-nographic",                       # No graphical window
         "-semihosting",                     # Enable semihosting
-        "-semihosting-config", "enable=on,target=native", 
+        "-semihosting-config", "enable=on,target=native",  # Lets the firmware exit with its verdict
+    ] + TIMING_ARGS                         # Deterministic timing, if selected
+
+def worker_dir(worker_id):
+    return os.path.join(TEST_ARTIFACTS_DIR, f"{WORKER_DIR_PREFIX}{worker_id}")
+
+def crash_log_path(artifact_dir, iteration):
+    return os.path.join(artifact_dir, f"{CRASHLOG_PREFIX}{iteration}.txt")
+
+def save_input(iteration, fuzz_data, artifact_dir):
+    input_filename = os.path.join(artifact_dir, f"fuzz_input_{iteration}.bin")
+    with open(input_filename, "wb") as f:
+        f.write(fuzz_data)
+
+def check_output(iteration, result, out, err, trace_filename, artifact_dir):
+    """
+    Decodes the QEMU output, looks for a logged 'Deadline Missed' and writes
+    the crash log of a finding. Returns the final verdict name.
+    """
+    out = decode_bytes(out, LOG_FORMATS)
+    err = err.decode('latin-1')
+
+    # Firmware built with verdictEXIT_ON_DEADLINE_MISS 0 only logs the miss.
+    out_lower = out.lower()
+    err_lower = err.lower()
+    if result in CLEAN_VERDICTS and ("missed deadline" in out_lower or "missed deadline" in err_lower):
+        result = "DeadlineMissed"
+
+    if result not in CLEAN_VERDICTS:
+        log_filename = crash_log_path(artifact_dir, iteration)
+        with open(log_filename, "w") as lf:
+            lf.write(f"=== VERDICT === {result}\n")
+            lf.write(f"=== TIMING === {TIMING_MODE}\n")
+            lf.write(f"=== TRACE === {trace_filename}\n")
+            lf.write("=== STDOUT ===\n")
+            lf.write(out)
+            lf.write("\n=== STDERR ===\n")
+            lf.write(err)
+    return result
+
+def fuzz_once(iteration, fuzz_data, timeout, artifact_dir):
+    """
+    1. Launch QEMU in artifact_dir with the framed input on UART0
+    2. Check the exit status, and the output for 'Deadline Missed'
+    3. Collect the coverage map, if the firmware wrote one
+
+    Returns (verdict, coverage): the verdict name (see verdict.py), anything
+    but CLEAN_VERDICTS being a finding, and the map or None.
+    """
+    save_input(iteration, fuzz_data, artifact_dir)
+
+    trace_filename = os.path.abspath(os.path.join(artifact_dir, f"fuzz_trace_{iteration}.psf"))
+
+    qemu_cmd = qemu_base_cmd() + [
+        "-monitor", "none",                 # Disable QEMU monitor
         "-serial", "stdio"                  # Send UART output to stdio
-    ]
+    ] + trace_capture.qemu_trace_args(trace_filename)  # UART1 trace stream
 
+    # The working directory is where semihosting writes the coverage map.
     proc = subprocess.Popen(
         qemu_cmd,
+        cwd=artifact_dir,
         stdin=subprocess.PIPE,
         stdout=subprocess.PIPE,
-        stderr=subprocess.PIPE,
-        text=True
+        stderr=subprocess.PIPE
     )
 
     try:
-        # If your firmware doesn't actually read from stdin,
-        # passing fuzz_data won't matter. But let's keep it:
-        #out, err = proc.communicate("HelloX", timeout = 5)  # for instance
-        number = random.randint(1, 5)
+        # stdin is UART0, where the firmware reads its packets
         out, err = proc.communicate(
-            input=fuzz_data.decode('latin-1', errors='ignore'),
-            timeout=number
+            input=fuzz_data,
+            timeout=timeout
         )
+        returncode = proc.returncode
     except subprocess.TimeoutExpired:
-        #print(f"[Iteration {iteration}] QEMU timed out. Potential freeze.")
         proc.kill()
         out, err = proc.communicate()
+        returncode = None
 
-        # Create a separate freeze log
-        #freeze_log_filename = os.path.join(TEST_ARTIFACTS_DIR, f"fuzz_freezelog_{iteration}.txt")
-        #with open(freeze_log_filename, "w") as lf:
-        #    lf.write(f"[Iteration {iteration}] QEMU freeze or timeout detected.\n")
-        #    lf.write("=== STDOUT ===\n")
-        #    lf.write(out)
-        #    lf.write("\n=== STDERR ===\n")
+    result = verdict.describe(returncode, VERDICTS)
+    coverage = fuzz_corpus.read_coverage(artifact_dir)
 
-    # We only look for "Deadline Missed"
-    out_lower = out.lower()
-    err_lower = err.lower()
-    #print(out_lower)
-    if "missed deadline" in out_lower or "missed deadline" in err_lower:
-        print(f"[Iteration {iteration}] Detected missed deadline!")
-        log_filename = os.path.join(TEST_ARTIFACTS_DIR, f"fuzz_crashlog_{iteration}.txt")
-        with open(log_filename, "w") as lf:
-            lf.write("=== STDOUT ===\n")
-            lf.write(out)
-            lf.write("\n=== STDERR ===\n")
-            lf.write(err)
-    else:
-        print(f"[Iteration {iteration}] No missed deadline detected.")
+    result = check_output(iteration, result, out, err, trace_filename, artifact_dir)
+    return result, coverage
 
+def fuzz_once_persistent(qemu, iteration, fuzz_data, timeout, artifact_dir):
+    """
+    fuzz_once() on a PersistentQemu running in artifact_dir: restore the ready
+    snapshot, send the input and wait for the VERDICT line. A hung input is
+    reported as a timeout and the next restore recovers from it. The number
+    of input bytes the firmware left unread goes in the crash log.
+    """
+    save_input(iteration, fuzz_data, artifact_dir)
 
-def main():
-    build_firmware_if_needed()
+    status, out = qemu.run(fuzz_data, timeout)
+    result = verdict.describe(status, VERDICTS)
+    coverage = fuzz_corpus.read_coverage(artifact_dir)
+
+    err = f"{qemu.unread_bytes} input byte(s) not read by the firmware\n".encode()
+    result = check_output(iteration, result, out, err, "(not recorded in persistent mode)", artifact_dir)
+    return result, coverage
+
+
+class IterationSource:
+    """
+    Hands out iteration numbers to the workers until the iteration count or
+    the deadline is reached.
+    """
+
+    def __init__(self, iterations, deadline):
+        self._lock = threading.Lock()
+        self._next = 0
+        self._iterations = iterations
+        self._deadline = deadline
+
+    def take(self):
+        """
+        The next iteration number, or None when the run is over.
+        """
+        with self._lock:
+            if self._iterations is not None and self._next >= self._iterations:
+                return None
+            if self._deadline is not None and time.monotonic() >= self._deadline:
+                return None
+            iteration = self._next
+            self._next += 1
+            return iteration
+
+
+def worker(worker_id, seed, source, results, corpus, persistent=False, inputs=None):
+    """
+    Runs fuzz iterations until the source is exhausted, putting
+    (worker_id, iteration, verdict, seconds, new_bits) on the results queue
+    after each, and (worker_id, None, None, None, None) when done. new_bits is
+    the coverage the input added to the corpus, None if there was no map.
+    Without a corpus the inputs are generated, or taken from the inputs
+    packets if given. In persistent mode the worker keeps one QEMU instance
+    for all its iterations.
+    """
+    rng = random.Random(seed)
+    mutator = fuzz_corpus.Mutator(rng)
+    generator = MqttGenerator(rng)
+    artifact_dir = worker_dir(worker_id)
+    os.makedirs(artifact_dir, exist_ok=True)
+    qemu = PersistentQemu(qemu_base_cmd(), artifact_dir) if persistent else None
+
+    while True:
+        iteration = source.take()
+        if iteration is None:
+            break
+        if corpus is not None:
+            packets = mutator.mutate(*corpus.pick(rng))
+            fuzz_data = fuzz_corpus.frame_packets(packets)
+            timeout = COVERAGE_TIMEOUT
+        else:
+            fuzz_data = take_inputs(rng, inputs) if inputs else create_fuzz_input(rng, generator)
+            timeout = rng.randint(1, 5)
+        start = time.monotonic()
+        new_bits = None
+        try:
+            if qemu is not None:
+                result, coverage = fuzz_once_persistent(qemu, iteration, fuzz_data, timeout, artifact_dir)
+            else:
+                result, coverage = fuzz_once(iteration, fuzz_data, timeout, artifact_dir)
+            if corpus is not None and coverage is not None:
+                new_bits = corpus.add(packets, coverage)
+        except (OSError, RuntimeError) as e:
+            print(f"[Worker {worker_id}] Iteration {iteration} failed to run: {e}")
+            result = "Error"
+            if qemu is not None:
+                qemu.stop()
+        results.put((worker_id, iteration, result, time.monotonic() - start, new_bits))
+
+    if qemu is not None:
+        print(f"[Worker {worker_id}] {qemu.boots} boot(s), {qemu.restores} snapshot restore(s), "
+              f"{qemu.total_unread_bytes} input byte(s) unread")
+        qemu.stop()
+    results.put((worker_id, None, None, None, None))
+
+
+def run_pool(num_workers, iterations, duration, seed, corpus=None, persistent=False, inputs=None,
+             on_finding=None):
+    """
+    Starts the workers and collects their results as they finish. Returns the
+    per worker statistics and the elapsed time. on_finding, if given, is
+    called with the path of each crash log as it is collected.
+    """
+    deadline = time.monotonic() + duration if duration is not None else None
+    source = IterationSource(iterations, deadline)
+    results = queue.Queue()
+    stats = {w: {"execs": 0, "findings": 0, "busy": 0.0, "verdicts": {}, "kept": 0, "no_map": 0}
+             for w in range(num_workers)}
+
+    start = time.monotonic()
+    threads = []
+    for w in range(num_workers):
+        # Each worker's inputs depend only on the base seed and its id.
+        t = threading.Thread(target=worker, args=(w, seed + w, source, results, corpus, persistent, inputs),
+                             daemon=True)
+        t.start()
+        threads.append(t)
+
+    running = num_workers
+    next_progress = start + PROGRESS_INTERVAL
+    while running:
+        try:
+            worker_id, iteration, result, seconds, new_bits = results.get(timeout=1.0)
+        except queue.Empty:
+            worker_id = None
+        else:
+            if iteration is None:
+                running -= 1
+            else:
+                s = stats[worker_id]
+                s["execs"] += 1
+                s["busy"] += seconds
+                s["verdicts"][result] = s["verdicts"].get(result, 0) + 1
+                if result not in CLEAN_VERDICTS:
+                    s["findings"] += 1
+                    print(f"[Worker {worker_id}] Iteration {iteration}: {result} after {seconds:.2f}s")
+                    log_path = crash_log_path(worker_dir(worker_id), iteration)
+                    # Inputs that failed to run leave no log.
+                    if on_finding is not None and os.path.isfile(log_path):
+                        on_finding(log_path)
+                if new_bits:
+                    s["kept"] += 1
+                elif new_bits is None and corpus is not None:
+                    s["no_map"] += 1
+
+        now = time.monotonic()
+        if now >= next_progress:
+            execs = sum(s["execs"] for s in stats.values())
+            line = f"[PROGRESS] {execs} execs in {now - start:.0f}s, {execs / (now - start):.2f} exec/s"
+            if corpus is not None:
+                line += f", corpus {len(corpus)}, {corpus.edges()} edges"
+            print(line)
+            next_progress = now + PROGRESS_INTERVAL
+
+    for t in threads:
+        t.join()
+
+    return stats, time.monotonic() - start
+
+
+def print_summary(stats, elapsed, seed, corpus=None):
+    """
+    Prints the overall and per worker throughput, and in coverage mode what
+    the corpus gained per CPU hour (time spent in QEMU, summed over workers).
+    """
+    execs = sum(s["execs"] for s in stats.values())
+    findings = sum(s["findings"] for s in stats.values())
+    rate = execs / elapsed if elapsed > 0 else 0.0
+    print(f"\n{execs} execs in {elapsed:.1f}s with {len(stats)} workers: "
+          f"{rate:.2f} exec/s, {findings} finding(s), base seed {seed}")
+    verdicts = {}
+    for s in stats.values():
+        for name, count in s["verdicts"].items():
+            verdicts[name] = verdicts.get(name, 0) + count
+    print("  verdicts: " + ", ".join(f"{name}={count}" for name, count in sorted(verdicts.items())))
+    if corpus is not None:
+        cpu_hours = sum(s["busy"] for s in stats.values()) / 3600.0
+        kept = sum(s["kept"] for s in stats.values())
+        no_map = sum(s["no_map"] for s in stats.values())
+        per_hour = kept / cpu_hours if cpu_hours > 0 else 0.0
+        print(f"  coverage: {corpus.edges()} edges, corpus {len(corpus)} entries, "
+              f"{kept} new inputs ({per_hour:.0f} per CPU hour)")
+        if no_map:
+            print(f"  [WARN] {no_map} runs wrote no coverage map. "
+                  "Was the firmware built with COVERAGE=1, and did the runs time out?")
+    for w, s in sorted(stats.items()):
+        mean = s["busy"] / s["execs"] if s["execs"] else 0.0
+        worker_rate = s["execs"] / elapsed if elapsed > 0 else 0.0
+        print(f"  worker {w}: {s['execs']} execs, {worker_rate:.2f} exec/s, "
+              f"mean {mean:.2f}s per run, {s['findings']} finding(s)")
+
+
+def run(workers, iterations=None, duration=None, seed=None, coverage=False, corpus_dir=CORPUS_DIR,
+        inputs_file=None, persistent=False, icount=None, icount_align=False, on_finding=None):
+    """
+    One fuzz run with the options of the command line, clearing the logs of
+    the last one first. Runs NUM_ITERATIONS if neither iterations nor
+    duration is given, and picks a random base seed if seed is None.
+    Returns the per worker statistics, the elapsed time and the base seed.
+    """
+    global TIMING_ARGS, TIMING_MODE
+    TIMING_ARGS = run_config.qemu_icount_args(icount, icount_align)
+    TIMING_MODE = run_config.timing_mode(icount, icount_align)
+
+    if iterations is None and duration is None:
+        iterations = NUM_ITERATIONS
+    if seed is None:
+        seed = random.randrange(2 ** 32)
 
     clear_old_logs()
 
-    for i in range(NUM_ITERATIONS):
-        time.sleep(1)  # small delay between runs
-        fuzz_once(i)
+    os.makedirs(TEST_ARTIFACTS_DIR, exist_ok=True)
+    run_config.write(os.path.join(TEST_ARTIFACTS_DIR, run_config.RUN_CONFIG_FILE),
+                     FIRMWARE_PATH, qemu_base_cmd(), icount, icount_align,
+                     base_seed=seed, workers=workers, coverage=coverage,
+                     persistent=persistent, inputs=inputs_file)
+
+    corpus = None
+    if coverage:
+        corpus = fuzz_corpus.Corpus(corpus_dir)
+        print(f"Coverage guided, {corpus.load()} corpus entries in {corpus_dir}.")
+
+    inputs = None
+    if inputs_file:
+        inputs = load_inputs(inputs_file)
+        print(f"{len(inputs)} pre-generated packets from {inputs_file}.")
+
+    mode = "persistent " if persistent else ""
+    print(f"Fuzzing with {workers} {mode}workers, base seed {seed}, {TIMING_MODE}.")
+    stats, elapsed = run_pool(max(1, workers), iterations, duration, seed, corpus,
+                              persistent, inputs, on_finding)
+    print_summary(stats, elapsed, seed, corpus)
 
     print("Fuzz testing complete. Check test_artifacts/ for logs or anomalies.")
+    return stats, elapsed, seed
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Fuzz the firmware under QEMU.")
+    parser.add_argument("-w", "--workers", type=int, default=os.cpu_count() or 1,
+                        help="QEMU instances to run at once (default: one per CPU)")
+    limit = parser.add_mutually_exclusive_group()
+    limit.add_argument("-n", "--iterations", type=int, default=None,
+                       help=f"total runs across all workers (default: {NUM_ITERATIONS})")
+    limit.add_argument("-d", "--duration", type=float, default=None,
+                       help="fuzz for this many seconds instead of a fixed number of runs")
+    parser.add_argument("-s", "--seed", type=int, default=None,
+                        help="base seed; worker n uses seed + n (default: random)")
+    source = parser.add_mutually_exclusive_group()
+    source.add_argument("-c", "--coverage", action="store_true",
+                        help="mutate inputs from a coverage guided corpus (needs make COVERAGE=1)")
+    source.add_argument("-i", "--inputs", default=None,
+                        help="take the packets from a file pre-generated by mqtt_gen.py")
+    parser.add_argument("--corpus", default=CORPUS_DIR,
+                        help=f"corpus directory for --coverage (default: {CORPUS_DIR})")
+    parser.add_argument("-p", "--persistent", action="store_true",
+                        help="restore a snapshot per input instead of booting (needs make PERSISTENT=1)")
+    run_config.add_arguments(parser)
+    args = parser.parse_args()
+
+    build_firmware_if_needed()
+
+    run(args.workers, args.iterations, args.duration, args.seed, args.coverage, args.corpus,
+        args.inputs, args.persistent, args.icount, args.icount_align)
 
 if __name__ == "__main__":
     main()
@@ -4,32 +4,82 @@
 Step 6: Automated (or Manual) Refinement via the LLM (GPT-4)
 ------------------------------------------------------------
 This script:
- 1. Reads the "analysis_report.json" from Step 5.
- 2. For each discovered vulnerability, prompts GPT-4 for a recommended fix.
- 3. Prints or stores suggested patches. 
- 4. Optionally applies each suggestion automatically to the target C file (e.g. main.c).
+ 1. Reads the "analysis_report.jsonl" from Step 5.
+ 2. Resolves each finding, a line of a QEMU log, to the source file and line
+    it names ("file.c:123" or "line 123, file file.c"), or for the messages in
+    MAIN_C_HANDLERS to the code in main.c that reports them. Other findings,
+    such as a hard fault, are listed without asking for a fix. The findings
+    are grouped by code region of those sources: findings whose context lines
+    overlap share one region, and so one request.
+ 3. Prompts GPT-4 for a recommended fix of each region, up to MAX_IN_FLIGHT
+    requests at a time, retrying with exponential backoff when the API is
+    busy or fails. Responses are cached in LLM_CACHE, keyed by the hash of the
+    snippet and the CWEs, so a region that has not changed is not sent again.
+ 4. Prints or stores suggested patches. 
+ 5. Optionally applies the suggestions automatically to the source files.
     - This is a naive approach: we parse a code block from the LLM's text and replace
       the old snippet with the new snippet. Adjust it for your real environment as needed.
+    - All the patches to a file are applied in one pass, with one backup.
+ 6. find_regions(), suggest_fix() and apply_patches() are also used by
+    pipeline.py, which asks for the fixes of each batch of findings as soon
+    as it is reported.
 
 Usage:
   1. Set your OPENAI_API_KEY environment variable:
        export OPENAI_API_KEY="sk-..."
   2. Run:
-       python3 llm_refine.py
+       python3 llm_refine.py [--jobs N] [--no-cache]
   3. Manually review the suggestions or (with caution) rely on automatic patching.
 """
 
+import argparse
+import concurrent.futures
+import hashlib
 import os
 import json
 import openai   # pip install openai
+import random
 import re
+import threading
+import time
+
+import analysis_cache
 
 # Path to the analysis report from Step 5
-ANALYSIS_REPORT = "test_artifacts/analysis_report.json"
+ANALYSIS_REPORT = "test_artifacts/analysis_report.jsonl"
 
 # Path to main.c (adjust if located elsewhere)
 MAIN_C_PATH = "../main.c"
 
+# Where the files named by a finding are looked for, in order.
+SOURCE_DIRS = (
+    os.path.dirname(MAIN_C_PATH),
+    os.path.join(os.path.dirname(MAIN_C_PATH), "TraceRecorderStreamPort", "UART"),
+    os.path.join(os.path.dirname(MAIN_C_PATH), "TraceRecorderConfig"),
+)
+
+# Findings that name no source file, by a regex on their lowercased log line,
+# and the line of main.c that reports them, by a regex on the source.
+_DEADLINE = r"(?:missed deadline|deadline missed)"
+MAIN_C_HANDLERS = (
+    (rf"sensortask.*{_DEADLINE}|{_DEADLINE}.*sensortask", r"if \(elapsedUs > mainSENSOR_DEADLINE_US\)"),
+    (rf"nettask.*{_DEADLINE}|{_DEADLINE}.*nettask", r"if \(elapsedUs > mainNET_DEADLINE_US\)"),
+    (r"stack overflow", r'printf\( "[^"]*Stack overflow in'),
+    (r"malloc failed", r'printf\( "[^"]*Malloc failed'),
+)
+
+# Lines of context around each finding. Findings whose context overlaps are
+# sent in one request.
+CONTEXT_LINES = 5
+
+# Requests in flight at once, and how often a failed request is retried.
+MAX_IN_FLIGHT = 8
+MAX_RETRIES = 5
+BACKOFF_BASE = 1.0   # seconds, doubled on each retry
+
+# Responses of earlier runs, keyed by snippet and CWEs.
+LLM_CACHE = "test_artifacts/llm_cache.json"
+
 
 # Choose your model (if you have GPT-4 access):
 MODEL_NAME = "gpt-4"
@@ -50,37 +100,82 @@ def load_analysis_report(report_path):
     if not os.path.isfile(report_path):
         print(f"No analysis report found at: {report_path}")
         return []
+    # JSON Lines, one finding per line.
     with open(report_path, "r", encoding="utf-8") as f:
-        data = json.load(f)
+        data = [json.loads(line) for line in f if line.strip()]
     return data
 
-def read_code_snippet(filepath, line_num, context=5):
+def find_handler(line_text):
     """
-    Reads 'context' lines before and after 'line_num' to give the LLM
-    some surrounding code to see.
+    The line of main.c that reports line_text, see MAIN_C_HANDLERS, or None.
     """
-    if not os.path.isfile(filepath):
+    line_lower = line_text.lower()
+    for log_re, source_re in MAIN_C_HANDLERS:
+        if not re.search(log_re, line_lower):
+            continue
+        try:
+            with open(MAIN_C_PATH, "r", encoding="utf-8", errors="ignore") as f:
+                for number, line in enumerate(f, 1):
+                    if re.search(source_re, line):
+                        return number
+        except OSError:
+            pass
         return None
+    return None
 
-    with open(filepath, "r", encoding="utf-8", errors="ignore") as f:
-        lines = f.readlines()
-
-    start_line = max(0, line_num - context - 1)
-    end_line = min(len(lines), line_num + context)
-    snippet = lines[start_line:end_line]
-    return snippet
+def resolve_source(v):
+    """
+    The finding v with "file" and "line" of the source it names, see
+    analysis_cache.source_location(), or of its handler in main.c, see
+    find_handler(), and the log it was found in as "log" and "log_line".
+    None when neither can be found.
+    """
+    location = analysis_cache.source_location(v["line_text"])
+    if location:
+        name, line = location.rsplit(":", 1)
+        for source_dir in SOURCE_DIRS:
+            path = os.path.join(source_dir, name)
+            if os.path.isfile(path):
+                return dict(v, log=v["file"], log_line=v["line"], file=path, line=int(line))
+    line = find_handler(v["line_text"])
+    if line is not None:
+        return dict(v, log=v["file"], log_line=v["line"], file=MAIN_C_PATH, line=line)
+    return None
 
-def prompt_llm_for_fix(snippet, cwe_info, line_text):
+def group_into_regions(vulns, lines, context=CONTEXT_LINES):
+    """
+    Groups the findings of one file into regions of whole lines, merging
+    findings whose context lines overlap. Returns a list of dicts with the
+    0-based start and end (exclusive) line, the snippet and the findings.
+    """
+    regions = []
+    for v in sorted(vulns, key=lambda x: x["line"]):
+        start = max(0, v["line"] - context - 1)
+        end = min(len(lines), v["line"] + context)
+        if regions and start <= regions[-1]["end"]:
+            regions[-1]["end"] = max(regions[-1]["end"], end)
+            regions[-1]["vulns"].append(v)
+        else:
+            regions.append({"start": start, "end": end, "vulns": [v]})
+    for r in regions:
+        r["snippet"] = lines[r["start"]:r["end"]]
+    return regions
+
+def read_main_c():
     """
-    Optionally reads the entire main.c file for broader context, then
-    appends that to the LLM prompt.
+    Reads the entire main.c once, for the context of every prompt.
     """
-    main_c_content = ""
     if os.path.isfile(MAIN_C_PATH):
         # Read the entire main.c for reference (you can limit how many lines you add if needed).
         with open(MAIN_C_PATH, "r", encoding="utf-8", errors="ignore") as mf:
-            main_c_content = mf.read()
+            return mf.read()
+    return ""
 
+def build_prompt(snippet, vulns, main_c_content):
+    """
+    One prompt for all the findings in a region, with main.c appended for
+    broader context.
+    """
     # Conditionally add main.c content to the prompt.
     # If main.c is large, consider limiting how many lines you include here.
     if main_c_content:
@@ -88,35 +183,109 @@ def prompt_llm_for_fix(snippet, cwe_info, line_text):
     else:
         additional_context = ""
 
-    prompt = f"""
+    findings = "\n".join(f'- line {v["line"]}: {v["threat"]} ({v["cwe"]}), triggered by "{v["line_text"]}"'
+                         for v in vulns)
+
+    return f"""
 You are a helpful AI that fixes security flaws in embedded C code.
 
-We found the following vulnerability: {cwe_info}
+We found the following vulnerabilities in one region of the code:
+{findings}
 
-Here is a snippet of the code around the vulnerable line:
+Here is the code of that region:
 ------------------------------------------------------
 {snippet}
 ------------------------------------------------------
 
-The line triggering this vulnerability or error was: 
-"{line_text}"
-
-Please suggest a revised snippet or patch to fix or mitigate this issue,
- while preserving the original logic as much as possible.
+Please suggest a revised snippet or patch for the whole region that fixes or
+ mitigates these issues, while preserving the original logic as much as possible.
  Explain your changes briefly at the end.
  """ + additional_context
 
-    response = openai.ChatCompletion.create(
-        model=MODEL_NAME,
-        messages=[
-            {"role": "system", "content": "You are a helpful C programming assistant."},
-            {"role": "user", "content": prompt}
-        ],
-        temperature=0.3,
-        max_tokens=700
-    )
+def prompt_llm_for_fix(prompt):
+    """
+    Sends one prompt, retrying with exponential backoff and jitter when the
+    API is rate limited or fails.
+    """
+    retryable = tuple(getattr(openai.error, name) for name in
+                      ("RateLimitError", "APIError", "Timeout", "APIConnectionError",
+                       "ServiceUnavailableError") if hasattr(openai.error, name))
+    for attempt in range(MAX_RETRIES + 1):
+        try:
+            response = openai.ChatCompletion.create(
+                model=MODEL_NAME,
+                messages=[
+                    {"role": "system", "content": "You are a helpful C programming assistant."},
+                    {"role": "user", "content": prompt}
+                ],
+                temperature=0.3,
+                max_tokens=700
+            )
+            return response.choices[0].message.content
+        except retryable as e:
+            if attempt == MAX_RETRIES:
+                raise
+            delay = BACKOFF_BASE * (2 ** attempt) * (1 + random.random())
+            print(f"Request failed ({type(e).__name__}), retrying in {delay:.1f}s")
+            time.sleep(delay)
+
+class ResponseCache:
+    """
+    LLM responses keyed by (snippet hash, CWEs), shared by the request threads.
+    """
 
-    return response.choices[0].message.content
+    def __init__(self, path):
+        self.path = path
+        self.lock = threading.Lock()
+        self.entries = {}
+        self.hits = 0
+        if path and os.path.isfile(path):
+            try:
+                with open(path, "r", encoding="utf-8") as f:
+                    self.entries = json.load(f)
+            except ValueError:
+                pass
+
+    @staticmethod
+    def key(snippet, vulns):
+        cwes = "|".join(sorted({v["cwe"] for v in vulns}))
+        return hashlib.sha256((snippet + "\0" + cwes).encode("utf-8", errors="ignore")).hexdigest()
+
+    def get(self, key):
+        with self.lock:
+            value = self.entries.get(key)
+            if value is not None:
+                self.hits += 1
+            return value
+
+    def put(self, key, value):
+        with self.lock:
+            self.entries[key] = value
+
+    def save(self):
+        if not self.path:
+            return
+        os.makedirs(os.path.dirname(self.path) or ".", exist_ok=True)
+        with self.lock:
+            tmp = self.path + ".tmp"
+            with open(tmp, "w", encoding="utf-8") as f:
+                json.dump(self.entries, f)
+            os.replace(tmp, self.path)
+
+def suggest_fix(region, main_c_content, cache):
+    """
+    The LLM suggestion for a region, from the cache if it was asked before.
+    main.c is left out of the prompt when the region is in it.
+    """
+    snippet = "".join(region["snippet"])
+    key = ResponseCache.key(snippet, region["vulns"])
+    suggestion = cache.get(key)
+    if suggestion is None:
+        if os.path.abspath(region["file"]) == os.path.abspath(MAIN_C_PATH):
+            main_c_content = ""
+        suggestion = prompt_llm_for_fix(build_prompt(snippet, region["vulns"], main_c_content))
+        cache.put(key, suggestion)
+    return suggestion
 
 def extract_code_block(suggestion_text):
     """
@@ -130,23 +299,33 @@ def extract_code_block(suggestion_text):
         return match.group(1).strip()
     return None
 
-def apply_patch_to_file(file_path, old_snippet, new_snippet):
+def apply_patches_to_file(file_path, patches):
     """
-    Another naive approach:
+    Another naive approach, for all the patches to one file at once:
       1. Read entire file.
-      2. Find the old snippet as a contiguous string. (If it’s not contiguous, this may fail.)
-      3. Replace it with the new snippet.
-      4. Overwrite the file with the new content.
+      2. Check that each region still holds the snippet that was sent.
+      3. Replace the regions with the new snippets, last first so the line
+         numbers of the others stay valid.
+      4. Overwrite the file with the new content, once.
+    patches is a list of (region, new_snippet). Returns how many were applied.
     """
     with open(file_path, "r", encoding="utf-8", errors="ignore") as f:
         original_content = f.read()
+    lines = original_content.splitlines(keepends=True)
 
-    patched_content = original_content.replace("".join(old_snippet), new_snippet)
+    applied = 0
+    for region, new_snippet in sorted(patches, key=lambda p: p[0]["start"], reverse=True):
+        if lines[region["start"]:region["end"]] != region["snippet"]:
+            print(f"WARNING: Could not apply patch to lines {region['start'] + 1}-{region['end']} "
+                  "automatically (old snippet not found or mismatch).")
+            continue
+        if not new_snippet.endswith("\n"):
+            new_snippet += "\n"
+        lines[region["start"]:region["end"]] = [new_snippet]
+        applied += 1
 
-    if patched_content == original_content:
-        print("WARNING: Could not apply patch automatically "
-              "(old snippet not found or mismatch).")
-        return
+    if not applied:
+        return 0
 
     backup_path = file_path + ".bak"
     with open(backup_path, "w", encoding="utf-8", errors="ignore") as backup_f:
@@ -154,54 +333,111 @@ def apply_patch_to_file(file_path, old_snippet, new_snippet):
     print(f"Backup of original file created: {backup_path}")
 
     with open(file_path, "w", encoding="utf-8", errors="ignore") as f:
-        f.write(patched_content)
-    print(f"Patched file saved: {file_path}")
+        f.write("".join(lines))
+    print(f"Patched file saved: {file_path} ({applied} of {len(patches)} patches)")
+    return applied
 
-def main():
-    vulnerabilities = load_analysis_report(ANALYSIS_REPORT)
-    if not vulnerabilities:
-        print("No vulnerabilities found in analysis_report.json. Nothing to refine.")
-        return
-
-    # Group vulnerabilities by file so we can read code from that file
+def find_regions(vulnerabilities):
+    """
+    The regions of all the source files the findings are in, see
+    resolve_source() and group_into_regions(), each with its "file".
+    Findings with no source to patch are listed, and left out.
+    """
+    # Group vulnerabilities by source file so we can read code from that file
     vulns_by_file = {}
-    for v in vulnerabilities:
-        file_full_path = v["file"]  # Expecting absolute or full relative path
+    for finding in vulnerabilities:
+        v = resolve_source(finding)
+        if v is None:
+            print(f"No source location for '{finding['line_text']}' ({finding['file']}:{finding['line']}), "
+                  "reported without a fix.")
+            continue
+        file_full_path = v["file"]
         if file_full_path not in vulns_by_file:
             vulns_by_file[file_full_path] = []
         vulns_by_file[file_full_path].append(v)
 
+    # Then by region within each file
+    regions = []
     for full_path, vulns in vulns_by_file.items():
         if not os.path.isfile(full_path):
             print(f"Skipping {full_path}, can't find actual path in filesystem.")
             continue
+        with open(full_path, "r", encoding="utf-8", errors="ignore") as f:
+            lines = f.read().splitlines(keepends=True)
+        for region in group_into_regions(vulns, lines):
+            region["file"] = full_path
+            regions.append(region)
+    return regions
+
+def apply_patches(regions, suggestions):
+    """
+    Prints the suggestion for each region, by index in regions, and applies
+    the code blocks they hold. Returns the files patched.
+    """
+    # Print in file and line order, and collect the patches of each file
+    patches_by_file = {}
+    for i, region in enumerate(regions):
+        if i not in suggestions:
+            continue
+        print(f"\n=== {region['file']} lines {region['start'] + 1}-{region['end']} ===")
+        for v in region["vulns"]:
+            print(f"Vulnerability at line {v['line']} ({v['log']}:{v['log_line']}), "
+                  f"keyword='{v['keyword']}' => {v['threat']} ({v['cwe']})")
+        print("\n--- LLM Fix Suggestion ---")
+        print(suggestions[i])
+        print("--- End of Suggestion ---\n")
+
+        suggested_code = extract_code_block(suggestions[i])
+        if suggested_code:
+            patches_by_file.setdefault(region["file"], []).append((region, suggested_code))
+        else:
+            print("No clear code block found in the suggestion. Skipping auto-patch.")
+
+    patched = []
+    for full_path, patches in patches_by_file.items():
+        print(f"Attempting to apply {len(patches)} patches to {full_path}")
+        if apply_patches_to_file(full_path, patches):
+            patched.append(full_path)
+    return patched
+
+def main():
+    parser = argparse.ArgumentParser(description="Ask the LLM to fix the reported findings.")
+    parser.add_argument("-j", "--jobs", type=int, default=MAX_IN_FLIGHT,
+                        help="requests in flight at once (default: %(default)s)")
+    parser.add_argument("--no-cache", action="store_true",
+                        help="ask again even for regions answered before")
+    args = parser.parse_args()
+
+    vulnerabilities = load_analysis_report(ANALYSIS_REPORT)
+    if not vulnerabilities:
+        print("No vulnerabilities found in analysis_report.jsonl. Nothing to refine.")
+        return
 
-        print(f"\n=== Processing vulnerabilities in {full_path} ===")
-
-        sorted_vulns = sorted(vulns, key=lambda x: x["line"])
-        for v in sorted_vulns:
-            line_num = v["line"]
-            snippet = read_code_snippet(full_path, line_num, context=5)
-            if snippet is None:
-                print(f"Cannot read snippet from {full_path}")
-                continue
-
-            cwe_info = f"{v['threat']} ({v['cwe']})"
-            line_text = v['line_text']
-
-            print(f"\nVulnerability at line {line_num}, keyword='{v['keyword']}' => {cwe_info}")
-            suggestion = prompt_llm_for_fix("".join(snippet), cwe_info, line_text)
-            print("\n--- LLM Fix Suggestion ---")
-            print(suggestion)
-            print("--- End of Suggestion ---\n")
-
-            suggested_code = extract_code_block(suggestion)
-            if suggested_code:
-                print("Attempting to apply the following code patch to file:")
-                print(suggested_code)
-                apply_patch_to_file(full_path, snippet, suggested_code)
-            else:
-                print("No clear code block found in the suggestion. Skipping auto-patch.")
+    regions = find_regions(vulnerabilities)
+    print(f"{len(vulnerabilities)} findings in {len(regions)} regions, "
+          f"up to {args.jobs} requests at a time.")
+
+    main_c_content = read_main_c()
+    cache = ResponseCache(None if args.no_cache else LLM_CACHE)
+    start = time.monotonic()
+    suggestions = {}
+    try:
+        with concurrent.futures.ThreadPoolExecutor(max_workers=max(1, args.jobs)) as pool:
+            futures = {pool.submit(suggest_fix, r, main_c_content, cache): i
+                       for i, r in enumerate(regions)}
+            for future in concurrent.futures.as_completed(futures):
+                i = futures[future]
+                try:
+                    suggestions[i] = future.result()
+                except Exception as e:
+                    r = regions[i]
+                    print(f"Request for {r['file']} lines {r['start'] + 1}-{r['end']} failed: {e}")
+    finally:
+        cache.save()
+    print(f"{len(suggestions)} suggestions in {time.monotonic() - start:.1f}s, "
+          f"{cache.hits} from the cache.")
+
+    apply_patches(regions, suggestions)
 
 if __name__ == "__main__":
     main()
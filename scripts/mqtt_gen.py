@@ -0,0 +1,247 @@
+#!/usr/bin/env python3
+
+"""
+Structure aware MQTT 3.1.1 packet generator for the fuzz harness.
+
+Random bytes almost never start with a valid fixed header, so the firmware's
+MQTT decoder (MqttDecoder.h) rejects nearly every one of them at the first
+byte. The generator instead builds packets of all 14 control packet types
+from the grammar - fixed header flags, packet identifiers, length prefixed
+strings, CONNECT flags and fields, SUBSCRIBE topic filters and so on - and
+then breaks a share of them on purpose:
+  - a Remaining Length at the edges of the varint sizes, encoded with more
+    bytes than needed, or running past the 4 bytes allowed
+  - a body cut short of its Remaining Length, or with bytes past it
+  - reserved fixed header flags, QoS 3, or the reserved types 0 and 15
+  - string lengths that do not match their data
+
+Random bytes come from one block drawn with Random.randbytes() and sliced,
+rather than from a randint() call per byte. A seeded random.Random keeps the
+output reproducible; os.urandom() would be as fast but cannot be seeded.
+
+As a module (fuzz_test.py):
+  gen = MqttGenerator(random.Random(seed))
+  packets = gen.packets(16)
+
+As a script, to pre-generate a corpus file of framed packets (UARTPacketRx.h)
+that fuzz_test.py --inputs reads:
+  python3 mqtt_gen.py -n 100000 -o test_artifacts/mqtt_inputs.bin [--seed S]
+                      [--anomaly-rate R] [--stats]
+"""
+
+import argparse
+import random
+import struct
+import sys
+import time
+
+from fuzz_corpus import INTERESTING_LENGTHS, MAX_PACKET_SIZE, encode_remaining_length, frame_packets
+
+# Default share of packets broken on purpose.
+ANOMALY_RATE = 0.25
+
+# Bytes drawn from the generator per refill of the random block.
+_BLOCK_SIZE = 1 << 16
+
+_TOPICS = (b"a/b", b"sensors/temp", b"$SYS/broker", b"", b"/", b"a//b", b"x" * 100)
+_FILTERS = (b"#", b"+", b"a/+/c", b"a/#", b"+/+", b"sensors/#", b"#/a", b"a+")
+_PROTOCOLS = ((b"MQTT", 4), (b"MQIsdp", 3), (b"MQTT", 5), (b"XXXX", 4))
+
+# Fixed header flags each type requires (MQTT 3.1.1 table 2.2). PUBLISH has
+# its own, and those not listed must be 0.
+_REQUIRED_FLAGS = {6: 0x2, 8: 0x2, 10: 0x2}
+
+
+class _RandomBytes:
+    """
+    Hands out slices of a block of random bytes, refilled as needed.
+    """
+
+    def __init__(self, rng):
+        self.rng = rng
+        self.block = b""
+        self.pos = 0
+
+    def take(self, n):
+        if self.pos + n > len(self.block):
+            self.block = self.rng.randbytes(max(_BLOCK_SIZE, n))
+            self.pos = 0
+        out = self.block[self.pos:self.pos + n]
+        self.pos += n
+        return out
+
+
+class MqttGenerator:
+    """
+    Generates MQTT packets, with anomaly_rate of them broken on purpose.
+    """
+
+    def __init__(self, rng=None, anomaly_rate=ANOMALY_RATE, max_size=MAX_PACKET_SIZE):
+        self.rng = rng if rng is not None else random.Random()
+        self.anomaly_rate = anomaly_rate
+        self.max_size = max_size
+        self.random_bytes = _RandomBytes(self.rng)
+        self.builders = (
+            None,
+            self._connect, self._connack, self._publish, self._packet_id,
+            self._packet_id, self._packet_id, self._packet_id, self._subscribe,
+            self._suback, self._unsubscribe, self._packet_id, self._empty,
+            self._empty, self._empty,
+        )
+
+    # Packets
+
+    def packet(self, packet_type=None):
+        """
+        One packet of packet_type (1 to 14), or of a random type.
+        """
+        rng = self.rng
+        if packet_type is None:
+            packet_type = rng.randint(1, 14)
+        flags, body = self.builders[packet_type](packet_type)
+
+        if rng.random() >= self.anomaly_rate:
+            return bytes([(packet_type << 4) | flags]) + encode_remaining_length(len(body)) + body
+
+        length = len(body)
+        encoded = None
+        anomaly = rng.randrange(6)
+        if anomaly == 0:
+            length = rng.choice(INTERESTING_LENGTHS)
+        elif anomaly == 1:
+            # Non-minimal, or five bytes long, which the decoder must reject.
+            encoded = encode_remaining_length(length, minimal=False) if rng.random() < 0.5 \
+                else bytes([0xFF, 0xFF, 0xFF, 0xFF, 0x7F])
+        elif anomaly == 2:
+            body = body[:rng.randrange(len(body) + 1)]
+        elif anomaly == 3:
+            body += self.random_bytes.take(rng.randint(1, 16))
+        elif anomaly == 4:
+            flags = rng.randrange(16) if packet_type != 3 else flags | 0x6  # QoS 3
+        else:
+            packet_type = rng.choice((0, 15))
+        if encoded is None:
+            encoded = encode_remaining_length(length)
+        return bytes([(packet_type << 4) | flags]) + encoded + body
+
+    def packets(self, count):
+        return [self.packet() for _ in range(count)]
+
+    # Bodies, as (fixed header flags, variable header + payload)
+
+    def _string(self, data):
+        """
+        A length prefixed string, whose length is now and then wrong.
+        """
+        length = len(data)
+        if self.rng.random() < self.anomaly_rate / 8:
+            length = max(0, length + self.rng.choice((-2, -1, 1, 2, 0x100, 0xFFFF))) & 0xFFFF
+        return struct.pack(">H", length) + data
+
+    def _payload(self, limit):
+        """
+        Random bytes, usually few, capped so the packet fits a receive slot.
+        """
+        size = min(int(self.rng.expovariate(1.0 / 24)), max(0, limit))
+        return self.random_bytes.take(size)
+
+    def _topic(self):
+        rng = self.rng
+        if rng.random() < 0.7:
+            return rng.choice(_TOPICS)
+        return self.random_bytes.take(rng.randint(0, 32))
+
+    def _packet_id(self, packet_type):
+        # PUBACK to PUBCOMP and UNSUBACK: just the packet identifier, 0 being
+        # invalid.
+        packet_id = self.rng.choice((0, 1, 0xFFFF, self.rng.getrandbits(16)))
+        return _REQUIRED_FLAGS.get(packet_type, 0), struct.pack(">H", packet_id)
+
+    def _empty(self, packet_type):
+        # PINGREQ, PINGRESP, DISCONNECT
+        return 0, b""
+
+    def _connect(self, packet_type):
+        rng = self.rng
+        name, level = rng.choice(_PROTOCOLS) if rng.random() < 0.3 else _PROTOCOLS[0]
+        username = rng.random() < 0.3
+        password = rng.random() < 0.3
+        will = rng.random() < 0.3
+        connect_flags = (username << 7) | (password << 6) | (will << 2) | (rng.random() < 0.7) << 1
+        if will:
+            connect_flags |= rng.randrange(3) << 3 | (rng.random() < 0.5) << 5
+        if rng.random() < 0.05:
+            connect_flags |= 0x01  # reserved
+        body = self._string(name) + bytes([level, connect_flags]) + struct.pack(">H", rng.getrandbits(16))
+        body += self._string(self.random_bytes.take(rng.randint(0, 23)))  # client identifier
+        if will:
+            body += self._string(self._topic()) + self._string(self._payload(64))
+        if username:
+            body += self._string(self.random_bytes.take(rng.randint(0, 16)))
+        if password:
+            body += self._string(self.random_bytes.take(rng.randint(0, 16)))
+        return 0, body
+
+    def _connack(self, packet_type):
+        rng = self.rng
+        return 0, bytes([rng.choice((0, 0, 1, 0xFE)), rng.choice((0, 0, 1, 2, 3, 4, 5, 6))])
+
+    def _publish(self, packet_type):
+        rng = self.rng
+        qos = rng.choice((0, 0, 1, 2))
+        flags = (qos << 1) | (rng.random() < 0.1) << 3 | (rng.random() < 0.2)
+        body = self._string(self._topic())
+        if qos:
+            body += struct.pack(">H", rng.getrandbits(16))
+        return flags, body + self._payload(self.max_size - 5 - len(body))
+
+    def _subscribe(self, packet_type):
+        rng = self.rng
+        body = struct.pack(">H", rng.getrandbits(16))
+        for _ in range(rng.choice((0, 1, 1, 2, 4))):  # none is a protocol error
+            body += self._string(rng.choice(_FILTERS) if rng.random() < 0.7 else self._topic())
+            body += bytes([rng.choice((0, 1, 2, 3))])
+        return _REQUIRED_FLAGS[packet_type], body
+
+    def _suback(self, packet_type):
+        rng = self.rng
+        codes = bytes(rng.choice((0, 1, 2, 0x80, 0x03)) for _ in range(rng.randint(1, 4)))
+        return 0, struct.pack(">H", rng.getrandbits(16)) + codes
+
+    def _unsubscribe(self, packet_type):
+        rng = self.rng
+        body = struct.pack(">H", rng.getrandbits(16))
+        for _ in range(rng.choice((0, 1, 1, 2))):
+            body += self._string(rng.choice(_FILTERS))
+        return _REQUIRED_FLAGS[packet_type], body
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pre-generate framed MQTT packets for fuzzing.")
+    parser.add_argument("-n", "--count", type=int, default=10000, help="packets to generate")
+    parser.add_argument("-o", "--output", default="-", help="output file (default: stdout)")
+    parser.add_argument("-s", "--seed", type=int, default=None)
+    parser.add_argument("-a", "--anomaly-rate", type=float, default=ANOMALY_RATE,
+                        help=f"share of packets broken on purpose (default: {ANOMALY_RATE})")
+    parser.add_argument("--stats", action="store_true", help="report the generation rate on stderr")
+    args = parser.parse_args()
+
+    gen = MqttGenerator(random.Random(args.seed), args.anomaly_rate)
+    start = time.monotonic()
+    stream = frame_packets(gen.packets(args.count))
+    elapsed = time.monotonic() - start
+
+    if args.output == "-":
+        sys.stdout.buffer.write(stream)
+    else:
+        with open(args.output, "wb") as f:
+            f.write(stream)
+
+    if args.stats:
+        rate = args.count / elapsed if elapsed > 0 else 0.0
+        print(f"{args.count} packets, {len(stream)} bytes in {elapsed:.2f}s ({rate:.0f} packets/s)",
+              file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
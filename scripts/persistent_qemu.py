@@ -0,0 +1,271 @@
+#!/usr/bin/env python3
+
+"""
+Persistent QEMU instance for fuzzing without a boot per input (fuzz_test.py --persistent).
+
+The firmware has to be built with "make PERSISTENT=1" (see Verdict.h). It then
+prints "READY FOR INPUT" once NetTask waits for packets and waits, with
+interrupts masked, for the first byte of input. At the end of an input it
+prints its "VERDICT: ... (status)" line and halts instead of exiting, reading
+and dropping the rest of the input.
+
+QEMU is started once with a monitor on a Unix socket and a small qcow2 image
+to hold the snapshot (savevm needs one, even though the board has no disk).
+When the marker arrives the instance stops the VM, where the firmware waits
+for input, and saves the "ready" snapshot. Each run() then restores it with
+the VM stopped, sends the input on UART0, continues the VM and reads the
+console until the verdict line. Only the packet handling runs per input, not
+the boot, and every input starts from the same state.
+
+Input the firmware had not read by its verdict is still in the pipe to QEMU,
+and would reach the restored firmware ahead of the next input. After the
+verdict run() waits for the halted firmware to drop it, and records how many
+bytes were left in unread_bytes. If they cannot be dropped, as after a
+timeout, the instance boots again on the next run(), as it does when QEMU
+exits (firmware built without PERSISTENT=1 exits on a failure).
+
+Usage (smoke test, runs the same input a few times):
+  python3 persistent_qemu.py output/secure/RTOSDemo.out input.bin [-n RUNS]
+"""
+
+import argparse
+import array
+import fcntl
+import os
+import re
+import select
+import socket
+import subprocess
+import termios
+import time
+
+READY_MARKER = b"READY FOR INPUT"
+SNAPSHOT = "ready"
+
+# Longest the boot may take to reach the marker.
+BOOT_TIMEOUT = 30.0
+
+# Longest the halted firmware may take to read and drop the rest of an input.
+DRAIN_TIMEOUT = 1.0
+
+# "VERDICT: <name> [detail] (<status>)" printed by vVerdictExit().
+_VERDICT_LINE = re.compile(rb"VERDICT: [^\r\n]*\((\d+)\)\r?\n")
+
+_MONITOR_PROMPT = b"(qemu) "
+
+
+class PersistentQemu:
+    """
+    One QEMU process, restored to the ready snapshot before every input.
+    qemu_cmd is the command line without -monitor, -serial or -drive options;
+    the console (UART0) goes to a pipe and the trace port (UART1) is discarded,
+    as the trace of a restored run would not be coherent.
+    """
+
+    def __init__(self, qemu_cmd, work_dir):
+        self.qemu_cmd = list(qemu_cmd)
+        self.work_dir = os.path.abspath(work_dir)
+        self.image = os.path.join(self.work_dir, "snapshot.qcow2")
+        self.monitor_path = os.path.join(self.work_dir, "monitor.sock")
+        self.proc = None
+        self.monitor = None
+        self.boots = 0
+        self.restores = 0
+        # Input bytes not read by the firmware before its verdict, in the last
+        # run() and in all of them.
+        self.unread_bytes = 0
+        self.total_unread_bytes = 0
+        self._at_snapshot = False
+
+    # Process management
+
+    def start(self):
+        """
+        Boots QEMU and saves the snapshot once the firmware is ready.
+        """
+        self.stop()
+        os.makedirs(self.work_dir, exist_ok=True)
+        if os.path.exists(self.monitor_path):
+            os.remove(self.monitor_path)
+        subprocess.run(["qemu-img", "create", "-q", "-f", "qcow2", self.image, "1M"], check=True)
+
+        cmd = self.qemu_cmd + [
+            "-drive", f"if=none,format=qcow2,file={self.image}",
+            "-monitor", f"unix:{self.monitor_path},server=on,wait=off",
+            "-serial", "stdio",   # UART0, the console and packet input
+            "-serial", "null",    # UART1, the trace stream
+        ]
+        self.proc = subprocess.Popen(cmd, cwd=self.work_dir, stdin=subprocess.PIPE,
+                                     stdout=subprocess.PIPE, stderr=subprocess.DEVNULL)
+        self.boots += 1
+
+        output = self._read_until(lambda buf: READY_MARKER in buf, BOOT_TIMEOUT)
+        if READY_MARKER not in output:
+            self.stop()
+            raise RuntimeError("firmware did not print the ready marker; "
+                               "was it built with PERSISTENT=1?")
+
+        self.monitor = self._connect_monitor()
+        # The firmware waits for input with interrupts masked, so the system
+        # is in the same state whenever the VM is stopped.
+        self._monitor_command("stop")
+        self._monitor_command(f"savevm {SNAPSHOT}")
+        self._at_snapshot = True
+
+    def stop(self):
+        if self.monitor is not None:
+            self.monitor.close()
+            self.monitor = None
+        if self.proc is not None:
+            if self.proc.poll() is None:
+                self.proc.kill()
+            self.proc.wait()
+            self.proc = None
+
+    def alive(self):
+        return self.proc is not None and self.proc.poll() is None
+
+    # One input
+
+    def run(self, fuzz_data, timeout):
+        """
+        Restores the snapshot, sends fuzz_data on UART0 and waits for the
+        verdict. Returns (status, output): the verdict status, the exit status
+        if QEMU exited, or None on a timeout, and the console bytes of this
+        input only.
+        """
+        if not self.alive():
+            self.start()
+        elif not self._at_snapshot:
+            # The VM stays stopped through the restore until the input is sent.
+            self._monitor_command("stop")
+            self._monitor_command(f"loadvm {SNAPSHOT}")
+            self.restores += 1
+            self._at_snapshot = True
+
+        # Output from before the restore belongs to the previous input.
+        self._drain()
+
+        try:
+            self.proc.stdin.write(fuzz_data)
+            self.proc.stdin.flush()
+        except BrokenPipeError:
+            pass
+        self._at_snapshot = False
+        self._monitor_command("cont")
+
+        output = self._read_until(lambda buf: _VERDICT_LINE.search(buf) is not None, timeout)
+        match = _VERDICT_LINE.search(output)
+        if not match and not self.alive():
+            returncode = self.proc.returncode
+            self.stop()
+            return returncode, output
+
+        # Without a verdict the firmware is still handling the input, and
+        # does not drop the rest of it.
+        self.unread_bytes = self._unread_input()
+        if self.unread_bytes and match:
+            deadline = time.monotonic() + DRAIN_TIMEOUT
+            while self._unread_input() and time.monotonic() < deadline:
+                time.sleep(0.001)
+        self.total_unread_bytes += self.unread_bytes
+        if self._unread_input():
+            self.stop()
+        return (int(match.group(1)) if match else None), output
+
+    # Helpers
+
+    def _read_until(self, done, timeout):
+        """
+        Reads the console until done(output) or the timeout, or QEMU exits.
+        """
+        fd = self.proc.stdout.fileno()
+        output = bytearray()
+        deadline = time.monotonic() + timeout
+        while not done(output):
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                break
+            ready, _, _ = select.select([fd], [], [], remaining)
+            if not ready:
+                break
+            chunk = os.read(fd, 65536)
+            if not chunk:
+                break
+            output += chunk
+        return bytes(output)
+
+    def _unread_input(self):
+        """
+        Bytes written to QEMU's stdin that it has not read yet.
+        """
+        count = array.array("i", [0])
+        fcntl.ioctl(self.proc.stdin.fileno(), termios.FIONREAD, count)
+        return count[0]
+
+    def _drain(self):
+        fd = self.proc.stdout.fileno()
+        while select.select([fd], [], [], 0)[0]:
+            if not os.read(fd, 65536):
+                break
+
+    def _connect_monitor(self):
+        deadline = time.monotonic() + 5.0
+        while True:
+            try:
+                sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+                sock.connect(self.monitor_path)
+                break
+            except (FileNotFoundError, ConnectionRefusedError):
+                sock.close()
+                if time.monotonic() > deadline:
+                    raise
+                time.sleep(0.05)
+        self.monitor = sock
+        self._monitor_read()
+        return sock
+
+    def _monitor_read(self):
+        reply = bytearray()
+        while not reply.endswith(_MONITOR_PROMPT):
+            chunk = self.monitor.recv(4096)
+            if not chunk:
+                raise RuntimeError("QEMU monitor closed")
+            reply += chunk
+        return reply.decode("latin-1")
+
+    def _monitor_command(self, command):
+        self.monitor.sendall(command.encode() + b"\n")
+        reply = self._monitor_read()
+        if "Error" in reply:
+            raise RuntimeError(f"QEMU monitor: {command}: {reply.strip()}")
+        return reply
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run one input repeatedly from a snapshot.")
+    parser.add_argument("kernel", help="firmware ELF built with PERSISTENT=1")
+    parser.add_argument("input", help="framed input, as fuzz_test.py writes them")
+    parser.add_argument("-n", "--runs", type=int, default=5)
+    parser.add_argument("-t", "--timeout", type=float, default=5.0)
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+
+    qemu = PersistentQemu(["qemu-system-arm", "-M", "mps2-an385", "-kernel", os.path.abspath(args.kernel),
+                           "-nographic", "-semihosting-config", "enable=on,target=native"],
+                          "persistent_qemu")
+    try:
+        for i in range(args.runs):
+            start = time.monotonic()
+            status, _ = qemu.run(data, args.timeout)
+            print(f"run {i}: status {status} in {time.monotonic() - start:.3f}s, "
+                  f"{qemu.unread_bytes} input bytes unread")
+    finally:
+        qemu.stop()
+    print(f"{qemu.boots} boot(s), {qemu.restores} restore(s)")
+
+
+if __name__ == "__main__":
+    main()
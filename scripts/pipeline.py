@@ -0,0 +1,437 @@
+#!/usr/bin/env python3
+
+"""
+Pipelined build, test and patch loop.
+
+Runs the steps of build_and_run.py, static_analysis.py, fuzz_test.py,
+analyze_results.py and llm_refine.py as the stages of one pipeline, each
+stage starting as soon as what it needs is ready instead of one script after
+the other:
+
+  1. build    - make APP=secure, with COVERAGE=1 or PERSISTENT=1 when fuzzing
+                with --coverage or --persistent.
+  2. static   - after build, cppcheck and the Clang Static Analyzer, on a
+                compilation database made with the same make variables, so it
+                describes the build being fuzzed and leaves it as it is.
+  3. fuzz     - after build, at the same time as static.
+  4. analyze  - after build, scans each crash log as soon as the fuzzer
+                collects it, and the static analysis logs once they are
+                written, into analysis_report.jsonl (analyze_results.Report).
+                The analysis cache passes on only findings not reported
+                before, and those reported by an earlier iteration of this
+                run, which survived its patch and are "still failing".
+  5. refine   - after build, sends the LLM requests for each batch of new
+                findings as it is reported, and applies the patches once
+                analysis is done (llm_refine.py).
+
+If refine patched a C source or header, the build of the next iteration
+starts straight away. The loop stops when there was nothing to patch, a
+stage failed, or after --iterations, and fails when there were findings but
+no source was patched. Each iteration fuzzes with the same base
+seed, so a patched build meets the inputs that found the problem.
+
+The start and end of every stage, relative to the start of the run, and what
+it did are saved to MANIFEST_FILE in test_artifacts/ each time a stage ends,
+so an interrupted run leaves its manifest too.
+
+Usage:
+  python3 pipeline.py [--iterations N] [--workers N] [--fuzz-iterations N | --duration SECONDS]
+                      [--seed S] [--coverage [--corpus DIR] | --inputs FILE] [--persistent]
+                      [--icount [SHIFT] [--icount-align]] [--jobs N] [--full]
+                      [--no-patch] [--manifest FILE]
+"""
+
+import argparse
+import concurrent.futures
+import datetime
+import json
+import os
+import platform
+import queue
+import random
+import sys
+import threading
+import time
+
+import analysis_cache
+import analyze_results
+import build_and_run
+import fuzz_test
+import run_config
+import static_analysis
+
+TEST_ARTIFACTS_DIR = "test_artifacts"
+MANIFEST_FILE = "pipeline_manifest.json"
+
+# The application fuzz_test.py runs (FIRMWARE_PATH).
+APP = "secure"
+
+# Build and patch cycles at most.
+ITERATIONS = 3
+
+# A patch to one of these starts the next iteration.
+SOURCE_SUFFIXES = (".c", ".h")
+
+
+class StageFailed(Exception):
+    pass
+
+
+class StageSkipped(Exception):
+    pass
+
+
+class Manifest:
+    """
+    The record of a run, saved as JSON after every change. Stages on
+    different threads update it through the lock.
+    """
+
+    def __init__(self, path, options):
+        self.path = path
+        self.lock = threading.Lock()
+        self.start = time.monotonic()
+        self.data = {
+            "started": datetime.datetime.now().isoformat(timespec="seconds"),
+            "host": platform.node(),
+            "options": options,
+            "iterations": [],
+            "seconds": None,
+            "stopped": None,
+        }
+
+    def now(self):
+        """
+        Seconds since the start of the run.
+        """
+        return round(time.monotonic() - self.start, 3)
+
+    def begin_iteration(self, number):
+        with self.lock:
+            record = {"iteration": number, "start": self.now(), "end": None,
+                      "seconds": None, "stages": {}}
+            self.data["iterations"].append(record)
+            self._save()
+        return record
+
+    def end_iteration(self, record):
+        with self.lock:
+            record["end"] = self.now()
+            record["seconds"] = round(record["end"] - record["start"], 3)
+            self._save()
+
+    def record_stage(self, iteration, name, entry):
+        with self.lock:
+            iteration["stages"][name] = entry
+            self._save()
+
+    def finish(self, reason):
+        with self.lock:
+            self.data["seconds"] = self.now()
+            self.data["stopped"] = reason
+            self._save()
+
+    def _save(self):
+        tmp = self.path + ".tmp"
+        with open(tmp, "w", encoding="utf-8") as f:
+            json.dump(self.data, f, indent=2)
+        os.replace(tmp, self.path)
+
+
+class Pipeline:
+    """
+    The stages of one iteration, each run on its own thread once the stages
+    it comes after have finished. Stages that stream data to each other do so
+    through queues of their own; "after" only orders their start.
+    """
+
+    def __init__(self, manifest, iteration):
+        self.manifest = manifest
+        self.iteration = iteration
+        self.stages = []
+
+    def add(self, name, func, after=()):
+        self.stages.append((name, func, tuple(after)))
+
+    def _run_stage(self, name, func, after, waits):
+        entry = {"after": list(after), "start": None, "end": None, "seconds": None,
+                 "status": "waiting"}
+        for future in waits:
+            if future.exception() is not None:
+                entry["status"] = "skipped"
+                self.manifest.record_stage(self.iteration, name, entry)
+                raise StageSkipped(name)
+
+        entry["start"] = self.manifest.now()
+        entry["status"] = "running"
+        self.manifest.record_stage(self.iteration, name, entry)
+        try:
+            entry["result"] = func()
+            entry["status"] = "ok"
+        except Exception as e:
+            entry["status"] = "failed"
+            entry["error"] = f"{type(e).__name__}: {e}"
+            raise
+        finally:
+            entry["end"] = self.manifest.now()
+            entry["seconds"] = round(entry["end"] - entry["start"], 3)
+            self.manifest.record_stage(self.iteration, name, entry)
+        return entry["result"]
+
+    def run(self):
+        """
+        Runs every stage, leaving their status in the iteration's record.
+        """
+        futures = {}
+        # In the order they were added.
+        for name, _, after in self.stages:
+            self.manifest.record_stage(self.iteration, name,
+                                       {"after": list(after), "start": None, "end": None,
+                                        "seconds": None, "status": "waiting"})
+        with concurrent.futures.ThreadPoolExecutor(max_workers=len(self.stages)) as pool:
+            for name, func, after in self.stages:
+                futures[name] = pool.submit(self._run_stage, name, func, after,
+                                            [futures[a] for a in after])
+            for name, future in futures.items():
+                error = future.exception()
+                if error is not None and not isinstance(error, StageSkipped):
+                    print(f"[PIPELINE] Stage {name} failed: {error}")
+
+
+def make_options(args):
+    """
+    The make variables fuzz_test.py's modes need the firmware built with.
+    """
+    options = {}
+    if args.coverage:
+        options["COVERAGE"] = 1
+    if args.persistent:
+        options["PERSISTENT"] = 1
+    return options
+
+
+def run_iteration(number, args, seed, manifest, reported):
+    """
+    Builds, analyses, fuzzes and patches once. reported holds the fingerprints
+    of the findings reported by the earlier iterations, and gets those of this
+    one. Returns the iteration's record in the manifest.
+    """
+    record = manifest.begin_iteration(number)
+    options = make_options(args)
+    make_vars = build_and_run.make_variables(APP, options=options)
+
+    # Lists of logs to scan, and None from each of static and fuzz when done.
+    logs = queue.Queue()
+    # Lists of new findings, and None when analysis is done.
+    findings = queue.Queue()
+    fuzz_done = threading.Event()
+
+    def build():
+        if not build_and_run.build_firmware(APP, options=options):
+            raise StageFailed("make failed")
+        return {"make": make_vars}
+
+    def static():
+        try:
+            static_analysis.analyse(args.jobs, args.full, make_vars)
+            paths = analyze_results.find_static_analysis_logs()
+            logs.put(paths)
+            return {"logs": len(paths)}
+        finally:
+            logs.put(None)
+
+    def fuzz():
+        try:
+            stats, elapsed, _ = fuzz_test.run(args.workers, args.fuzz_iterations, args.duration, seed,
+                                              args.coverage, args.corpus, args.inputs, args.persistent,
+                                              args.icount, args.icount_align,
+                                              on_finding=lambda path: logs.put([path]))
+        finally:
+            fuzz_done.set()
+            logs.put(None)
+        execs = sum(s["execs"] for s in stats.values())
+        verdicts = {}
+        for s in stats.values():
+            for name, count in s["verdicts"].items():
+                verdicts[name] = verdicts.get(name, 0) + count
+        return {"execs": execs, "findings": sum(s["findings"] for s in stats.values()),
+                "exec_per_s": round(execs / elapsed, 2) if elapsed > 0 else 0.0,
+                "verdicts": verdicts}
+
+    def analyze():
+        cache = analysis_cache.AnalysisCache(os.path.join(TEST_ARTIFACTS_DIR, analysis_cache.CACHE_FILE))
+        report = analyze_results.Report(os.path.join(TEST_ARTIFACTS_DIR, analyze_results.REPORT_FILE),
+                                        cache, recheck=frozenset(reported))
+        producers = 2
+        while_fuzzing = 0
+        try:
+            while producers:
+                # Everything waiting is scanned as one batch.
+                batch = []
+                item = logs.get()
+                while True:
+                    if item is None:
+                        producers -= 1
+                    else:
+                        batch += item
+                    try:
+                        item = logs.get_nowait()
+                    except queue.Empty:
+                        break
+                if not batch:
+                    continue
+                if not fuzz_done.is_set():
+                    while_fuzzing += len(batch)
+                new_findings = report.add(batch)
+                if new_findings:
+                    findings.put(new_findings)
+                    reported.update(item["fingerprint"] for item in new_findings)
+        finally:
+            report.close()
+            findings.put(None)
+        report.print_summary()
+        return {"files": len(report.paths), "new_findings": report.count - len(report.still_failing),
+                "still_failing": [{"keyword": item["keyword"],
+                                   "location": analysis_cache.source_location(item["line_text"]),
+                                   "line_text": item["line_text"]} for item in report.still_failing],
+                "scanned_while_fuzzing": while_fuzzing}
+
+    def refine():
+        # Imported here as it needs the openai package, which only this
+        # stage uses.
+        import llm_refine
+
+        cache = llm_refine.ResponseCache(llm_refine.LLM_CACHE)
+        main_c_content = llm_refine.read_main_c()
+        regions = []
+        futures = {}
+        suggestions = {}
+        received = 0
+        try:
+            with concurrent.futures.ThreadPoolExecutor(max_workers=llm_refine.MAX_IN_FLIGHT) as pool:
+                while True:
+                    batch = findings.get()
+                    if batch is None:
+                        break
+                    received += len(batch)
+                    for region in llm_refine.find_regions(batch):
+                        futures[pool.submit(llm_refine.suggest_fix, region, main_c_content, cache)] = len(regions)
+                        regions.append(region)
+                for future, i in futures.items():
+                    try:
+                        suggestions[i] = future.result()
+                    except Exception as e:
+                        r = regions[i]
+                        print(f"Request for {r['file']} lines {r['start'] + 1}-{r['end']} failed: {e}")
+        finally:
+            cache.save()
+        patched = llm_refine.apply_patches(regions, suggestions)
+        findings_in_regions = sum(len(r["vulns"]) for r in regions)
+        return {"findings": findings_in_regions, "without_source": received - findings_in_regions,
+                "regions": len(regions),
+                "suggestions": len(suggestions),
+                "from_cache": cache.hits, "patched": patched}
+
+    pipeline = Pipeline(manifest, record)
+    pipeline.add("build", build)
+    pipeline.add("static", static, after=["build"])
+    pipeline.add("fuzz", fuzz, after=["build"])
+    pipeline.add("analyze", analyze, after=["build"])
+    if not args.no_patch:
+        pipeline.add("refine", refine, after=["build"])
+    pipeline.run()
+    manifest.end_iteration(record)
+    return record
+
+
+def print_timings(manifest):
+    """
+    One line per iteration with when each of its stages ran.
+    """
+    print("\nStage timings (seconds from the start of the run):")
+    for record in manifest.data["iterations"]:
+        print(f"  iteration {record['iteration']}: {record['seconds']:.1f}s")
+        for name, entry in record["stages"].items():
+            if entry["start"] is None:
+                print(f"    {name:<8} {entry['status']}")
+            else:
+                print(f"    {name:<8} {entry['start']:8.1f} -> {entry['end']:8.1f}  "
+                      f"{entry['seconds']:7.1f}s  {entry['status']}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build, analyse, fuzz and patch the firmware as one pipeline.")
+    parser.add_argument("--iterations", type=int, default=ITERATIONS,
+                        help="build and patch cycles at most (default: %(default)s)")
+    parser.add_argument("-w", "--workers", type=int, default=os.cpu_count() or 1,
+                        help="QEMU instances fuzzing at once (default: one per CPU)")
+    limit = parser.add_mutually_exclusive_group()
+    limit.add_argument("-n", "--fuzz-iterations", type=int, default=None,
+                       help=f"fuzz runs per iteration (default: {fuzz_test.NUM_ITERATIONS})")
+    limit.add_argument("-d", "--duration", type=float, default=None,
+                       help="fuzz for this many seconds per iteration instead")
+    parser.add_argument("-s", "--seed", type=int, default=None,
+                        help="base seed of the fuzzer, the same for every iteration (default: random)")
+    source = parser.add_mutually_exclusive_group()
+    source.add_argument("-c", "--coverage", action="store_true",
+                        help="coverage guided fuzzing, building with COVERAGE=1")
+    source.add_argument("-i", "--inputs", default=None,
+                        help="take the packets from a file pre-generated by mqtt_gen.py")
+    parser.add_argument("--corpus", default=fuzz_test.CORPUS_DIR,
+                        help="corpus directory for --coverage (default: %(default)s)")
+    parser.add_argument("-p", "--persistent", action="store_true",
+                        help="persistent fuzzing, building with PERSISTENT=1")
+    run_config.add_arguments(parser)
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count() or 1,
+                        help="parallel jobs for each static analyzer (default: one per CPU)")
+    parser.add_argument("--full", action="store_true",
+                        help="statically analyse every translation unit, not only the changed ones")
+    parser.add_argument("--no-patch", action="store_true",
+                        help="stop after the analysis, without asking the LLM for fixes")
+    parser.add_argument("--manifest", default=os.path.join(TEST_ARTIFACTS_DIR, MANIFEST_FILE),
+                        help="where the run manifest is saved (default: %(default)s)")
+    args = parser.parse_args()
+
+    seed = args.seed if args.seed is not None else random.randrange(2 ** 32)
+    os.makedirs(TEST_ARTIFACTS_DIR, exist_ok=True)
+    os.makedirs(os.path.dirname(args.manifest) or ".", exist_ok=True)
+    manifest = Manifest(args.manifest, dict(vars(args), seed=seed,
+                                            timing=run_config.timing_mode(args.icount, args.icount_align)))
+
+    status = 0
+    reason = f"{args.iterations} iterations done"
+    # Fingerprints of the findings reported so far in this run.
+    reported = set()
+    for number in range(1, args.iterations + 1):
+        print(f"\n[PIPELINE] Iteration {number}, base seed {seed}")
+        record = run_iteration(number, args, seed, manifest, reported)
+        failed = [name for name, entry in record["stages"].items() if entry["status"] != "ok"]
+        if failed:
+            reason = f"iteration {number}: {', '.join(failed)} did not complete"
+            status = 1
+            break
+        if args.no_patch:
+            reason = f"iteration {number}: analysed without patching"
+            break
+        refined = record["stages"]["refine"]["result"]
+        patched = [path for path in refined["patched"] if path.endswith(SOURCE_SUFFIXES)]
+        if not patched:
+            if refined["findings"]:
+                reason = f"iteration {number}: {refined['findings']} findings but no source file patched"
+                status = 1
+            elif refined["without_source"]:
+                reason = f"iteration {number}: {refined['without_source']} findings with no source to patch"
+            else:
+                reason = f"iteration {number}: no findings to patch"
+            break
+        print(f"[PIPELINE] Patched {', '.join(patched)}, building again.")
+
+    manifest.finish(reason)
+    print_timings(manifest)
+    print(f"\n[PIPELINE] Stopped after {manifest.data['seconds']:.1f}s: {reason}. "
+          f"Manifest saved to {args.manifest}")
+    sys.exit(status)
+
+
+if __name__ == "__main__":
+    main()
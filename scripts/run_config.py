@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+
+"""
+Deterministic timing mode and run configuration records.
+
+By default QEMU runs the firmware as fast as the host allows and derives the
+SysTick from the host clock, so the measured execution times, and whether a
+task misses its deadline, depend on the host and on its load. With -icount
+QEMU instead advances the virtual clock by 2^shift ns per instruction, so a
+given firmware and input take the same number of ticks on any machine.
+With sleep=off (the default here) idle time is skipped rather than waited
+for, so the run is also faster than real time; align=on slows QEMU down to
+keep the virtual clock close to the host's, and needs sleep=on.
+
+The firmware's injected delays come from rand() seeded with mainRANDOM_SEED
+("make RANDOM_SEED=n"), so together with -icount a run is repeatable and the
+latencies of two builds can be compared.
+
+write() saves the settings of a run as JSON next to its artifacts, so the
+numbers in them can be traced back to how they were produced.
+
+Usage:
+  python3 run_config.py RUN_CONFIG_JSON    # print a recorded configuration
+"""
+
+import datetime
+import hashlib
+import json
+import platform
+import subprocess
+import sys
+
+# 2^5 ns per instruction, about 31 MIPS, close to the 25 MHz configCPU_CLOCK_HZ.
+DEFAULT_ICOUNT_SHIFT = 5
+
+RUN_CONFIG_FILE = "run_config.json"
+
+
+def add_arguments(parser):
+    """
+    Adds --icount [SHIFT] and --icount-align to an argparse parser.
+    """
+    parser.add_argument("--icount", type=int, nargs="?", const=DEFAULT_ICOUNT_SHIFT, default=None,
+                        metavar="SHIFT",
+                        help=f"deterministic timing, 2^SHIFT ns per instruction "
+                             f"(default shift: {DEFAULT_ICOUNT_SHIFT})")
+    parser.add_argument("--icount-align", action="store_true",
+                        help="with --icount, keep the virtual clock aligned to the host's")
+
+
+def qemu_icount_args(shift, align=False):
+    """
+    QEMU options for the deterministic timing mode, none if shift is None.
+    """
+    if shift is None:
+        return []
+    # align=on only works with sleep=on.
+    flag = "on" if align else "off"
+    return ["-icount", f"shift={shift},align={flag},sleep={flag}"]
+
+
+def timing_mode(shift, align=False):
+    """
+    A short description of the timing mode, for logs.
+    """
+    if shift is None:
+        return "host clock"
+    return f"icount shift={shift}" + (" align" if align else "")
+
+
+def file_digest(path):
+    """
+    SHA-256 of the firmware image, None if it cannot be read.
+    """
+    try:
+        with open(path, "rb") as f:
+            return hashlib.sha256(f.read()).hexdigest()
+    except OSError:
+        return None
+
+
+def qemu_version():
+    try:
+        result = subprocess.run(["qemu-system-arm", "--version"], capture_output=True, text=True)
+    except OSError:
+        return None
+    return result.stdout.splitlines()[0] if result.stdout else None
+
+
+def write(path, firmware, qemu_cmd, icount=None, icount_align=False, **fields):
+    """
+    Saves the configuration of a run to path. fields holds anything specific
+    to the script, such as the seeds used.
+    """
+    config = {
+        "time": datetime.datetime.now().isoformat(timespec="seconds"),
+        "host": platform.node(),
+        "qemu": qemu_version(),
+        "firmware": firmware,
+        "firmware_sha256": file_digest(firmware),
+        "timing": timing_mode(icount, icount_align),
+        "icount_shift": icount,
+        "icount_align": icount_align,
+        "qemu_cmd": qemu_cmd,
+    }
+    config.update(fields)
+    with open(path, "w", encoding="utf-8") as f:
+        json.dump(config, f, indent=2)
+    return config
+
+
+def main():
+    if len(sys.argv) != 2:
+        print(__doc__.strip(), file=sys.stderr)
+        sys.exit(2)
+    with open(sys.argv[1], "r", encoding="utf-8") as f:
+        config = json.load(f)
+    for key, value in config.items():
+        print(f"{key}: {value}")
+
+
+if __name__ == "__main__":
+    main()
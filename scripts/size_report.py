@@ -0,0 +1,276 @@
+#!/usr/bin/env python3
+
+"""
+Code size and static RAM report of a firmware image.
+
+build/gcc/Makefile writes one after every link, as size_report.txt and
+size_report.json in the output directory of the build, so the PROFILE=release,
+debug and perf builds can be compared function by function. The sizes come
+from "nm --size-sort" on the image, and the object file of each symbol is
+looked up by address in the linker map (RTOSDemo.map). With LTO (PROFILE=perf)
+the map only names the LTO partitions, so symbols are grouped by name alone.
+
+The report lists:
+  - the totals of code, read-only data, initialised data and zeroed data
+  - the hot path functions in HOT_SYMBOLS (and --symbol), with their size and
+    whether they were inlined away
+  - the largest functions
+  - the RAM of the static buffers, grouped into TraceRecorder, heap_4 (whose
+    ucHeap holds the stacks of the tasks created at run time), the static
+    task stacks and the rest by object file
+  - the largest RAM objects
+
+Usage:
+  python3 size_report.py output/secure/RTOSDemo.out [--map MAP] [--nm NM]
+                         [--top N] [--symbol NAME ...] [-o REPORT] [--json FILE]
+"""
+
+import argparse
+import bisect
+import json
+import os
+import re
+import subprocess
+import sys
+
+DEFAULT_NM = "arm-none-eabi-nm"
+
+# Where RAM starts if the map does not say (mps2_m3.ld).
+DEFAULT_RAM_ORIGIN = 0x20000000
+
+# Entries in each "largest" list.
+TOP = 25
+
+# Functions on the packet and console hot paths.
+HOT_SYMBOLS = (
+    "handlePacket",
+    "xMqttDecoderFeed",
+    "xMqttParseFixedHeader",
+    "xPacketRingPeek",
+    "UARTRX0_Handler",
+    "tiny_print",
+    "printi",
+    "prints",
+    "xUARTWrite",
+    "vTaskSwitchContext",
+    "xTaskIncrementTick",
+)
+
+CODE_TYPES = "tTwW"
+RODATA_TYPES = "rR"
+DATA_TYPES = "dDgG"
+BSS_TYPES = "bBsSvV"
+
+_MEMORY_RE = re.compile(r"^RAM\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)")
+# " .text.name  0xADDR  0xSIZE  object", the address part on the next line if
+# the section name is long.
+_SECTION_RE = re.compile(r"^ (\.[^\s*]+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*))?$")
+_CONTINUATION_RE = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+# Suffixes GCC adds to the local copies it makes of a function.
+_CLONE_RE = re.compile(r"\.(?:constprop|isra|part|lto_priv|cold|localalias)\.?\d*")
+
+
+def object_name(path):
+    """
+    "main.o" for "./output/secure/main.o", "libc_nano.a(lib_a-memcpy.o)" for a
+    library member and "(LTO)" for an LTO partition.
+    """
+    path = path.strip()
+    if ".ltrans" in path:
+        return "(LTO)"
+    archive, member = (path.split("(", 1) + [""])[:2]
+    return os.path.basename(archive) + ("(" + member if member else "")
+
+
+def base_name(symbol):
+    """
+    The function a GCC clone such as "printi.constprop.0" was made from.
+    """
+    return _CLONE_RE.sub("", symbol)
+
+
+class LinkerMap:
+    """
+    The input sections of a GNU ld map file, to find the object a symbol came
+    from by its address.
+    """
+
+    def __init__(self, path=None):
+        self.ram_origin = DEFAULT_RAM_ORIGIN
+        self._starts = []
+        self._sections = []
+        if path is not None and os.path.isfile(path):
+            self._parse(path)
+
+    def _parse(self, path):
+        sections = []
+        pending = None
+        in_map = False
+        with open(path, "r", encoding="utf-8", errors="ignore") as f:
+            for line in f:
+                line = line.rstrip("\n")
+                if not in_map:
+                    match = _MEMORY_RE.match(line)
+                    if match:
+                        self.ram_origin = int(match.group(1), 16)
+                    in_map = line.startswith("Linker script and memory map")
+                    continue
+                if pending is not None:
+                    match = _CONTINUATION_RE.match(line)
+                    if match:
+                        sections.append((int(match.group(1), 16), int(match.group(2), 16),
+                                         object_name(match.group(3))))
+                    pending = None
+                    continue
+                match = _SECTION_RE.match(line)
+                if match is None:
+                    continue
+                if match.group(2) is None:
+                    pending = match.group(1)
+                elif int(match.group(3), 16) > 0:
+                    sections.append((int(match.group(2), 16), int(match.group(3), 16),
+                                     object_name(match.group(4))))
+        sections.sort()
+        self._sections = sections
+        self._starts = [s[0] for s in sections]
+
+    def object_at(self, address):
+        """
+        The object whose input section holds address, or "?".
+        """
+        i = bisect.bisect_right(self._starts, address) - 1
+        if i >= 0:
+            start, size, obj = self._sections[i]
+            if address < start + size:
+                return obj
+        return "?"
+
+
+def read_symbols(elf, nm):
+    """
+    (address, size, type, name) of each sized symbol, largest last.
+    """
+    result = subprocess.run([nm, "--size-sort", "-S", elf], capture_output=True, text=True)
+    if result.returncode != 0:
+        sys.exit(f"{nm} failed: {result.stderr.strip()}")
+    symbols = []
+    for line in result.stdout.splitlines():
+        fields = line.split()
+        if len(fields) == 4:
+            symbols.append((int(fields[0], 16), int(fields[1], 16), fields[2], fields[3]))
+    return symbols
+
+
+def ram_group(obj, name):
+    """
+    The buffer group a RAM symbol is reported under.
+    """
+    if obj.startswith("trc") or name.startswith(("trc", "prvTrace")) or "Trace" in name:
+        return "TraceRecorder"
+    if obj == "heap_4.o" or name == "ucHeap":
+        return "heap_4"
+    if "stack" in name.lower():
+        return "task stacks"
+    return obj
+
+
+def build_report(elf, map_path, nm, top, hot_symbols):
+    linker_map = LinkerMap(map_path)
+    entries = []
+    for address, size, kind, name in read_symbols(elf, nm):
+        entries.append({"name": name, "size": size, "type": kind.upper(), "address": address,
+                        "object": linker_map.object_at(address & ~1)})
+
+    def of_types(types):
+        return [e for e in entries if e["type"] in types.upper()]
+
+    code = [e for e in of_types(CODE_TYPES) if e["address"] < linker_map.ram_origin]
+    ram = [e for e in of_types(DATA_TYPES + BSS_TYPES) if e["address"] >= linker_map.ram_origin]
+
+    groups = {}
+    for e in ram:
+        group = ram_group(e["object"], e["name"])
+        groups[group] = groups.get(group, 0) + e["size"]
+
+    hot = []
+    for wanted in hot_symbols:
+        copies = [e for e in code if base_name(e["name"]) == wanted]
+        hot.append({"name": wanted, "size": sum(e["size"] for e in copies),
+                    "copies": [e["name"] for e in copies]})
+
+    return {
+        "image": os.path.abspath(elf),
+        "totals": {
+            "code": sum(e["size"] for e in code),
+            "rodata": sum(e["size"] for e in of_types(RODATA_TYPES)),
+            "data": sum(e["size"] for e in ram if e["type"] in DATA_TYPES.upper()),
+            "bss": sum(e["size"] for e in ram if e["type"] in BSS_TYPES.upper()),
+        },
+        "hot_functions": hot,
+        "largest_functions": [{k: e[k] for k in ("name", "size", "object")}
+                              for e in sorted(code, key=lambda e: -e["size"])[:top]],
+        "ram_groups": dict(sorted(groups.items(), key=lambda g: -g[1])),
+        "largest_ram": [{k: e[k] for k in ("name", "size", "type", "object")}
+                        for e in sorted(ram, key=lambda e: -e["size"])[:top]],
+    }
+
+
+def format_report(report, profile=None):
+    lines = [f"Size report of {report['image']}" + (f" (PROFILE={profile})" if profile else ""), ""]
+    totals = report["totals"]
+    lines.append(f"code {totals['code']}  rodata {totals['rodata']}  "
+                 f"data {totals['data']}  bss {totals['bss']}  "
+                 f"(RAM {totals['data'] + totals['bss']} bytes)")
+
+    lines += ["", "Hot path functions:"]
+    for h in report["hot_functions"]:
+        if not h["copies"]:
+            lines.append(f"  {'-':>7}  {h['name']} (inlined or not linked)")
+        else:
+            copies = "" if h["copies"] == [h["name"]] else f" ({', '.join(h['copies'])})"
+            lines.append(f"  {h['size']:>7}  {h['name']}{copies}")
+
+    lines += ["", f"Largest {len(report['largest_functions'])} functions:"]
+    lines += [f"  {e['size']:>7}  {e['name']:<40} {e['object']}" for e in report["largest_functions"]]
+
+    lines += ["", "Static RAM by buffer:"]
+    lines += [f"  {size:>7}  {group}" for group, size in report["ram_groups"].items()]
+
+    lines += ["", f"Largest {len(report['largest_ram'])} RAM objects:"]
+    lines += [f"  {e['size']:>7}  {e['type']} {e['name']:<38} {e['object']}" for e in report["largest_ram"]]
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Report the largest functions and static buffers of an image.")
+    parser.add_argument("elf", help="firmware image, e.g. build/gcc/output/secure/RTOSDemo.out")
+    parser.add_argument("--map", help="linker map (default: RTOSDemo.map next to the image)")
+    parser.add_argument("--nm", default=DEFAULT_NM, help="nm to use (default: %(default)s)")
+    parser.add_argument("--top", type=int, default=TOP, help="entries per list (default: %(default)s)")
+    parser.add_argument("--symbol", action="append", default=[],
+                        help="another hot path function to report, may be repeated")
+    parser.add_argument("--profile", help="build profile, for the heading")
+    parser.add_argument("-o", "--out", help="write the report here instead of to stdout")
+    parser.add_argument("--json", help="also write the report as JSON")
+    args = parser.parse_args()
+
+    map_path = args.map or os.path.join(os.path.dirname(args.elf), "RTOSDemo.map")
+    report = build_report(args.elf, map_path, args.nm, args.top, HOT_SYMBOLS + tuple(args.symbol))
+    report["profile"] = args.profile
+    text = format_report(report, args.profile)
+
+    if args.json:
+        with open(args.json, "w", encoding="utf-8") as f:
+            json.dump(report, f, indent=2)
+    if args.out:
+        with open(args.out, "w", encoding="utf-8") as f:
+            f.write(text)
+        totals = report["totals"]
+        print(f"Size report in {args.out}: code {totals['code']}, "
+              f"RAM {totals['data'] + totals['bss']} bytes")
+    else:
+        print(text, end="")
+
+
+if __name__ == "__main__":
+    main()
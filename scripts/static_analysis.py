@@ -4,17 +4,38 @@
 Step 4: Security & Reliability Testing - Static Analysis
 --------------------------------------------------------
 Modifications:
-  - Outputs analysis results into test_artifacts/static_analysis/ 
+  - Outputs analysis results into test_artifacts/static_analysis/
     so analyze_results.py can parse them.
+  - Both analyzers work from the compilation database that
+    "make compile_commands.json" writes in BUILD_DIR, so each file is analysed
+    with the defines and include paths it is built with.
+  - Cppcheck runs with --project on that database, on all CPUs, and keeps its
+    per file results in CPPCHECK_BUILD_DIR so that unchanged files are not
+    analysed again.
+  - The Clang Static Analyzer runs "clang --analyze" on each translation unit
+    of the database instead of a full scan-build of the kernel and
+    TraceRecorder, and only on those whose source, headers (from the .d files
+    of the last build) or flags changed since the last run. The results of
+    the others are taken from CLANG_STATE.
+  - Both analyzers run at the same time.
+  - analyse() runs it all, for pipeline.py to analyse the build it is also
+    fuzzing, by describing it with the same make variables.
 
 Usage:
-  python3 static_analysis.py
+  python3 static_analysis.py [--jobs N] [--full]
 """
 
+import argparse
+import concurrent.futures
+import hashlib
+import json
 import os
+import shlex
 import subprocess
 import shutil
 
+BUILD_DIR = "/home/arampour/FreeRTOS/FreeRTOS/Demo/CORTEX_MPS2_QEMU_IAR_GCC/build/gcc"
+
 SOURCE_PATHS = [
     "/home/arampour/FreeRTOS/FreeRTOS/Demo/CORTEX_MPS2_QEMU_IAR_GCC",
     # "/home/arampour/FreeRTOS/FreeRTOS/Source"  # optional, if you want to scan core kernel
@@ -23,9 +44,22 @@ SOURCE_PATHS = [
 # Directory to store static analysis logs
 STATIC_OUT_DIR = "test_artifacts/static_analysis"
 
+# Compilation database written by the Makefile (inside BUILD_DIR).
+COMPILE_DB = "compile_commands.json"
+
+# Cppcheck's incremental analysis cache.
+CPPCHECK_BUILD_DIR = os.path.join(STATIC_OUT_DIR, "cppcheck-build")
+
+# Digest and output of the last Clang analysis of each translation unit.
+CLANG_STATE = os.path.join(STATIC_OUT_DIR, "clang_state.json")
+
+# GCC options clang does not understand or that do not apply to analysis.
+_CLANG_DROP_OPTIONS = ("-g3", "-ffunction-sections", "-fdata-sections", "-fsanitize-coverage=trace-pc",
+                       "-fuse-linker-plugin")
+
 def clear_old_static_logs():
     """
-    Removes old static analysis logs (e.g., .txt, .log) from STATIC_OUT_DIR 
+    Removes old static analysis logs (e.g., .txt, .log) from STATIC_OUT_DIR
     before running a new static analysis.
     """
     if os.path.isdir(STATIC_OUT_DIR):
@@ -35,26 +69,50 @@ def clear_old_static_logs():
     else:
         print(f"[INFO] Directory '{STATIC_OUT_DIR}' does not exist; no old logs to clear.")
 
-
-def run_cppcheck():
+def generate_compile_db(make_vars=()):
+    """
+    Has the Makefile write the compilation database, for the build selected
+    by make_vars ("APP=secure", ...). Returns its path, or None if it could
+    not be generated.
+    """
+    path = os.path.join(BUILD_DIR, COMPILE_DB)
+    # The target has no prerequisites, so an old database would be kept.
+    if os.path.isfile(path):
+        os.remove(path)
+    result = subprocess.run(["make", COMPILE_DB] + list(make_vars), cwd=BUILD_DIR,
+                            capture_output=True, text=True)
+    if result.returncode != 0 or not os.path.isfile(path):
+        print(f"[WARN] Could not generate {path}:\n{result.stdout}{result.stderr}")
+        return None
+    return path
+
+def run_cppcheck(compile_db, jobs):
     print("Running Cppcheck analysis...\n")
     os.makedirs(STATIC_OUT_DIR, exist_ok=True)
+    os.makedirs(CPPCHECK_BUILD_DIR, exist_ok=True)
 
     cppcheck_log = os.path.join(STATIC_OUT_DIR, "cppcheck_report.txt")
 
+    common = [
+        "cppcheck",
+        "--enable=all",
+        "--inconclusive",
+        f"-j{jobs}",
+        f"--cppcheck-build-dir={CPPCHECK_BUILD_DIR}",
+    ]
+    if compile_db is not None:
+        # Only report on our own sources, not the kernel or TraceRecorder.
+        runs = [("compile_commands.json", common + [f"--project={compile_db}"] +
+                 [f"--file-filter={path}/*" for path in SOURCE_PATHS])]
+    else:
+        runs = [(path, common + ["--force", path]) for path in SOURCE_PATHS]
+
     with open(cppcheck_log, "w") as log_file:
-        for path in SOURCE_PATHS:
-            cmd = [
-                "cppcheck",
-                "--enable=all",
-                "--inconclusive",
-                "--force",
-                path
-            ]
-            print(f"Analyzing path: {path}")
+        for name, cmd in runs:
+            print(f"Analyzing: {name}")
             result = subprocess.run(cmd, capture_output=True, text=True)
 
-            log_file.write(f"----- Analysis of {path} -----\n")
+            log_file.write(f"----- Analysis of {name} -----\n")
             log_file.write(result.stdout)
             log_file.write("\n")
             if result.stderr:
@@ -64,38 +122,130 @@ def run_cppcheck():
 
     print(f"Cppcheck results saved to: {cppcheck_log}")
 
-def run_clang_static_analyzer():
-    print("\nRunning Clang Static Analyzer (scan-build)...\n")
+def clang_command(entry, sysroot):
+    """
+    The clang --analyze command for one compilation database entry.
+    """
+    args = shlex.split(entry["command"])[1:]
+    cmd = ["clang", "--analyze", "--target=arm-none-eabi", "-Xanalyzer", "-analyzer-output=text"]
+    if sysroot:
+        cmd.append(f"--sysroot={sysroot}")
+    skip = False
+    for arg in args:
+        if skip:
+            skip = False
+        elif arg == "-o":
+            skip = True
+        elif arg == "-c" or arg in _CLANG_DROP_OPTIONS or arg.startswith(("-specs=", "-flto")):
+            continue
+        else:
+            cmd.append(arg)
+    return cmd
+
+def unit_digest(entry):
+    """
+    Hash of a translation unit's flags, source and the headers its .d file
+    from the last build lists.
+    """
+    h = hashlib.sha256(entry["command"].encode())
+    paths = [entry["file"]]
+    # Next to the object file, in the output directory of the application.
+    args = shlex.split(entry["command"])
+    obj = args[args.index("-o") + 1] if "-o" in args[:-1] else ""
+    dep_file = os.path.join(entry["directory"], os.path.splitext(obj)[0] + ".d")
+    if os.path.isfile(dep_file):
+        with open(dep_file, "r", encoding="utf-8", errors="ignore") as f:
+            deps = f.read().replace("\\\n", " ").split()
+        paths += sorted({d for d in deps if d.endswith(".h")})
+    for path in paths:
+        path = os.path.join(entry["directory"], path)
+        try:
+            with open(path, "rb") as f:
+                h.update(f.read())
+        except OSError:
+            h.update(b"missing " + path.encode())
+    return h.hexdigest()
+
+def analyze_unit(entry, sysroot):
+    result = subprocess.run(clang_command(entry, sysroot), cwd=entry["directory"],
+                            capture_output=True, text=True)
+    return result.stdout + result.stderr
+
+def run_clang_static_analyzer(compile_db, jobs, full=False):
+    print("\nRunning Clang Static Analyzer...\n")
     os.makedirs(STATIC_OUT_DIR, exist_ok=True)
 
-    scanbuild_log = os.path.join(STATIC_OUT_DIR, "clang_scanbuild_results.txt")
-
-    build_dir = "/home/arampour/FreeRTOS/FreeRTOS/Demo/CORTEX_MPS2_QEMU_IAR_GCC/build/gcc"
-    cmd = [
-        "scan-build",
-        "--use-cc=clang",
-        "--use-c++=clang++",
-        "make",
-        "-j"
-    ]
-
-    with open(scanbuild_log, "w") as log_file:
-        result = subprocess.run(cmd, cwd=build_dir, capture_output=True, text=True)
-        log_file.write(result.stdout)
-        if result.stderr:
-            log_file.write("Scan-Build Errors:\n")
-            log_file.write(result.stderr)
+    clang_log = os.path.join(STATIC_OUT_DIR, "clang_analyzer_results.txt")
+    if compile_db is None:
+        print("[WARN] No compilation database, skipping the Clang Static Analyzer.")
+        return
+
+    with open(compile_db, "r", encoding="utf-8") as f:
+        entries = [e for e in json.load(f)
+                   if any(os.path.abspath(e["file"]).startswith(os.path.abspath(p)) for p in SOURCE_PATHS)]
+
+    state = {}
+    if not full and os.path.isfile(CLANG_STATE):
+        with open(CLANG_STATE, "r", encoding="utf-8") as f:
+            state = json.load(f)
+
+    sysroot = None
+    if shutil.which("arm-none-eabi-gcc"):
+        sysroot = subprocess.run(["arm-none-eabi-gcc", "-print-sysroot"],
+                                 capture_output=True, text=True).stdout.strip() or None
+
+    digests = {e["file"]: unit_digest(e) for e in entries}
+    changed = [e for e in entries
+               if state.get(e["file"], {}).get("digest") != digests[e["file"]]]
+    print(f"{len(changed)} of {len(entries)} translation units changed since the last run.")
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=max(1, jobs)) as pool:
+        outputs = dict(zip((e["file"] for e in changed),
+                           pool.map(lambda e: analyze_unit(e, sysroot), changed)))
+    for e in changed:
+        state[e["file"]] = {"digest": digests[e["file"]], "output": outputs[e["file"]]}
+
+    # Units no longer built are dropped.
+    state = {path: state[path] for path in digests if path in state}
+    with open(CLANG_STATE, "w", encoding="utf-8") as f:
+        json.dump(state, f)
+
+    with open(clang_log, "w") as log_file:
+        for path in sorted(state):
+            log_file.write(f"----- Analysis of {path} -----\n")
+            log_file.write(state[path]["output"])
             log_file.write("\n")
 
-    print(f"Clang scan-build results saved to: {scanbuild_log}")
+    print(f"Clang analyzer results saved to: {clang_log}")
 
-def main():
+def analyse(jobs, full=False, make_vars=()):
+    """
+    Runs both analyzers on the build selected by make_vars, the Makefile's
+    default if empty.
+    """
     clear_old_static_logs()
+    if full and os.path.isdir(CPPCHECK_BUILD_DIR):
+        shutil.rmtree(CPPCHECK_BUILD_DIR)
 
-    # Use whichever analyzers you prefer
-    run_cppcheck()
-    run_clang_static_analyzer()
+    compile_db = generate_compile_db(make_vars)
+
+    # Use whichever analyzers you prefer; they run side by side.
+    with concurrent.futures.ThreadPoolExecutor(max_workers=2) as pool:
+        analyzers = [pool.submit(run_cppcheck, compile_db, jobs),
+                     pool.submit(run_clang_static_analyzer, compile_db, jobs, full)]
+        for future in analyzers:
+            future.result()
     print("Static analysis complete. Check test_artifacts/static_analysis/ for logs.")
 
+def main():
+    parser = argparse.ArgumentParser(description="Run cppcheck and the Clang Static Analyzer.")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count() or 1,
+                        help="parallel jobs for each analyzer (default: one per CPU)")
+    parser.add_argument("--full", action="store_true",
+                        help="analyse every translation unit, not only the changed ones")
+    args = parser.parse_args()
+
+    analyse(args.jobs, args.full)
+
 if __name__ == "__main__":
     main()
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+
+"""
+Capture the TraceRecorder stream that the firmware sends on UART1.
+
+With TRACE_PORT=UART (the default in build/gcc/Makefile) the firmware streams
+its trace on UART1 from startup, and QEMU connects UART1 to its second -serial
+option. qemu_trace_args() returns that option, writing the stream to a file,
+for build_and_run.py and fuzz_test.py to add after their console -serial
+option. The file is a PSF stream that Tracealyzer opens directly
+(File > Open Trace).
+
+Run on its own, the script boots the firmware for a fixed time and saves the
+trace:
+
+  python3 trace_capture.py output/secure/RTOSDemo.out -o trace.psf -t 10
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+
+from decode_binlog import BinaryLogDecoder
+import verdict
+
+
+def qemu_trace_args(trace_path):
+    """
+    QEMU options that write UART1 to trace_path. Must come after the -serial
+    option of the console (UART0).
+    """
+    return ["-serial", f"file:{trace_path}"]
+
+
+def report(trace_path):
+    """
+    Print where the trace went and how large it is. Returns the size in bytes,
+    0 if the firmware sent nothing.
+    """
+    size = os.path.getsize(trace_path) if os.path.exists(trace_path) else 0
+    if size == 0:
+        print(f"[TRACE] No trace data in {trace_path}. "
+              "Was the firmware built with TRACE_PORT=UART?")
+    else:
+        print(f"[TRACE] {size} bytes of trace data in {trace_path}")
+    return size
+
+
+def capture(kernel, trace_path, seconds):
+    """
+    Run the firmware for the given number of seconds, showing the decoded
+    console and saving the trace.
+    """
+    qemu_cmd = [
+        "qemu-system-arm",
+        "-M", "mps2-an385",
+        "-kernel", kernel,
+        "-monitor", "none",
+        "-nographic",
+        "-serial", "stdio",
+    ] + verdict.qemu_verdict_args() + qemu_trace_args(trace_path)
+
+    process = subprocess.Popen(qemu_cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    try:
+        out, err = process.communicate(timeout=seconds)
+    except subprocess.TimeoutExpired:
+        process.kill()
+        out, err = process.communicate()
+
+    decoder = BinaryLogDecoder()
+    print(decoder.feed(out) + decoder.flush(), end="")
+    if err:
+        print(err.decode("latin-1"), file=sys.stderr)
+
+    return report(trace_path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("kernel", help="firmware ELF, e.g. build/gcc/output/secure/RTOSDemo.out")
+    parser.add_argument("-o", "--output", default="trace.psf", help="trace file to write")
+    parser.add_argument("-t", "--seconds", type=float, default=10.0, help="how long to run")
+    args = parser.parse_args()
+
+    sys.exit(0 if capture(args.kernel, args.output, args.seconds) > 0 else 1)
+
+
+if __name__ == "__main__":
+    main()
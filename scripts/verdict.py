@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+
+"""
+Names the exit status of a QEMU run.
+
+The firmware ends a run through semihosting as soon as its outcome is known
+(see Verdict.h), with the Verdict_t value as QEMU's exit status. The values are
+read from Verdict.h, so the names always match the firmware. QEMU has to be
+started with qemu_verdict_args() for the firmware to be able to exit.
+
+Usage:
+  python3 verdict.py STATUS
+"""
+
+import os
+import re
+import sys
+
+DEFAULT_VERDICT_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                    "..", "Verdict.h")
+
+PASS = 0
+
+# One "eVerdictName = value," entry of Verdict_t.
+_ENTRY = re.compile(r'\beVerdict(\w+)\s*=\s*(\d+)\s*,')
+
+
+def qemu_verdict_args():
+    """
+    QEMU options that let the firmware end the run with its verdict.
+    """
+    return ["-semihosting-config", "enable=on,target=native"]
+
+
+def load_verdicts(path=DEFAULT_VERDICT_PATH):
+    """
+    Returns a dict of exit status to verdict name, e.g. {2: "DeadlineMissed"}.
+    """
+    with open(path, "r", encoding="utf-8") as f:
+        content = f.read()
+
+    start = content.find("typedef enum")
+    if start < 0:
+        raise ValueError(f"{path}: Verdict_t not found")
+    return {int(value): name for name, value in _ENTRY.findall(content, start)}
+
+
+def describe(returncode, verdicts=None):
+    """
+    The verdict name for a QEMU exit status. None (the run was still going when
+    it was stopped) or a negative status (killed by a signal) means the
+    firmware did not report a verdict.
+    """
+    if returncode is None or returncode < 0:
+        return "Timeout"
+    if verdicts is None:
+        verdicts = load_verdicts()
+    return verdicts.get(returncode, f"Exit{returncode}")
+
+
+def main():
+    if len(sys.argv) != 2:
+        print(__doc__.strip(), file=sys.stderr)
+        sys.exit(2)
+    print(describe(int(sys.argv[1])))
+
+
+if __name__ == "__main__":
+    main()